@@ -0,0 +1,363 @@
+#include "./broker.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "./context.h"
+#include "./module.h"
+#include "./socket.h"
+#include "util/arguments.h"
+#include "util/async_scope.h"
+#include "util/error.h"
+#include "util/forward.h"
+#include "util/thread.h"
+#include "util/uvthread.h"
+
+namespace zmq {
+/* Defaults of 7/MDP. */
+static constexpr int64_t default_heartbeat_interval = 2500;
+static constexpr uint32_t default_heartbeat_liveness = 3;
+
+/* Reads an optional non-negative integer option. Returns false and throws if
+   the option is invalid. */
+template <typename T>
+static bool GetInteger(
+    const Napi::Object& options, const char* name, const char* msg, T& value) {
+    if (!options.Has(name)) {
+        return true;
+    }
+
+    auto const option = options.Get(name);
+    if (option.IsUndefined()) {
+        return true;
+    }
+
+    if (option.IsNumber()) {
+        auto const number = option.As<Napi::Number>().DoubleValue();
+        if (number >= 0 && number <= UINT32_MAX && number == std::floor(number)) {
+            value = static_cast<T>(number);
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(options.Env(), msg).ThrowAsJavaScriptException();
+    return false;
+}
+
+Broker::Broker(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<Broker>(info), async_context(Env(), "Broker"), poller(*this),
+      module(*static_cast<Module*>(info.Data())) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Socket must be a socket object"),
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    auto* socket = Socket::Unwrap(info[0].As<Napi::Object>());
+    if (Env().IsExceptionPending()) {
+        return;
+    }
+
+    if (socket->type != ZMQ_ROUTER) {
+        ErrnoException(Env(), EINVAL, "Socket must be a router")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto heartbeat_interval = default_heartbeat_interval;
+    auto heartbeat_liveness = default_heartbeat_liveness;
+
+    if (info[1].IsObject()) {
+        auto options = info[1].As<Napi::Object>();
+        if (!GetInteger(options, "heartbeatInterval",
+                "Heartbeat interval must be a non-negative integer", heartbeat_interval)
+            || !GetInteger(options, "heartbeatLiveness",
+                "Heartbeat liveness must be a non-negative integer",
+                heartbeat_liveness)) {
+            return;
+        }
+    }
+
+    socket_ref.Reset(info[0].As<Napi::Object>(), 1);
+    engine = std::make_shared<BrokerEngine>(heartbeat_interval, heartbeat_liveness);
+}
+
+Broker::~Broker() = default;
+
+void Broker::Close() {}
+
+Napi::Value Broker::Run(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    ThreadOptions thread_options;
+    if (info[0].IsObject() && !thread_options.Read(info[0].As<Napi::Object>())) {
+        return Env().Undefined();
+    }
+
+    auto* socket = Socket::Unwrap(socket_ref.Value());
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
+
+    if (socket->endpoints == 0) {
+        ErrnoException(Env(), EINVAL, "Socket must be bound or connected")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    /* The broker takes over the socket in a native thread. */
+    if (socket->offload.Active()) {
+        ErrnoException(Env(), EINVAL, "Sockets with offloaded I/O cannot be brokered")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    if (socket->state == Socket::State::Blocked) {
+        ErrnoException(Env(), EBUSY, "Socket is blocked by another operation")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    auto* context = Context::Unwrap(socket->context_ref.Value());
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
+
+    /* Requests must not be dropped silently when a worker has gone, so that
+       they can be handed to another worker instead. */
+    int32_t mandatory = 1;
+    if (zmq_setsockopt(socket->socket, ZMQ_ROUTER_MANDATORY, &mandatory,
+            sizeof(mandatory))
+        < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    /* Use `this` pointer as unique identifier for the control socket. */
+    auto const address = std::string("inproc://zmq.brokercontrol.")
+        + std::to_string(reinterpret_cast<uintptr_t>(this));
+
+    control = zmq_socket(context->context, ZMQ_PAIR);
+    remote_control = zmq_socket(context->context, ZMQ_PAIR);
+    if (control == nullptr || remote_control == nullptr
+        || zmq_bind(remote_control, address.c_str()) < 0
+        || zmq_connect(control, address.c_str()) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        return Env().Undefined();
+    }
+
+    /* The broker replies to statistics requests over the control socket. */
+    uv_os_sock_t file_descriptor = 0;
+    size_t length = sizeof(file_descriptor);
+    if (zmq_getsockopt(control, ZMQ_FD, &file_descriptor, &length) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        return Env().Undefined();
+    }
+
+    if (poller.Initialize(Env(), file_descriptor) < 0) {
+        ErrnoException(Env(), errno).ThrowAsJavaScriptException();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        return Env().Undefined();
+    }
+
+    socket->state = Socket::State::Blocked;
+
+    auto res = Napi::Promise::Deferred::New(Env());
+    auto error = std::make_shared<int32_t>(0);
+
+    auto* socket_ptr = socket->socket;
+    auto* remote_ptr = remote_control;
+
+    auto status = UvSpawn(
+        Env(),
+        [engine = engine, error, socket_ptr, remote_ptr,
+            thread_options = std::move(thread_options)]() {
+            /* Don't access V8 internals here! Executed in broker thread. */
+            if (auto const err = thread_options.Apply(); err != 0) {
+                *error = err;
+                return;
+            }
+
+            *error = engine->Run(socket_ptr, remote_ptr);
+        },
+        [this, socket, error, res]() {
+            AsyncScope const scope(Env(), async_context);
+
+            /* Statistics that were requested after the broker thread has
+               returned are never answered. */
+            auto unanswered = std::move(statistics_requests);
+            statistics_requests.clear();
+            poller.Close();
+
+            for (auto& request : unanswered) {
+                request.Reject(
+                    ErrnoException(Env(), EBADF, "Broker is not running").Value());
+            }
+
+            socket->Close();
+            CloseSocket(control);
+            CloseSocket(remote_control);
+
+            if (*error != 0) {
+                res.Reject(ErrnoException(Env(), *error).Value());
+                return;
+            }
+
+            res.Resolve(Env().Undefined());
+        });
+
+    if (status < 0) {
+        socket->state = Socket::State::Open;
+        ErrnoException(Env(), status == UV_EAGAIN ? EAGAIN : EBADF)
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    return res.Promise();
+}
+
+void Broker::SendCommand(char command) {
+    /* Don't send commands if the broker is not running. */
+    if (control == nullptr) {
+        ErrnoException(Env(), EBADF, "Broker is not running")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    while (zmq_send(control, &command, 1, 0) < 0) {
+        if (zmq_errno() != EINTR) {
+            ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+            return;
+        }
+    }
+}
+
+void Broker::Terminate(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    SendCommand(BrokerEngine::terminate_command);
+}
+
+Napi::Value Broker::Statistics(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    /* Requests join the command that is in progress, if any. */
+    if (statistics_requests.empty()) {
+        SendCommand(BrokerEngine::statistics_command);
+        if (Env().IsExceptionPending()) {
+            return Env().Undefined();
+        }
+    }
+
+    auto res = Napi::Promise::Deferred::New(Env());
+    auto promise = res.Promise();
+
+    statistics_requests.push_back(std::move(res));
+    if (statistics_requests.size() == 1) {
+        poller.PollReadable(0);
+        poller.TriggerReadable();
+    }
+
+    return promise;
+}
+
+bool Broker::HasReply() const {
+    if (control == nullptr) {
+        return false;
+    }
+
+    int32_t events = 0;
+    size_t events_size = sizeof(events);
+    while (zmq_getsockopt(control, ZMQ_EVENTS, &events, &events_size) < 0) {
+        if (zmq_errno() != EINTR) {
+            return false;
+        }
+    }
+
+    return (events & ZMQ_POLLIN) != 0;
+}
+
+void Broker::ReceiveStatistics() {
+    AsyncScope const scope(Env(), async_context);
+
+    if (statistics_requests.empty()) {
+        return;
+    }
+
+    if (!HasReply()) {
+        poller.PollReadable(0);
+        return;
+    }
+
+    auto requests = std::move(statistics_requests);
+    statistics_requests.clear();
+
+    /* The broker thread replies as soon as it has written the statistics,
+       which it does before handling any more messages. */
+    char reply = 0;
+    while (zmq_recv(control, &reply, 1, ZMQ_DONTWAIT) < 0) {
+        if (auto const error = zmq_errno(); error != EINTR) {
+            for (auto& request : requests) {
+                request.Reject(ErrnoException(Env(), error).Value());
+            }
+
+            return;
+        }
+    }
+
+    auto const& services = engine->Statistics();
+    for (auto& request : requests) {
+        auto result = Napi::Array::New(Env(), services.size());
+        for (uint32_t index = 0; index < services.size(); index++) {
+            auto const& service = services[index];
+
+            auto stats = Napi::Object::New(Env());
+            stats["service"] = Napi::String::New(Env(), service.name);
+            stats["workers"] = service.workers;
+            stats["idle"] = service.idle;
+            stats["queued"] = service.queued;
+            stats["requests"] = static_cast<double>(service.requests);
+            stats["replies"] = static_cast<double>(service.replies);
+            result[index] = stats;
+        }
+
+        request.Resolve(result);
+    }
+}
+
+Napi::Value Broker::GetSocket(const Napi::CallbackInfo& /*info*/) {
+    return socket_ref.Value();
+}
+
+void Broker::Initialize(Module& module, Napi::Object& exports) {
+    auto proto = {
+        InstanceMethod<&Broker::Run>("run"),
+        InstanceMethod<&Broker::Terminate>("terminate"),
+        InstanceMethod<&Broker::Statistics>("statistics"),
+
+        InstanceAccessor<&Broker::GetSocket>("socket"),
+    };
+
+    auto constructor = DefineClass(exports.Env(), "Broker", proto, &module);
+    module.Broker = Napi::Persistent(constructor);
+    exports.Set("Broker", constructor);
+}
+}  // namespace zmq
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <napi.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "./broker_engine.h"
+#include "./closable.h"
+#include "./poller.h"
+
+namespace zmq {
+class Module;
+
+class Broker : public Napi::ObjectWrap<Broker>, public Closable {
+public:
+    static void Initialize(Module& module, Napi::Object& exports);
+
+    explicit Broker(const Napi::CallbackInfo& info);
+
+    Broker(const Broker&) = delete;
+    Broker(Broker&&) = delete;
+    Broker& operator=(const Broker&) = delete;
+    Broker& operator=(Broker&&) = delete;
+    ~Broker() override;
+
+    void Close() override;
+
+protected:
+    inline Napi::Value Run(const Napi::CallbackInfo& info);
+    inline void Terminate(const Napi::CallbackInfo& info);
+    inline Napi::Value Statistics(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetSocket(const Napi::CallbackInfo& info);
+
+private:
+    inline void SendCommand(char command);
+
+    /* Resolves pending statistics requests once the broker has replied. */
+    [[nodiscard]] bool HasReply() const;
+    void ReceiveStatistics();
+
+    class Poller : public zmq::Poller<Poller> {
+        std::reference_wrapper<Broker> broker;
+
+    public:
+        explicit Poller(std::reference_wrapper<Broker> broker) : broker(broker) {}
+
+        [[nodiscard]] bool ValidateReadable() const {
+            return broker.get().HasReply();
+        }
+
+        [[nodiscard]] bool ValidateWritable() const {
+            return false;
+        }
+
+        void ReadableCallback() const {
+            broker.get().ReceiveStatistics();
+        }
+
+        void WritableCallback() const {}
+        void WakeupCallback() const {}
+    };
+
+    Napi::AsyncContext async_context;
+    Broker::Poller poller;
+    Napi::ObjectReference socket_ref;
+
+    /* Requests that wait for the statistics command that is in progress. The
+       engine overwrites its statistics for every command, so only one command
+       is sent at a time, and all waiting requests share its reply. */
+    std::deque<Napi::Promise::Deferred> statistics_requests;
+
+    Module& module;
+    std::shared_ptr<BrokerEngine> engine;
+    void* control = nullptr;
+    void* remote_control = nullptr;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::Broker>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::Broker>, "not movable");
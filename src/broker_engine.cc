@@ -0,0 +1,231 @@
+#include "./broker_engine.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+namespace zmq {
+/* Protocol headers and worker commands of 7/MDP. */
+static constexpr std::string_view client_header = "MDPC01";
+static constexpr std::string_view worker_header = "MDPW01";
+static constexpr std::string_view ready_command = "\x01";
+static constexpr std::string_view request_command = "\x02";
+static constexpr std::string_view reply_command = "\x03";
+static constexpr std::string_view heartbeat_command = "\x04";
+static constexpr std::string_view disconnect_command = "\x05";
+
+int32_t BrokerEngine::Run(void* target, void* control) {
+    /* Executed in the broker thread. Only the socket and the control socket
+       may be accessed here. */
+    socket = target;
+
+    auto const interval = std::chrono::milliseconds(heartbeat_interval);
+    auto next_heartbeat = Clock::now() + interval;
+
+    while (true) {
+        auto timeout = -1L;
+        if (heartbeat_interval > 0) {
+            auto const remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                next_heartbeat - Clock::now());
+            timeout = std::max(0L, static_cast<long>(remaining.count()));
+        }
+
+        std::array<zmq_pollitem_t, 2> items{{
+            {socket, 0, ZMQ_POLLIN, 0},
+            {control, 0, ZMQ_POLLIN, 0},
+        }};
+
+        if (zmq_poll(items.data(), items.size(), timeout) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+
+            return zmq_errno();
+        }
+
+        if ((items[1].revents & ZMQ_POLLIN) != 0) {
+            char command = 0;
+            while (zmq_recv(control, &command, 1, 0) < 0) {
+                if (zmq_errno() != EINTR) {
+                    return zmq_errno();
+                }
+            }
+
+            if (command == terminate_command) {
+                return 0;
+            }
+
+            WriteStatistics();
+            while (zmq_send(control, &command, 1, 0) < 0) {
+                if (zmq_errno() != EINTR) {
+                    return zmq_errno();
+                }
+            }
+        }
+
+        /* Handle all messages that have arrived. */
+        if ((items[0].revents & ZMQ_POLLIN) != 0) {
+            while (true) {
+                Frames msg;
+                auto const received = msg.Receive(socket);
+                if (received < 0) {
+                    return ETERM;
+                }
+
+                if (received == 0) {
+                    break;
+                }
+
+                Handle(msg);
+            }
+        }
+
+        if (heartbeat_interval > 0 && Clock::now() >= next_heartbeat) {
+            Heartbeat();
+            next_heartbeat = Clock::now() + interval;
+        }
+    }
+}
+
+void BrokerEngine::Handle(Frames& msg) {
+    /* Messages consist of the routing id, an empty delimiter, the protocol
+       header and at least one more part. Anything else is discarded. */
+    if (msg.Size() < 4 || !msg.Part(1).empty()) {
+        return;
+    }
+
+    if (msg.Part(2) == worker_header) {
+        HandleWorker(msg);
+        return;
+    }
+
+    if (msg.Part(2) == client_header) {
+        auto const name = std::string(msg.Part(3));
+        auto& service = services[name];
+        service.name = name;
+        service.received++;
+        service.requests.push_back(std::move(msg));
+        Dispatch(service);
+    }
+}
+
+void BrokerEngine::HandleWorker(Frames& msg) {
+    auto const identity = std::string(msg.Part(0));
+    auto const command = msg.Part(3);
+
+    auto iter = workers.find(identity);
+    if (iter == workers.end()) {
+        /* Unknown workers must register first. */
+        if (command == ready_command && msg.Size() >= 5) {
+            auto const name = std::string(msg.Part(4));
+            auto& service = services[name];
+            service.name = name;
+            service.workers++;
+
+            auto& worker = workers[identity];
+            worker.identity = identity;
+            worker.service = &service;
+            Ready(worker);
+        } else if (command != disconnect_command) {
+            Frames().Send(socket, {identity, "", worker_header, disconnect_command});
+        }
+
+        return;
+    }
+
+    auto& worker = iter->second;
+    auto& service = *worker.service;
+
+    /* Any message shows that the worker is alive. */
+    worker.expiry = Clock::now()
+        + std::chrono::milliseconds(heartbeat_interval * heartbeat_liveness);
+
+    if (command == reply_command && msg.Size() >= 6) {
+        /* Strip the worker envelope and return the reply to the client. */
+        msg.Send(socket, {msg.Part(4), "", client_header, service.name}, 6);
+        service.replied++;
+        Ready(worker);
+    } else if (command != heartbeat_command) {
+        /* A disconnect, or a protocol error. */
+        Delete(worker, command != disconnect_command);
+    }
+}
+
+void BrokerEngine::Ready(Worker& worker) {
+    worker.expiry = Clock::now()
+        + std::chrono::milliseconds(heartbeat_interval * heartbeat_liveness);
+
+    auto& service = *worker.service;
+    service.idle.push_back(&worker);
+    Dispatch(service);
+}
+
+void BrokerEngine::Dispatch(Service& service) {
+    /* Hand out requests to the workers that have been idle the longest. */
+    while (!service.idle.empty() && !service.requests.empty()) {
+        auto& worker = *service.idle.front();
+        service.idle.pop_front();
+
+        auto& request = service.requests.front();
+        if (!request.Send(socket,
+                {worker.identity, "", worker_header, request_command, request.Part(0),
+                    ""},
+                4)) {
+            /* The worker has disappeared; try the next one. */
+            Delete(worker, false);
+            continue;
+        }
+
+        service.requests.pop_front();
+    }
+}
+
+void BrokerEngine::Delete(Worker& worker, bool disconnect) {
+    if (disconnect) {
+        Frames().Send(socket, {worker.identity, "", worker_header, disconnect_command});
+    }
+
+    auto& service = *worker.service;
+    auto& idle = service.idle;
+    idle.erase(std::remove(idle.begin(), idle.end(), &worker), idle.end());
+    service.workers--;
+
+    auto const identity = worker.identity;
+    workers.erase(identity);
+}
+
+void BrokerEngine::Heartbeat() {
+    auto const now = Clock::now();
+
+    /* Busy workers are expected to keep sending heartbeats as well, so that a
+       worker that dies while handling a request is forgotten. Expired workers
+       are collected first, because deleting them invalidates iterators. */
+    std::vector<Worker*> expired;
+    for (auto& [identity, worker] : workers) {
+        if (worker.expiry < now) {
+            expired.push_back(&worker);
+        } else {
+            Frames().Send(socket, {identity, "", worker_header, heartbeat_command});
+        }
+    }
+
+    for (auto* worker : expired) {
+        Delete(*worker, false);
+    }
+}
+
+void BrokerEngine::WriteStatistics() {
+    statistics.clear();
+    statistics.reserve(services.size());
+
+    for (auto const& [name, service] : services) {
+        auto& stats = statistics.emplace_back();
+        stats.name = name;
+        stats.workers = service.workers;
+        stats.idle = static_cast<uint32_t>(service.idle.size());
+        stats.queued = static_cast<uint32_t>(service.requests.size());
+        stats.requests = service.received;
+        stats.replies = service.replied;
+    }
+}
+}  // namespace zmq
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./zmq_inc.h"
+#include "util/frames.h"
+
+namespace zmq {
+/* Brokers requests between clients and workers that are connected to one
+   ROUTER socket, following the Majordomo protocol (7/MDP). Workers register
+   for a service and are handed requests in least recently used order. While
+   a service has no idle workers, its requests are queued. All workers
+   receive heartbeats and are forgotten when they have not sent anything for
+   the given number of heartbeat intervals, whether they are idle or busy.
+   The socket is expected to be in mandatory mode, so that requests for
+   workers that have gone are handed to the next worker instead of being
+   dropped.
+
+   The engine runs in a native thread until it receives a terminate command
+   over its control socket. Statistics are also requested over the control
+   socket; the engine replies after writing them, so that they can be read
+   safely by the requesting thread. */
+class BrokerEngine {
+public:
+    /* Commands sent over the control socket. */
+    static constexpr char statistics_command = 'S';
+    static constexpr char terminate_command = 'T';
+
+    struct ServiceStatistics {
+        std::string name;
+        uint32_t workers = 0;
+        uint32_t idle = 0;
+        uint32_t queued = 0;
+        uint64_t requests = 0;
+        uint64_t replies = 0;
+    };
+
+    BrokerEngine(int64_t heartbeat_interval, uint32_t heartbeat_liveness)
+        : heartbeat_interval(heartbeat_interval),
+          heartbeat_liveness(heartbeat_liveness) {}
+
+    BrokerEngine(const BrokerEngine&) = delete;
+    BrokerEngine(BrokerEngine&&) = delete;
+    BrokerEngine& operator=(const BrokerEngine&) = delete;
+    BrokerEngine& operator=(BrokerEngine&&) = delete;
+    ~BrokerEngine() = default;
+
+    /* Brokers messages on the given socket until terminated. Returns 0, or
+       the ZMQ errno if the socket failed. */
+    int32_t Run(void* socket, void* control);
+
+    /* The statistics of all services, as written by the engine before it
+       replied to the last statistics command. */
+    [[nodiscard]] const std::vector<ServiceStatistics>& Statistics() const {
+        return statistics;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Service;
+
+    struct Worker {
+        std::string identity;
+        Service* service = nullptr;
+        Clock::time_point expiry;
+    };
+
+    struct Service {
+        std::string name;
+        std::deque<Worker*> idle;
+        std::deque<Frames> requests;
+        uint32_t workers = 0;
+        uint64_t received = 0;
+        uint64_t replied = 0;
+    };
+
+    void Handle(Frames& msg);
+    void HandleWorker(Frames& msg);
+    void Ready(Worker& worker);
+    void Dispatch(Service& service);
+    void Delete(Worker& worker, bool disconnect);
+    void Heartbeat();
+    void WriteStatistics();
+
+    int64_t heartbeat_interval;
+    uint32_t heartbeat_liveness;
+
+    void* socket = nullptr;
+    std::unordered_map<std::string, Service> services;
+    std::unordered_map<std::string, Worker> workers;
+    std::vector<ServiceStatistics> statistics;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::BrokerEngine>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::BrokerEngine>, "not movable");
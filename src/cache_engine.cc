@@ -0,0 +1,167 @@
+#include "./cache_engine.h"
+
+#include <array>
+#include <cerrno>
+
+namespace zmq {
+int32_t CacheEngine::Run(void* front_socket, void* back_socket, void* control) {
+    /* Executed in the cache thread. Only the sockets and the control socket
+       may be accessed here. */
+    front = front_socket;
+    back = back_socket;
+
+    int32_t verbose = 1;
+    if (zmq_setsockopt(back, ZMQ_XPUB_VERBOSE, &verbose, sizeof(verbose)) < 0) {
+        return zmq_errno();
+    }
+
+    for (auto const& topic : topics) {
+        auto const subscription = '\x01' + topic;
+        while (zmq_send(front, subscription.data(), subscription.size(), 0) < 0) {
+            if (zmq_errno() != EINTR) {
+                return zmq_errno();
+            }
+        }
+    }
+
+    while (true) {
+        std::array<zmq_pollitem_t, 3> items{{
+            {control, 0, ZMQ_POLLIN, 0},
+            {front, 0, ZMQ_POLLIN, 0},
+            {back, 0, ZMQ_POLLIN, 0},
+        }};
+
+        if (zmq_poll(items.data(), items.size(), -1) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+
+            return zmq_errno();
+        }
+
+        if ((items[0].revents & ZMQ_POLLIN) != 0) {
+            char command = 0;
+            while (zmq_recv(control, &command, 1, 0) < 0) {
+                if (zmq_errno() != EINTR) {
+                    return zmq_errno();
+                }
+            }
+
+            if (command == terminate_command) {
+                return 0;
+            }
+
+            current.topics = cache.size();
+            statistics = current;
+            while (zmq_send(control, &command, 1, 0) < 0) {
+                if (zmq_errno() != EINTR) {
+                    return zmq_errno();
+                }
+            }
+        }
+
+        /* Subscriptions are handled first. Otherwise a new subscriber could
+           receive a newer message twice: once when it is passed on, and once
+           more from the cache. */
+        if ((items[2].revents & ZMQ_POLLIN) != 0) {
+            while (true) {
+                Frames msg;
+                auto const received = msg.Receive(back);
+                if (received < 0) {
+                    return ETERM;
+                }
+
+                if (received == 0) {
+                    break;
+                }
+
+                Subscription(msg);
+            }
+        }
+
+        if ((items[1].revents & ZMQ_POLLIN) != 0) {
+            while (true) {
+                Frames msg;
+                auto const received = msg.Receive(front);
+                if (received < 0) {
+                    return ETERM;
+                }
+
+                if (received == 0) {
+                    break;
+                }
+
+                Store(msg);
+
+                /* XPUB sockets drop messages for subscribers that cannot
+                   accept them, so this never blocks. */
+                msg.Send(back);
+            }
+        }
+    }
+}
+
+void CacheEngine::Store(Frames& msg) {
+    auto const topic = msg.Part(0);
+
+    uint64_t size = topic.size();
+    for (size_t index = 1; index < msg.Size(); index++) {
+        size += msg.Part(index).size();
+    }
+
+    auto iter = cache.find(topic);
+    if (iter == cache.end()) {
+        iter = cache.emplace(std::string(topic), Entry{}).first;
+        iter->second.position = order.insert(order.end(), &iter->first);
+    } else {
+        current.bytes -= iter->second.size;
+        order.splice(order.end(), order, iter->second.position);
+    }
+
+    iter->second.msg = msg.Share();
+    iter->second.size = size;
+    current.bytes += size;
+
+    Evict();
+}
+
+void CacheEngine::Evict() {
+    /* The most recent message is always kept, even if it exceeds the limit on
+       its own. */
+    while (order.size() > 1
+        && (cache.size() > max_topics || current.bytes > max_bytes)) {
+        auto const iter = cache.find(*order.front());
+        current.bytes -= iter->second.size;
+        current.evictions++;
+
+        order.pop_front();
+        cache.erase(iter);
+    }
+}
+
+void CacheEngine::Subscription(Frames& msg) {
+    /* Subscriptions consist of a single part that starts with 1 to subscribe
+       or 0 to unsubscribe, followed by the prefix. */
+    auto const data = msg.Part(0);
+    if (msg.Size() == 1 && !data.empty() && data[0] == 1) {
+        Replay(data.substr(1));
+    }
+}
+
+void CacheEngine::Replay(std::string_view prefix) {
+    auto found = false;
+    for (auto iter = cache.lower_bound(prefix);
+         iter != cache.end() && iter->first.compare(0, prefix.size(), prefix) == 0;
+         iter++) {
+        iter->second.msg.Share().Send(back);
+        current.replayed++;
+        found = true;
+    }
+
+    if (found) {
+        current.hits++;
+    } else {
+        current.misses++;
+    }
+}
+}  // namespace zmq
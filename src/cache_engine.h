@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "./zmq_inc.h"
+#include "util/frames.h"
+
+namespace zmq {
+/* Passes on messages from an XSUB to an XPUB socket and keeps the last message
+   of every topic, which is the first part of a message. When a subscriber
+   subscribes, the cached messages of all topics that match the subscription
+   are sent again, so that the subscriber does not have to wait for the next
+   message of each topic. Other subscribers of those topics receive them as
+   well, because an XPUB socket cannot send to a single subscriber.
+
+   Like the last value cache of the guide, the XSUB socket subscribes to fixed
+   prefixes, so that topics are cached before anyone subscribes to them.
+   Subscriptions on the XPUB socket, which is switched to verbose mode to see
+   every subscription, only trigger replays and are not passed on.
+
+   The cache is bounded by a number of topics and a number of bytes; the least
+   recently updated topics are evicted first. Like the broker engine, the
+   engine runs in a native thread until it receives a terminate command over
+   its control socket, and writes statistics on request. */
+class CacheEngine {
+public:
+    /* Commands sent over the control socket. */
+    static constexpr char statistics_command = 'S';
+    static constexpr char terminate_command = 'T';
+
+    struct CacheStatistics {
+        uint64_t topics = 0;
+        uint64_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t replayed = 0;
+        uint64_t evictions = 0;
+    };
+
+    CacheEngine(std::vector<std::string> topics, uint64_t max_topics, uint64_t max_bytes)
+        : topics(std::move(topics)), max_topics(max_topics), max_bytes(max_bytes) {}
+
+    CacheEngine(const CacheEngine&) = delete;
+    CacheEngine(CacheEngine&&) = delete;
+    CacheEngine& operator=(const CacheEngine&) = delete;
+    CacheEngine& operator=(CacheEngine&&) = delete;
+    ~CacheEngine() = default;
+
+    /* Passes on messages until terminated. Returns 0, or the ZMQ errno if a
+       socket failed. */
+    int32_t Run(void* front, void* back, void* control);
+
+    /* The statistics as written by the engine before it replied to the last
+       statistics command. */
+    [[nodiscard]] const CacheStatistics& Statistics() const {
+        return statistics;
+    }
+
+private:
+    struct Entry {
+        Frames msg;
+        uint64_t size = 0;
+        std::list<const std::string*>::iterator position;
+    };
+
+    void Store(Frames& msg);
+    void Evict();
+    void Subscription(Frames& msg);
+    void Replay(std::string_view prefix);
+
+    std::vector<std::string> topics;
+    uint64_t max_topics;
+    uint64_t max_bytes;
+
+    void* front = nullptr;
+    void* back = nullptr;
+
+    /* Cached messages by topic, ordered to find all topics with a prefix. */
+    std::map<std::string, Entry, std::less<>> cache;
+
+    /* Topics from least to most recently updated. */
+    std::list<const std::string*> order;
+
+    CacheStatistics current;
+    CacheStatistics statistics;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::CacheEngine>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::CacheEngine>, "not movable");
@@ -0,0 +1,170 @@
+#include "./capture_proxy.h"
+
+#include <array>
+#include <cerrno>
+#include <string_view>
+
+namespace zmq {
+int32_t CaptureProxy::Run(void* control) {
+    auto up = Flow::Drained;
+    auto down = Flow::Drained;
+    auto pending = true;
+
+    while (true) {
+        if (pending && !paused) {
+            up = Transfer(front, back, front_counters, back_counters);
+            down = Transfer(back, front, back_counters, front_counters);
+            pending = false;
+        }
+
+        if (up == Flow::Terminated || down == Flow::Terminated) {
+            return ETERM;
+        }
+
+        /* Wait for messages on either socket, or for the socket that blocked a
+           transfer to accept messages again. */
+        auto const front_events = static_cast<int16_t>(
+            (up == Flow::Drained ? ZMQ_POLLIN : 0)
+            | (down == Flow::Blocked ? ZMQ_POLLOUT : 0));
+        auto const back_events = static_cast<int16_t>(
+            (down == Flow::Drained ? ZMQ_POLLIN : 0)
+            | (up == Flow::Blocked ? ZMQ_POLLOUT : 0));
+
+        std::array<zmq_pollitem_t, 3> items{{
+            {control, 0, ZMQ_POLLIN, 0},
+            {front, 0, paused ? int16_t{0} : front_events, 0},
+            {back, 0, paused ? int16_t{0} : back_events, 0},
+        }};
+
+        if (zmq_poll(items.data(), items.size(), -1) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+
+            return zmq_errno();
+        }
+
+        if ((items[0].revents & ZMQ_POLLIN) != 0) {
+            if (!Command(control)) {
+                return error;
+            }
+
+            pending = true;
+        }
+
+        if (items[1].revents != 0 || items[2].revents != 0) {
+            pending = true;
+        }
+    }
+}
+
+Flow CaptureProxy::Transfer(void* from, void* to, Counters& in, Counters& out) {
+    while (true) {
+        auto const events = Events(to);
+        if (events < 0) {
+            return Flow::Terminated;
+        }
+
+        if ((events & ZMQ_POLLOUT) == 0) {
+            return Flow::Blocked;
+        }
+
+        Frames msg;
+        auto const received = msg.Receive(from);
+        if (received <= 0) {
+            return received < 0 ? Flow::Terminated : Flow::Drained;
+        }
+
+        /* Like zmq_proxy_steerable(), count every message part. */
+        uint64_t bytes = 0;
+        for (size_t index = 0; index < msg.Size(); index++) {
+            bytes += msg.Part(index).size();
+        }
+
+        in.messages_in += msg.Size();
+        in.bytes_in += bytes;
+
+        /* Copy before sending, because sending releases the parts. */
+        Capture(msg);
+
+        /* Messages that cannot be sent in the current state of the socket are
+           discarded, like in Forward(). */
+        auto const parts = msg.Size();
+        if (msg.Send(to)) {
+            out.messages_out += parts;
+            out.bytes_out += bytes;
+        }
+    }
+}
+
+void CaptureProxy::Capture(Frames& msg) {
+    if (!filter.prefix.empty()) {
+        if (filter.part >= msg.Size()) {
+            return;
+        }
+
+        auto const part = msg.Part(filter.part);
+        if (part.substr(0, filter.prefix.size()) != filter.prefix) {
+            return;
+        }
+    }
+
+    /* Copy every n-th selected message, starting with the n-th. */
+    if (++selected < filter.sample) {
+        return;
+    }
+
+    selected = 0;
+
+    /* The copy is dropped if the capture socket cannot accept it. */
+    msg.Copy(capture, filter.truncate);
+}
+
+bool CaptureProxy::Command(void* control) {
+    std::array<char, 16> command{};
+    auto size = zmq_recv(control, command.data(), command.size(), ZMQ_DONTWAIT);
+    if (size < 0) {
+        if (zmq_errno() == EINTR || zmq_errno() == EAGAIN) {
+            return true;
+        }
+
+        error = zmq_errno();
+        return false;
+    }
+
+    auto const name = std::string_view(command.data(),
+        std::min(static_cast<size_t>(size), command.size()));
+
+    if (name == "PAUSE") {
+        paused = true;
+    } else if (name == "RESUME") {
+        paused = false;
+    } else if (name == "TERMINATE") {
+        return false;
+    } else if (name == "STATISTICS") {
+        std::array<uint64_t, 8> const values{
+            front_counters.messages_in,
+            front_counters.bytes_in,
+            front_counters.messages_out,
+            front_counters.bytes_out,
+            back_counters.messages_in,
+            back_counters.bytes_in,
+            back_counters.messages_out,
+            back_counters.bytes_out,
+        };
+
+        for (size_t index = 0; index < values.size(); index++) {
+            auto const flags = index + 1 < values.size() ? ZMQ_SNDMORE : 0;
+            while (zmq_send(control, &values.at(index), sizeof(uint64_t), flags) < 0) {
+                if (zmq_errno() != EINTR) {
+                    error = zmq_errno();
+                    return false;
+                }
+            }
+        }
+    }
+
+    /* Unknown commands are ignored, like by zmq_proxy_steerable(). */
+    return true;
+}
+}  // namespace zmq
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "./zmq_inc.h"
+#include "util/forward.h"
+#include "util/frames.h"
+
+namespace zmq {
+/* Proxies messages between a front-end and a back-end socket like
+   zmq_proxy_steerable(), and copies a selection of the messages to a capture
+   socket. Messages are selected by a prefix of one of their parts, and then
+   sampled, so that only every n-th selected message is copied. Copied parts
+   can be truncated to a maximum length.
+
+   Unlike zmq_proxy_steerable(), a capture socket that cannot accept more
+   messages never holds up the proxy; the copies are dropped instead. The
+   control socket accepts the same commands as zmq_proxy_steerable(). */
+class CaptureProxy {
+public:
+    struct Filter {
+        uint32_t sample = 1;
+        uint32_t part = 0;
+        std::string prefix;
+        uint32_t truncate = UINT32_MAX;
+    };
+
+    CaptureProxy(void* front, void* back, void* capture, Filter filter)
+        : front(front), back(back), capture(capture), filter(std::move(filter)) {}
+
+    CaptureProxy(const CaptureProxy&) = delete;
+    CaptureProxy(CaptureProxy&&) = delete;
+    CaptureProxy& operator=(const CaptureProxy&) = delete;
+    CaptureProxy& operator=(CaptureProxy&&) = delete;
+    ~CaptureProxy() = default;
+
+    /* Proxies messages until terminated. Returns 0, or the ZMQ errno if a
+       socket failed. */
+    int32_t Run(void* control);
+
+private:
+    /* Message parts and bytes received from and sent to a socket. */
+    struct Counters {
+        uint64_t messages_in = 0;
+        uint64_t bytes_in = 0;
+        uint64_t messages_out = 0;
+        uint64_t bytes_out = 0;
+    };
+
+    [[nodiscard]] Flow Transfer(void* from, void* to, Counters& in, Counters& out);
+    void Capture(Frames& msg);
+    [[nodiscard]] bool Command(void* control);
+
+    void* front;
+    void* back;
+    void* capture;
+    Filter filter;
+
+    Counters front_counters;
+    Counters back_counters;
+    uint32_t selected = 0;
+    bool paused = false;
+    int32_t error = 0;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::CaptureProxy>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::CaptureProxy>, "not movable");
@@ -0,0 +1,53 @@
+#include "./conflater.h"
+
+#include <cassert>
+#include <cerrno>
+
+namespace zmq {
+int32_t Conflater::Drain(void* socket, uint32_t limit) {
+    for (uint32_t count = 0; count < limit; count++) {
+        Parts parts;
+        while (true) {
+            auto& part = parts.emplace_back(std::make_unique<IncomingMsg>());
+            while (zmq_msg_recv(part->get(), socket, ZMQ_DONTWAIT) < 0) {
+                if (zmq_errno() != EINTR) {
+                    /* All parts of a message arrive together, so only the
+                       first part can be missing. */
+                    return zmq_errno() == EAGAIN ? 0 : zmq_errno();
+                }
+            }
+
+            if (zmq_msg_more(part->get()) == 0) {
+                break;
+            }
+        }
+
+        auto* first = parts.front()->get();
+        std::string topic(static_cast<char*>(zmq_msg_data(first)), zmq_msg_size(first));
+
+        auto [iter, inserted] = latest.try_emplace(std::move(topic));
+        if (inserted) {
+            order.push_back(&iter->first);
+        } else {
+            conflated++;
+        }
+
+        iter->second = std::move(parts);
+    }
+
+    return 0;
+}
+
+Conflater::Parts Conflater::Pop() {
+    assert(!order.empty());
+
+    auto node = latest.extract(*order.front());
+    order.pop_front();
+    return std::move(node.mapped());
+}
+
+void Conflater::Clear() {
+    order.clear();
+    latest.clear();
+}
+}  // namespace zmq
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./incoming_msg.h"
+
+namespace zmq {
+/* Keeps only the latest message of every topic received by a subscriber
+   socket. The topic of a message is its first part. Topics are handed out in
+   the order in which they were first updated since they were last handed out,
+   so a consumer that falls behind catches up with one message per topic,
+   instead of having to work through every message it missed. */
+class Conflater {
+public:
+    using Parts = std::vector<std::unique_ptr<IncomingMsg>>;
+
+    Conflater() = default;
+
+    Conflater(const Conflater&) = delete;
+    Conflater(Conflater&&) = delete;
+    Conflater& operator=(const Conflater&) = delete;
+    Conflater& operator=(Conflater&&) = delete;
+    ~Conflater() = default;
+
+    /* Receives the messages that are queued on the socket, up to the given
+       limit. Returns 0 once the socket has no more messages, or the ZMQ errno
+       if receiving failed. */
+    int32_t Drain(void* socket, uint32_t limit);
+
+    /* Removes and returns the latest message of the topic that was updated
+       first. Must not be called if there are no messages. */
+    Parts Pop();
+
+    void Clear();
+
+    [[nodiscard]] bool Empty() const {
+        return order.empty();
+    }
+
+    /* Number of messages that were replaced by a newer message of the same
+       topic before they were handed out. */
+    [[nodiscard]] uint64_t Conflated() const {
+        return conflated;
+    }
+
+private:
+    /* Latest message of every topic that was not handed out yet. */
+    std::unordered_map<std::string, Parts> latest;
+
+    /* Topics in the order in which they were first updated. These refer to
+       the keys of the map, which stay in place until they are removed. */
+    std::deque<const std::string*> order;
+
+    uint64_t conflated = 0;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::Conflater>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::Conflater>, "not movable");
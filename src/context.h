@@ -32,6 +32,8 @@ private:
     Module& module;
     void* context = nullptr;
 
+    friend class Broker;
+    friend class LastValueCache;
     friend class Socket;
     friend class Observer;
     friend class Proxy;
@@ -0,0 +1,406 @@
+#include "./dispatcher.h"
+
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "util/forward.h"
+#include "util/frames.h"
+#include "util/hash.h"
+
+namespace zmq {
+/* Commands sent over the control socket. */
+auto constexpr terminate_command = 'T';
+
+/* All parts of a message that is waiting for a worker. */
+class Task : public Frames {
+public:
+    /* Whether the message may be handled by a worker of another slot. */
+    bool stealable = true;
+};
+
+/* Queues and workers of all slots. Only accessed by the dispatcher thread. */
+class Schedule {
+    struct Worker {
+        bool attached = false;
+        std::string peer;
+        std::deque<Task> queue;
+        uint32_t credit = 0;
+    };
+
+    std::vector<Dispatcher::Slot>& slots;
+    std::vector<Worker> workers;
+    size_t queue_capacity;
+    bool affinity;
+
+public:
+    Schedule(std::vector<Dispatcher::Slot>& slots, uint32_t queue_capacity, bool affinity)
+        : slots(slots), workers(slots.size()), queue_capacity(queue_capacity),
+          affinity(affinity) {}
+
+    /* Queues a message at a slot. Returns false and leaves the message in
+       place if the queue of the selected slot is full. */
+    bool Route(std::optional<Task>& task) {
+        auto index = workers.size();
+
+        auto const key = affinity ? task->Part(0) : std::string_view{};
+        if (!key.empty()) {
+            task->stealable = false;
+            index = Hash(key) % workers.size();
+            if (workers[index].queue.size() >= queue_capacity) {
+                return false;
+            }
+        } else {
+            index = LeastLoaded();
+            if (index == workers.size()) {
+                return false;
+            }
+        }
+
+        workers[index].queue.push_back(std::move(*task));
+        task.reset();
+        Update(index);
+        return true;
+    }
+
+    /* Sends queued messages to workers that are ready for them. Returns true
+       if any message was sent. */
+    bool Dispatch(void* back) {
+        auto sent = false;
+        for (size_t index = 0; index < workers.size(); index++) {
+            auto& worker = workers[index];
+            while (worker.attached && worker.credit > 0) {
+                auto const source = worker.queue.empty() ? Victim(index) : index;
+                if (source == workers.size()) {
+                    break;
+                }
+
+                /* Workers take messages from the front of their own queue, and
+                   steal from the back of other queues. */
+                auto& queue = workers[source].queue;
+                auto const own = source == index;
+                Task task(std::move(own ? queue.front() : queue.back()));
+                if (own) {
+                    queue.pop_front();
+                } else {
+                    queue.pop_back();
+                }
+
+                if (!task.Send(back, worker.peer)) {
+                    auto const error = zmq_errno();
+                    if (own) {
+                        queue.push_front(std::move(task));
+                    } else {
+                        queue.push_back(std::move(task));
+                    }
+
+                    /* Try again later if the worker is merely busy. */
+                    if (error == EHOSTUNREACH) {
+                        Detach(index);
+                    }
+
+                    break;
+                }
+
+                Update(source);
+                if (!own) {
+                    slots[index].stolen.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                worker.credit--;
+                Begin(index);
+                sent = true;
+            }
+        }
+
+        return sent;
+    }
+
+    /* Handles a command from a worker. */
+    void Command(std::string_view peer, std::string_view command) {
+        auto index = Find(peer);
+
+        if (command.size() == 1 && command[0] == Dispatcher::ready_command) {
+            if (index == workers.size()) {
+                index = Attach(peer);
+                if (index == workers.size()) {
+                    /* All slots are taken; the worker will receive nothing. */
+                    return;
+                }
+            }
+
+            /* A ready command also signals completion of a previous message. */
+            if (slots[index].active.load(std::memory_order_relaxed) > 0) {
+                End(index);
+            }
+
+            workers[index].credit++;
+            return;
+        }
+
+        if (command.size() == 1 && command[0] == Dispatcher::leave_command
+            && index < workers.size()) {
+            Detach(index);
+        }
+    }
+
+private:
+    void Update(size_t index) {
+        auto const queued = static_cast<uint32_t>(workers[index].queue.size());
+        slots[index].queued.store(queued, std::memory_order_relaxed);
+    }
+
+    /* Returns the slot with room in its queue that has the least messages
+       queued and in progress, preferring slots with a worker. Returns the
+       number of slots if all queues are full. */
+    [[nodiscard]] size_t LeastLoaded() const {
+        auto best = workers.size();
+        auto best_load = std::pair<bool, size_t>{};
+
+        for (size_t index = 0; index < workers.size(); index++) {
+            auto const& worker = workers[index];
+            if (worker.queue.size() >= queue_capacity) {
+                continue;
+            }
+
+            auto const active = slots[index].active.load(std::memory_order_relaxed);
+            auto const load =
+                std::pair<bool, size_t>{!worker.attached, worker.queue.size() + active};
+            if (best == workers.size() || load < best_load) {
+                best = index;
+                best_load = load;
+            }
+        }
+
+        return best;
+    }
+
+    /* Returns the slot with the longest queue that can be stolen from by the
+       given slot, or the number of slots if there is none. */
+    [[nodiscard]] size_t Victim(size_t thief) const {
+        auto victim = workers.size();
+        size_t longest = 0;
+
+        for (size_t index = 0; index < workers.size(); index++) {
+            auto const& worker = workers[index];
+            if (index == thief || worker.queue.size() <= longest
+                || !worker.queue.back().stealable
+                || (worker.attached && worker.credit > 0)) {
+                continue;
+            }
+
+            victim = index;
+            longest = worker.queue.size();
+        }
+
+        return victim;
+    }
+
+    [[nodiscard]] size_t Find(std::string_view peer) const {
+        for (size_t index = 0; index < workers.size(); index++) {
+            if (workers[index].attached && workers[index].peer == peer) {
+                return index;
+            }
+        }
+
+        return workers.size();
+    }
+
+    size_t Attach(std::string_view peer) {
+        for (size_t index = 0; index < workers.size(); index++) {
+            if (!workers[index].attached) {
+                workers[index].attached = true;
+                workers[index].peer = peer;
+                slots[index].attached.store(true, std::memory_order_relaxed);
+                return index;
+            }
+        }
+
+        return workers.size();
+    }
+
+    /* Frees the slot of a worker that left or disappeared. Its queue is kept
+       for the next worker that attaches, unless it is stolen before. */
+    void Detach(size_t index) {
+        auto& worker = workers[index];
+        worker.attached = false;
+        worker.peer.clear();
+        worker.credit = 0;
+
+        /* Messages in progress are lost with the worker. */
+        if (slots[index].active.exchange(0, std::memory_order_relaxed) > 0) {
+            Idle(index);
+        }
+
+        slots[index].attached.store(false, std::memory_order_relaxed);
+    }
+
+    void Begin(size_t index) {
+        auto& slot = slots[index];
+        if (slot.active.fetch_add(1, std::memory_order_relaxed) == 0) {
+            slot.busy_since.store(Dispatcher::Now(), std::memory_order_relaxed);
+        }
+    }
+
+    void End(size_t index) {
+        auto& slot = slots[index];
+        slot.processed.fetch_add(1, std::memory_order_relaxed);
+        if (slot.active.fetch_sub(1, std::memory_order_relaxed) == 1) {
+            Idle(index);
+        }
+    }
+
+    void Idle(size_t index) {
+        auto& slot = slots[index];
+        auto const since = slot.busy_since.exchange(0, std::memory_order_relaxed);
+        slot.busy_nanos.fetch_add(Dispatcher::Now() - since, std::memory_order_relaxed);
+    }
+};
+
+Dispatcher::~Dispatcher() {
+    Stop();
+}
+
+int32_t Dispatcher::Start(void* context, const std::string& front_address,
+    const std::string& back_address, uint32_t workers, uint32_t queue_capacity,
+    bool affinity) {
+    assert(!Active());
+    assert(workers > 0);
+
+    auto const control_address = back_address + ".control";
+
+    const auto error = [this]() {
+        auto const err = zmq_errno();
+        CloseSocket(front);
+        CloseSocket(back);
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        errno = err;
+        return -1;
+    };
+
+    front = zmq_socket(context, ZMQ_PULL);
+    back = zmq_socket(context, ZMQ_ROUTER);
+    control = zmq_socket(context, ZMQ_PAIR);
+    remote_control = zmq_socket(context, ZMQ_PAIR);
+
+    if (front == nullptr || back == nullptr || control == nullptr
+        || remote_control == nullptr) {
+        return error();
+    }
+
+    /* Report messages for workers that have disappeared, so that they can be
+       queued again instead of being dropped silently. */
+    int32_t mandatory = 1;
+    if (zmq_setsockopt(back, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory)) < 0) {
+        return error();
+    }
+
+    if (zmq_bind(front, front_address.c_str()) < 0
+        || zmq_bind(back, back_address.c_str()) < 0
+        || zmq_bind(remote_control, control_address.c_str()) < 0
+        || zmq_connect(control, control_address.c_str()) < 0) {
+        return error();
+    }
+
+    slots = std::vector<Slot>(workers);
+    this->queue_capacity = queue_capacity;
+    this->affinity = affinity;
+    started = Now();
+
+    thread = std::thread([this]() { Run(); });
+    return 0;
+}
+
+void Dispatcher::Stop() {
+    if (!Active()) {
+        return;
+    }
+
+    while (zmq_send(control, &terminate_command, 1, 0) < 0) {
+        if (zmq_errno() != EINTR) {
+            break;
+        }
+    }
+
+    thread.join();
+    CloseSocket(control);
+}
+
+void Dispatcher::Run() {
+    /* Executed in the dispatcher thread. Only the front-end, the back-end and
+       the remote control socket may be accessed here. */
+    Schedule schedule(slots, queue_capacity, affinity);
+    std::optional<Task> parked;
+
+    auto running = true;
+    while (running) {
+        /* Take messages from the front-end for as long as they can be queued,
+           and pass them on as soon as workers are ready for them. A message
+           that cannot be queued is parked until its queue has room again. */
+        auto progress = true;
+        while (progress && running) {
+            progress = schedule.Dispatch(back);
+
+            while (true) {
+                if (!parked) {
+                    Task task;
+                    auto const received = task.Receive(front);
+                    if (received <= 0) {
+                        running = received == 0;
+                        break;
+                    }
+
+                    parked.emplace(std::move(task));
+                }
+
+                if (!schedule.Route(parked)) {
+                    break;
+                }
+
+                progress = true;
+            }
+        }
+
+        std::array<zmq_pollitem_t, 3> items{{
+            {front, 0, static_cast<int16_t>(parked ? 0 : ZMQ_POLLIN), 0},
+            {back, 0, ZMQ_POLLIN, 0},
+            {remote_control, 0, ZMQ_POLLIN, 0},
+        }};
+
+        if (!running || zmq_poll(items.data(), items.size(), -1) < 0) {
+            if (running && zmq_errno() == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        if ((items[2].revents & ZMQ_POLLIN) != 0) {
+            break;
+        }
+
+        /* Commands from workers consist of their routing id and one part. */
+        while (running) {
+            Task command;
+            auto const received = command.Receive(back);
+            if (received <= 0) {
+                running = received == 0;
+                break;
+            }
+
+            if (command.Size() == 2) {
+                schedule.Command(command.Part(0), command.Part(1));
+            }
+        }
+    }
+
+    CloseSocket(front);
+    CloseSocket(back);
+    CloseSocket(remote_control);
+}
+}  // namespace zmq
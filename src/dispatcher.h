@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./zmq_inc.h"
+
+namespace zmq {
+/* Distributes messages from a PULL socket over a fixed number of worker slots
+   on a dedicated native thread. Workers attach to a slot by connecting a
+   DEALER socket to the ROUTER back-end and sending a ready command for every
+   message they can accept. Each slot has a bounded queue of messages that
+   wait for its worker; when all queues are full, no more messages are taken
+   from the front-end, so that senders block at their high water mark.
+
+   Messages are queued at the least loaded slot. Idle workers with an empty
+   queue steal the most recently queued message of the longest other queue.
+   With affinity enabled, the first part of a message is a key that selects
+   the slot; keyed messages are never stolen, so that all messages with the
+   same key are handled by one worker, in order. Messages with an empty key
+   are distributed as if affinity was disabled. */
+class Dispatcher {
+public:
+    /* Commands sent by workers to the back-end. */
+    static constexpr char ready_command = 'R';
+    static constexpr char leave_command = 'L';
+
+    /* Statistics of a worker slot. Written by the dispatcher thread and read
+       by any other thread. */
+    struct Slot {
+        std::atomic<bool> attached{false};
+        std::atomic<uint32_t> queued{0};
+        std::atomic<uint32_t> active{0};
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<int64_t> busy_nanos{0};
+        std::atomic<int64_t> busy_since{0};
+    };
+
+    Dispatcher() = default;
+
+    Dispatcher(const Dispatcher&) = delete;
+    Dispatcher(Dispatcher&&) = delete;
+    Dispatcher& operator=(const Dispatcher&) = delete;
+    Dispatcher& operator=(Dispatcher&&) = delete;
+    ~Dispatcher();
+
+    /* Bind the front-end and back-end and start the dispatcher thread. Returns
+       -1 and sets the ZMQ errno on failure. */
+    int32_t Start(void* context, const std::string& front_address,
+        const std::string& back_address, uint32_t workers, uint32_t queue_capacity,
+        bool affinity);
+
+    /* Stop the dispatcher thread and close all sockets. Queued messages are
+       discarded. */
+    void Stop();
+
+    [[nodiscard]] bool Active() const {
+        return control != nullptr;
+    }
+
+    [[nodiscard]] const std::vector<Slot>& Slots() const {
+        return slots;
+    }
+
+    /* Nanoseconds of a monotonic clock, used for utilisation statistics. */
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    [[nodiscard]] int64_t Started() const {
+        return started;
+    }
+
+private:
+    void Run();
+
+    std::thread thread;
+
+    void* front = nullptr;
+    void* back = nullptr;
+    void* control = nullptr;
+    void* remote_control = nullptr;
+
+    std::vector<Slot> slots;
+    uint32_t queue_capacity = 0;
+    bool affinity = false;
+    int64_t started = 0;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::Dispatcher>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::Dispatcher>, "not movable");
@@ -0,0 +1,131 @@
+#include "./identity_cache.h"
+
+namespace zmq {
+namespace {
+/* Returns whether the data is well-formed UTF-8, which survives decoding to a
+   string and encoding it again unchanged. */
+bool IsUtf8(std::string_view data) {
+    size_t index = 0;
+    while (index < data.size()) {
+        auto const lead = static_cast<uint8_t>(data[index]);
+        if (lead < 0x80U) {
+            index++;
+            continue;
+        }
+
+        /* The range of the first continuation byte excludes overlong forms,
+           surrogates and code points beyond U+10FFFF. */
+        size_t length = 0;
+        auto low = uint8_t{0x80};
+        auto high = uint8_t{0xBF};
+        if (lead >= 0xC2U && lead <= 0xDFU) {
+            length = 2;
+        } else if (lead >= 0xE0U && lead <= 0xEFU) {
+            length = 3;
+            low = lead == 0xE0U ? 0xA0 : low;
+            high = lead == 0xEDU ? 0x9F : high;
+        } else if (lead >= 0xF0U && lead <= 0xF4U) {
+            length = 4;
+            low = lead == 0xF0U ? 0x90 : low;
+            high = lead == 0xF4U ? 0x8F : high;
+        } else {
+            return false;
+        }
+
+        if (data.size() - index < length) {
+            return false;
+        }
+
+        for (size_t offset = 1; offset < length; offset++) {
+            auto const byte = static_cast<uint8_t>(data[index + offset]);
+            if (byte < low || byte > high) {
+                return false;
+            }
+
+            low = 0x80;
+            high = 0xBF;
+        }
+
+        index += length;
+    }
+
+    return true;
+}
+}  // namespace
+
+Napi::Value IdentityCache::Get(const Napi::Env& env, zmq_msg_t* msg) {
+    auto const id = std::string_view{
+        static_cast<char*>(zmq_msg_data(msg)), zmq_msg_size(msg)};
+
+    if (auto iter = entries.find(id); iter != entries.end()) {
+        order.splice(order.end(), order, iter->second.position);
+        return values.Value().Get(iter->second.slot);
+    }
+
+    /* Routing ids that would not survive the conversion to a string are
+       interned as buffers instead, so that they can be sent to again. */
+    auto const value = mode == Mode::String && IsUtf8(id)
+        ? Napi::String::New(env, id.data(), id.size()).As<Napi::Value>()
+        : Napi::Buffer<char>::Copy(env, id.data(), id.size()).As<Napi::Value>();
+
+    if (values.IsEmpty()) {
+        values = Napi::Persistent(Napi::Array::New(env).As<Napi::Object>());
+    }
+
+    uint32_t slot = 0;
+    if (free_slots.empty()) {
+        slot = next_slot++;
+    } else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+
+    values.Value().Set(slot, value);
+
+    auto const iter = entries.emplace(std::string(id), Entry{slot, {}}).first;
+    iter->second.position = order.insert(order.end(), &iter->first);
+
+    /* The routing id that was just added is always kept. */
+    while (entries.size() > capacity && order.size() > 1) {
+        Remove(entries.find(*order.front()));
+    }
+
+    return value;
+}
+
+bool IdentityCache::Forget(std::string_view id) {
+    auto const iter = entries.find(id);
+    if (iter == entries.end()) {
+        return false;
+    }
+
+    Remove(iter);
+    return true;
+}
+
+void IdentityCache::SetMode(Mode value) {
+    if (value != mode) {
+        Clear();
+    }
+
+    mode = value;
+}
+
+void IdentityCache::Clear() {
+    order.clear();
+    entries.clear();
+    free_slots.clear();
+    next_slot = 0;
+    values.Reset();
+}
+
+void IdentityCache::Remove(Entries::iterator iter) {
+    /* The slot is reused by the next routing id, so the array stays as large
+       as the largest number of routing ids interned at once. */
+    values.Value().Set(iter->second.slot, values.Env().Undefined());
+    free_slots.push_back(iter->second.slot);
+
+    order.erase(iter->second.position);
+    entries.erase(iter);
+}
+}  // namespace zmq
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "./zmq_inc.h"
+#include "util/hash.h"
+
+namespace zmq {
+/* Interns the routing ids received by a ROUTER socket, so that every message
+   from the same peer carries the same JS value, instead of a new buffer that
+   is typically turned into a string right away. The set of peers is usually
+   small and stable, so after warming up a routing id is looked up by its
+   bytes without allocating anything.
+
+   The cache is bounded; the least recently seen routing ids are evicted
+   first. Routing ids can also be forgotten explicitly, for example when the
+   application learns that a peer has gone. */
+class IdentityCache {
+public:
+    enum class Mode : uint8_t {
+        Disabled, /* Routing ids are received as new buffers. */
+        Buffer, /* Routing ids are interned as buffers. */
+        String, /* Routing ids are interned as strings if they are UTF-8. */
+    };
+
+    explicit IdentityCache(size_t capacity) : capacity(capacity) {}
+
+    IdentityCache(const IdentityCache&) = delete;
+    IdentityCache(IdentityCache&&) = delete;
+    IdentityCache& operator=(const IdentityCache&) = delete;
+    IdentityCache& operator=(IdentityCache&&) = delete;
+    ~IdentityCache() = default;
+
+    /* Returns the interned value of the routing id in the given message. Must
+       not be called if the cache is disabled. */
+    Napi::Value Get(const Napi::Env& env, zmq_msg_t* msg);
+
+    /* Removes the given routing id. Returns whether it was cached. */
+    bool Forget(std::string_view id);
+
+    /* Changes the mode. Interned values of another mode are discarded. */
+    void SetMode(Mode value);
+
+    void Clear();
+
+    [[nodiscard]] Mode GetMode() const {
+        return mode;
+    }
+
+    [[nodiscard]] bool Enabled() const {
+        return mode != Mode::Disabled;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        uint32_t slot;
+        std::list<const std::string*>::iterator position;
+    };
+
+    /* Allows lookups by the message data without copying it into a key. */
+    struct KeyHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view key) const {
+            return static_cast<size_t>(Mix(Hash(key)));
+        }
+    };
+
+    size_t capacity;
+    Mode mode = Mode::Disabled;
+
+    using Entries = std::unordered_map<std::string, Entry, KeyHash, std::equal_to<>>;
+
+    void Remove(Entries::iterator iter);
+
+    Entries entries;
+
+    /* The interned values, at the slot of their entry. Strings are primitives,
+       which older Node-API versions cannot reference directly, so all values
+       are kept in a single array instead. Slots of removed routing ids are
+       reused. */
+    Napi::ObjectReference values;
+    std::vector<uint32_t> free_slots;
+    uint32_t next_slot = 0;
+
+    /* Routing ids from least to most recently seen. These refer to the keys
+       of the map, which stay in place until they are removed. */
+    std::list<const std::string*> order;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::IdentityCache>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::IdentityCache>, "not movable");
@@ -60,6 +60,17 @@ Napi::Value IncomingMsg::IntoBuffer(const Napi::Env& env) {
     return Napi::Buffer<uint8_t>::New(env, 0).As<Napi::Value>();
 }
 
+Napi::Value IncomingMsg::IntoHandle(
+    const Napi::Env& env, Registry<IncomingMsg>& registry) {
+    /* Moving the message does not copy its contents. */
+    auto msg = std::make_unique<IncomingMsg>();
+    [[maybe_unused]] auto err = zmq_msg_move(msg->get(), ref->get());
+    assert(err == 0);
+
+    auto const handle = registry.Add(std::move(msg));
+    return Napi::Number::New(env, static_cast<double>(handle));
+}
+
 IncomingMsg::Reference::Reference() {
     [[maybe_unused]] auto err = zmq_msg_init(&msg);
     assert(err == 0);
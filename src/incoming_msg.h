@@ -3,6 +3,7 @@
 #include <napi.h>
 
 #include "./zmq_inc.h"
+#include "util/registry.h"
 
 namespace zmq {
 class IncomingMsg {
@@ -17,6 +18,10 @@ public:
 
     Napi::Value IntoBuffer(const Napi::Env& env);
 
+    /* Moves the message into the registry, so that it can be adopted by any
+       agent/thread with IntoBuffer(). Returns the handle as a JS number. */
+    Napi::Value IntoHandle(const Napi::Env& env, Registry<IncomingMsg>& registry);
+
     zmq_msg_t* get() {
         return ref->get();
     }
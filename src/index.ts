@@ -1,17 +1,33 @@
-import {allowMethods} from "./util"
+import {allowMethods, moveMembers} from "./util"
 
 export {
+  adoptMessage,
   capability,
   context,
   curveKeyPair,
+  releaseMessage,
   version,
+  Broker,
+  BrokerStatistics,
   Context,
   Event,
   EventOfType,
   EventType,
+  LastValueCache,
+  LastValueCacheStatistics,
+  MessageHandle,
   Socket,
+  SocketHandle,
   Observer,
   Proxy,
+  ProxyCapture,
+  ProxyGroup,
+  ProxySocketStatistics,
+  ProxyStatistics,
+  ShardProxy,
+  WorkerPool,
+  WorkerStatistics,
+  MemoryChannel,
 } from "./native"
 
 import {
@@ -19,6 +35,8 @@ import {
   Context,
   EventOfType,
   EventType,
+  MemoryChannel,
+  MessageHandle,
   Observer,
   Options,
   ReadableKeys,
@@ -27,6 +45,9 @@ import {
   WritableKeys,
 } from "./native"
 
+export {createRing, pumpIntoRing, RingReader} from "./ring"
+export {PoolWorker} from "./worker-pool"
+
 import * as draft from "./draft"
 import {FullError} from "./errors"
 
@@ -100,6 +121,24 @@ export interface Writable<
    */
   sendTimeout: number
 
+  /**
+   * Maximum number of bytes of messages that may be queued by concurrent calls
+   * to {@link send}() while the socket is not writable. The default of 0
+   * disables queueing, which means only one call to {@link send}() may be in
+   * progress at any time.
+   *
+   * The first pending message is always accepted, regardless of its size.
+   */
+  sendQueueCapacity: number
+
+  /**
+   * Number of bytes of messages passed to {@link send}() that are still
+   * waiting to be queued on the socket.
+   *
+   * @readonly
+   */
+  readonly sendQueueSize: number
+
   /**
    * Sends a single message or a multipart message on the socket. Queues the
    * message immediately if possible, and returns a resolved promise. If the
@@ -118,9 +157,9 @@ export interface Writable<
    * A call to {@link send}() is guaranteed to return with a resolved promise
    * immediately if the message could be queued directly.
    *
-   * Only **one** asynchronously blocking call to {@link send}() may be executed
-   * simultaneously. If you call {@link send}() again on a socket that is in the
-   * mute state it will return a rejected promise with an `EBUSY` error.
+   * By default only **one** asynchronously blocking call to {@link send}() may
+   * be executed simultaneously. If you call {@link send}() again on a socket
+   * that is in the mute state it will throw an `EBUSY` error.
    *
    * The reason for disallowing multiple {@link send}() calls simultaneously is
    * that it could create an implicit queue of unsendable outgoing messages.
@@ -128,6 +167,11 @@ export interface Writable<
    * implementation could even exhaust all system memory and cause the Node.js
    * process to abort.
    *
+   * If you set {@link sendQueueCapacity}, concurrent calls to {@link send}()
+   * are queued instead and sent in order when the socket becomes writable. An
+   * `EBUSY` error is thrown only if the queue cannot hold the message, which
+   * serves as a backpressure signal to the caller.
+   *
    * For most application you should not notice this implementation detail. Only
    * in rare occasions will a call to {@link send}() that does not resolve
    * immediately be undesired. Here are some common scenarios:
@@ -169,6 +213,136 @@ export interface Writable<
    * @returns Resolved when the message was successfully queued.
    */
   send(message: M, ...options: O): Promise<void>
+
+  /**
+   * Waits until messages can be queued for sending on the socket, without
+   * sending a message. The promise will be resolved once all pending calls to
+   * {@link send}() have completed and the socket is writable. This can be used
+   * to wait for a socket that has reached its {@link sendHighWaterMark} to
+   * accept messages again, similar to the `drain` event of Node.js streams.
+   *
+   * ```typescript
+   * while (socket.writable) {
+   *   await socket.send(next())
+   * }
+   * await socket.writableReady()
+   * ```
+   *
+   * Waiting may fail if the socket has been configured with a
+   * {@link sendTimeout}. While waiting, any calls to {@link send}() are treated
+   * as concurrent calls; see {@link sendQueueCapacity}.
+   *
+   * @returns Resolved when the socket is writable.
+   */
+  writableReady(): Promise<void>
+}
+
+/**
+ * Describes sockets that can send one message to many destinations at once.
+ */
+export interface FanOut {
+  /**
+   * Sends the same payload to many destinations in a single call. Every
+   * message consists of the parts of one envelope, such as the routing id of a
+   * {@link Router} peer or the topic of a {@link Publisher}, followed by the
+   * parts of the payload. The payload is converted only once, and all
+   * messages share its data instead of copying it.
+   *
+   * ```typescript
+   * router.sendToMany([peer1, peer2, peer3], largePayload)
+   * publisher.sendToMany(["prices.EUR", "prices.ALL"], update)
+   * ```
+   *
+   * Unlike {@link Writable.send}(), this never waits. A destination that cannot
+   * accept a message right away is skipped. For a {@link Router} in mandatory
+   * mode, this includes unknown peers. This throws an `EBUSY` error if a
+   * {@link Writable.send}() is in progress, so that messages are not
+   * reordered.
+   *
+   * All envelopes are checked before any message is sent; an envelope without
+   * parts throws an `EINVAL` error. A destination is only counted once every
+   * part of its message was accepted. Any other error is thrown. Once the
+   * first part of a message was accepted, ØMQ only fails the remaining parts
+   * if the socket can no longer be used, such as after the context was
+   * terminated; the incomplete message is then left behind.
+   *
+   * The result is only a count; it does not tell which destinations were
+   * skipped, and skipped destinations are not retried. If every destination
+   * must receive the payload, compare the count with the number of envelopes
+   * and fall back to {@link Writable.send}() per destination, which waits
+   * until a message can be queued.
+   *
+   * @param envelopes The leading parts of every message, one message part or
+   * an array of message parts per destination.
+   * @param payload The single or multipart payload that follows each envelope.
+   * @returns The number of messages that were sent completely, between zero
+   * and the number of envelopes.
+   */
+  sendToMany(
+    envelopes: Array<MessageLike | MessageLike[]>,
+    payload: MessageLike | MessageLike[],
+  ): number
+}
+
+/**
+ * Describes sockets that can pass received messages to handlers by topic.
+ */
+export interface Dispatcher {
+  /**
+   * Registers a handler for all messages whose topic starts with the given
+   * prefix. The topic of a message is its first part. Handlers are called by
+   * {@link dispatch}() with the parts of each matching message. A message that
+   * matches several prefixes is passed to the handlers of all of them, from
+   * the shortest prefix to the longest.
+   *
+   * Routes are kept in a native prefix tree, so finding the handlers of a
+   * message takes the same time regardless of the number of routes, and
+   * messages without any handler are never converted to buffers. Routes only
+   * select among the messages the socket receives; use
+   * {@link Subscriber.subscribe}() to subscribe to the topics.
+   *
+   * ```typescript
+   * sub.subscribe("prices.")
+   * sub.route("prices.", ([topic, price]) => update(topic, price))
+   * sub.route("prices.EUR", ([, price]) => alert(price))
+   *
+   * while (!sub.closed) {
+   *   await sub.dispatch()
+   * }
+   * ```
+   *
+   * Handlers are kept until they are removed with {@link unroute}() or the
+   * socket is closed.
+   *
+   * @param prefix The topic prefix of the messages to handle.
+   * @param handler The function that is called with the parts of every
+   * matching message.
+   */
+  route(prefix: Buffer | string, handler: (msg: Message[]) => void): void
+
+  /**
+   * Removes a handler that was registered with {@link route}().
+   *
+   * @param prefix The prefix the handler was registered for.
+   * @param handler The handler to remove. All handlers of the prefix are
+   * removed if this is omitted.
+   * @returns The number of handlers that were removed.
+   */
+  unroute(prefix: Buffer | string, handler?: (msg: Message[]) => void): number
+
+  /**
+   * Waits for messages like {@link Readable.receive}(), and passes all
+   * messages that are available at once to the handlers registered with
+   * {@link route}(). Messages without a matching handler are discarded. With
+   * {@link Subscriber.conflateTopics} enabled, the latest message of every
+   * updated topic is dispatched.
+   *
+   * If a handler throws, the remaining messages are left on the socket and the
+   * promise is rejected with the error.
+   *
+   * @returns Resolved with the number of messages that were received.
+   */
+  dispatch(): Promise<number>
 }
 
 type ReceiveType<T> = T extends {receive(): Promise<infer U>} ? U : never
@@ -211,6 +385,18 @@ export interface Readable<M extends object[] = Message[]> {
    */
   receiveTimeout: number
 
+  /**
+   * Number of microseconds to spin on the socket when {@link receive}() is
+   * called and no message is available yet, before waiting asynchronously. A
+   * value of 0 (the default) disables busy polling.
+   *
+   * Busy polling blocks the event loop for at most this duration on every
+   * call to {@link receive}() that cannot be resolved immediately. It can
+   * reduce round trip latency for request/reply patterns on dedicated hosts,
+   * at the expense of CPU time.
+   */
+  busyPollMicros: number
+
   /**
    * Waits for the next single or multipart message to become availeble on the
    * socket. Reads a message immediately if possible. If no messages can be
@@ -228,16 +414,21 @@ export interface Readable<M extends object[] = Message[]> {
    * A call to {@link receive}() is guaranteed to return with a resolved promise
    * immediately if a message could be read from the socket directly.
    *
-   * Only **one** asynchronously blocking call to {@link receive}() can be in
-   * progress simultaneously. If you call {@link receive}() again on the same
-   * socket it will return a rejected promise with an `EBUSY` error. For
-   * example, if no messages can be read and no `await` is used:
+   * Multiple calls to {@link receive}() may be in progress simultaneously.
+   * Pending calls are queued and resolved in the order in which they were
+   * made, as messages become available. If a {@link receiveTimeout} is set,
+   * each call waits for at most that amount of time once all calls before it
+   * have been resolved. For example, if no messages can be read and no `await`
+   * is used:
    *
    * ```typescript
-   * socket.receive() // -> pending promise until read is possible
-   * socket.receive() // -> promise rejection with `EBUSY` error
+   * socket.receive() // -> pending promise until first message is available
+   * socket.receive() // -> pending promise until second message is available
    * ```
    *
+   * At most 1024 calls can be queued. If you call {@link receive}() again on a
+   * socket with a full queue, it will throw an `EBUSY` error.
+   *
    * **Note:** Due to the nature of Node.js and to avoid blocking the main
    * thread, this method always attempts to read messages with the
    * `ZMQ_DONTWAIT` flag. It polls asynchronously if reading is not currently
@@ -249,6 +440,55 @@ export interface Readable<M extends object[] = Message[]> {
    */
   receive(): Promise<M>
 
+  /**
+   * Waits for messages like {@link receive}(), but writes them into a ring in
+   * shared memory instead of returning them. All messages that are available
+   * are written at once, for as long as they fit into the ring, without
+   * creating any JavaScript objects per message. Threads waiting on the ring
+   * with `Atomics.wait()` are notified after the messages have been written.
+   *
+   * This allows worker threads to consume messages from a socket owned by the
+   * main thread without copying every message with `postMessage()`. Use
+   * {@link createRing}() to create a ring and a {@link RingReader} to read
+   * messages from it, or {@link pumpIntoRing}() to keep receiving messages
+   * into the ring.
+   *
+   * ```typescript
+   * const ring = zmq.createRing(1 << 20)
+   * const worker = new Worker("./worker.js", {workerData: {ring}})
+   * await zmq.pumpIntoRing(socket, ring)
+   * ```
+   *
+   * If the ring is full, the next message is kept until the ring has room
+   * again and the promise is resolved with 0. A message larger than half the
+   * ring is dropped and the call is rejected with an `EMSGSIZE` error. Calls
+   * are queued together with calls to {@link receive}(); the two should not be
+   * mixed on the same socket, since a message that did not fit into the ring
+   * is only delivered by the next call to {@link receiveInto}(). Metadata such
+   * as the routing id of `Server` sockets is not written to the ring.
+   *
+   * @param ring A ring created with {@link createRing}().
+   * @returns Resolved with the number of messages that were written.
+   */
+  receiveInto(ring: Int32Array): Promise<number>
+
+  /**
+   * Waits for messages like {@link receive}(), but detaches the message parts
+   * from the current thread instead of returning them as buffers. The promise
+   * is resolved with a handle for each part, which can be passed to another
+   * worker thread and adopted there with {@link adoptMessage}(). This moves
+   * messages between threads without copying them or sending them again.
+   * Metadata such as the routing id of `Server` sockets is not retained.
+   *
+   * ```typescript
+   * const handles = await socket.receiveHandles()
+   * worker.postMessage(handles)
+   * ```
+   *
+   * @returns Resolved with handles of the message parts.
+   */
+  receiveHandles(): Promise<MessageHandle[]>
+
   /**
    * Asynchronously iterate over messages becoming available on the socket. When
    * the socket is closed with {@link Socket.close}(), the iterator will return.
@@ -269,9 +509,28 @@ export interface Readable<M extends object[] = Message[]> {
  * socket type, for example `new Dealer({...})`. Readonly options
  * for the particular socket will be omitted.
  *
+ * In addition to the socket options, the following can be passed:
+ *
+ * * `context` - The {@link Context} in which the socket is created.
+ * * `offload` - When `true`, all message I/O of the socket is moved to a
+ *   dedicated native thread. That thread moves messages between the socket and
+ *   internal queues while the JavaScript thread is busy, so that network
+ *   buffers are drained without waiting for the event loop. Messages are then
+ *   exchanged with the JavaScript thread in batches. A promise returned by
+ *   {@link Writable.send}() resolves as soon as the message is queued for the
+ *   I/O thread; messages that cannot be delivered by the socket afterwards
+ *   (for example because of `EHOSTUNREACH`) are silently dropped, so sending
+ *   is fire-and-forget. If the I/O thread stops, for example because the
+ *   context was terminated, later operations on the socket throw. Offloaded
+ *   sockets cannot be used in a {@link Proxy}, and thread safe sockets cannot be
+ *   offloaded. Defaults to `false`.
+ *
  * @typeParam S The socket type to which the options should be applied.
  */
-export type SocketOptions<S extends Socket> = Options<S, {context: Context}>
+export type SocketOptions<S extends Socket> = Options<
+  S,
+  {context: Context; offload: boolean}
+>
 
 interface SocketLikeIterable<T> {
   closed: boolean
@@ -305,6 +564,13 @@ function asyncIterator<T extends SocketLikeIterable<U>, U>(this: T) {
 Object.assign(Socket.prototype, {[Symbol.asyncIterator]: asyncIterator})
 Object.assign(Observer.prototype, {[Symbol.asyncIterator]: asyncIterator})
 
+/* Memory channels are only available on Linux. */
+if (typeof MemoryChannel === "function") {
+  Object.assign(MemoryChannel.prototype, {
+    [Symbol.asyncIterator]: asyncIterator,
+  })
+}
+
 export interface EventSubscriber {
   /**
    * Adds a listener function which will be invoked when the given event type is
@@ -945,6 +1211,36 @@ declare module "./native" {
      */
     [Symbol.asyncIterator](): AsyncIterator<ReceiveType<this>, undefined>
   }
+
+  export interface MemoryChannel {
+    /**
+     * Sends a single message or a multipart message to the other process. The
+     * message is copied into shared memory before the promise is resolved.
+     *
+     * @param message Single message or multipart message to send.
+     * @returns Resolved when the message was copied into shared memory. Only
+     * one send operation may be in progress at any time. Rejected with `EPIPE`
+     * if the ring is full and the other process has closed the channel or
+     * exited, which is checked every second while waiting.
+     */
+    send(message: MessageLike | MessageLike[]): Promise<void>
+
+    /**
+     * Waits for the next message of the other process.
+     *
+     * @returns Resolved with the message parts. Only one receive operation may
+     * be in progress at any time. Rejected with `EPIPE` once all messages have
+     * been received and the other process has closed the channel or exited,
+     * which is checked every second while waiting.
+     */
+    receive(): Promise<Message[]>
+
+    /**
+     * Asynchronously iterate over the messages of the other process. Ends when
+     * the channel is closed.
+     */
+    [Symbol.asyncIterator](): AsyncIterator<Message[], undefined>
+  }
 }
 
 /* Concrete socket types. */
@@ -1024,7 +1320,7 @@ export class Publisher extends Socket {
 }
 
 // eslint-disable-next-line @typescript-eslint/no-empty-interface
-export interface Publisher extends Writable {}
+export interface Publisher extends Writable, FanOut {}
 allowMethods(Publisher.prototype, ["send"])
 
 /**
@@ -1059,6 +1355,20 @@ export class Subscriber extends Socket {
    */
   invertMatching: boolean
 
+  /**
+   * If set to `true`, only the latest message of every topic is received. The
+   * topic of a message is its first part. Every receive first replaces older
+   * messages of the same topic with the messages that have arrived since,
+   * and then returns the latest message of the topic that was updated first.
+   * A consumer that falls behind thus catches up with one message per topic
+   * instead of every message it missed. Unlike {@link conflate}, this
+   * supports multipart messages and keeps one message per topic instead of
+   * one for the whole socket.
+   *
+   * Topic conflation cannot be combined with {@link Readable.receiveInto}().
+   */
+  conflateTopics: boolean
+
   constructor(options?: SocketOptions<Subscriber>) {
     super(SocketType.Subscriber, options)
   }
@@ -1125,8 +1435,34 @@ export class Subscriber extends Socket {
   }
 }
 
-// eslint-disable-next-line @typescript-eslint/no-empty-interface
-export interface Subscriber extends Readable {}
+export interface Subscriber extends Readable, Dispatcher {
+  /**
+   * Subscribes to and unsubscribes from many prefixes at once. Unlike
+   * {@link subscribe}() and {@link unsubscribe}(), which pass every prefix on
+   * to ØMQ, this keeps a reference count per prefix. Only prefixes that are
+   * subscribed to for the first time, or whose last reference is removed, are
+   * sent to the publishers. Duplicate prefixes within one call count once, and
+   * prefixes that are both added and removed in one call are left as they are.
+   *
+   * ```typescript
+   * sub.updateSubscriptions(["EUR", "USD"])
+   * sub.updateSubscriptions(["USD", "GBP"]) // Only sends "GBP".
+   * sub.updateSubscriptions([], ["USD"]) // Sends nothing, "USD" is still used.
+   * ```
+   *
+   * Removing a prefix that was not added with this method has no effect, so
+   * this should not be mixed with {@link unsubscribe}() for the same prefix.
+   * If ØMQ rejects a change, the changes made before it are reverted and the
+   * error is thrown, so the reference counts stay as they were.
+   *
+   * @param subscribe The prefixes to add a reference to.
+   * @param unsubscribe The prefixes to remove a reference from.
+   */
+  updateSubscriptions(
+    subscribe: Array<Buffer | string>,
+    unsubscribe?: Array<Buffer | string>,
+  ): void
+}
 allowMethods(Subscriber.prototype, ["receive"])
 
 /**
@@ -1354,6 +1690,28 @@ export class Router extends Socket {
    */
   handover: boolean
 
+  /**
+   * If set, the routing id of every received message is interned natively:
+   * all messages from the same peer carry the same value, instead of a new
+   * buffer that has to be converted to a key again. After the first message
+   * of a peer, its routing id is looked up without allocating anything.
+   *
+   * * `"buffer"` - Routing ids are shared buffers. They must not be modified,
+   *   because the same buffer is returned for every later message.
+   * * `"string"` - Routing ids are UTF-8 decoded strings, which can be used as
+   *   keys of a `Map` directly. Routing ids that are not valid UTF-8, such as
+   *   those generated by ØMQ for peers without a {@link routingId}, would not
+   *   survive the conversion and are interned as shared buffers instead. Note
+   *   that the first part of received messages is then a string or a buffer.
+   * * `null` - Routing ids are received as new buffers (default).
+   *
+   * At most 65536 routing ids are kept; the least recently seen ones are
+   * evicted first. Use {@link forgetRoutingId}() to release the routing id of
+   * a peer that is known to be gone. Changing this option discards all
+   * interned routing ids.
+   */
+  internRoutingIds: "buffer" | "string" | null
+
   constructor(options?: SocketOptions<Router>) {
     super(SocketType.Router, options)
   }
@@ -1379,7 +1737,17 @@ export interface RouterConnectOptions {
   routingId?: string
 }
 
-export interface Router extends Readable, Writable {}
+export interface Router extends Readable, Writable, FanOut {
+  /**
+   * Removes a routing id interned because of {@link internRoutingIds}, for
+   * example once the application has seen the peer disconnect. If the peer
+   * sends another message, its routing id is interned again.
+   *
+   * @param routingId The routing id to remove.
+   * @returns Whether the routing id was interned.
+   */
+  forgetRoutingId(routingId: string | Buffer): boolean
+}
 allowMethods(Router.prototype, ["send", "receive"])
 
 /**
@@ -1514,12 +1882,45 @@ export class XPublisher extends Socket {
     }
   }
 
+  /**
+   * If set to `true`, the socket keeps track of the number of subscribers of
+   * every prefix, so that {@link hasSubscribers}() can tell whether a topic
+   * is worth publishing. Subscription messages are counted natively as they
+   * are received by {@link receive}(), so they must be received as usual.
+   *
+   * The counts are exact if {@link verbosity} is `null` or `"allSubsUnsubs"`.
+   * With `"allSubs"`, duplicate subscriptions are counted but only the last
+   * unsubscription is seen, so prefixes may appear to have subscribers after
+   * all of them have gone. Disabling tracking clears all counts.
+   */
+  trackSubscriptions: boolean
+
   constructor(options?: SocketOptions<XPublisher>) {
     super(SocketType.XPublisher, options)
   }
 }
 
-export interface XPublisher extends Readable, Writable {}
+export interface XPublisher extends Readable, Writable, FanOut {
+  /**
+   * Returns whether any subscriber is subscribed to a prefix of the given
+   * topic, based on the subscription messages received so far. Messages that
+   * are still waiting on the socket are not taken into account until they are
+   * received. The lookup takes time proportional to the length of the topic,
+   * regardless of the number of subscriptions. Requires
+   * {@link trackSubscriptions}.
+   *
+   * ```typescript
+   * const pub = new XPublisher({trackSubscriptions: true})
+   * if (pub.hasSubscribers("prices.EUR")) {
+   *   await pub.send(["prices.EUR", encode(price)])
+   * }
+   * ```
+   *
+   * @param topic The topic of a message that is about to be published.
+   * @returns Whether the message would reach at least one subscriber.
+   */
+  hasSubscribers(topic: Buffer | string): boolean
+}
 allowMethods(XPublisher.prototype, ["send", "receive"])
 
 /**
@@ -1530,12 +1931,24 @@ allowMethods(XPublisher.prototype, ["send", "receive"])
  * subscription status.
  */
 export class XSubscriber extends Socket {
+  /**
+   * If set to `true`, only the latest message of every topic is received. The
+   * topic of a message is its first part. Every receive first replaces older
+   * messages of the same topic with the messages that have arrived since,
+   * and then returns the latest message of the topic that was updated first.
+   * A consumer that falls behind thus catches up with one message per topic
+   * instead of every message it missed.
+   *
+   * Topic conflation cannot be combined with {@link Readable.receiveInto}().
+   */
+  conflateTopics: boolean
+
   constructor(options?: SocketOptions<XSubscriber>) {
     super(SocketType.XSubscriber, options)
   }
 }
 
-export interface XSubscriber extends Readable, Writable {}
+export interface XSubscriber extends Readable, Writable, Dispatcher {}
 allowMethods(XSubscriber.prototype, ["send", "receive"])
 
 /**
@@ -1596,6 +2009,22 @@ export interface Stream
     Writable<[MessageLike, MessageLike]> {}
 allowMethods(Stream.prototype, ["send", "receive"])
 
+/* Features that only some socket types support are defined by the native
+   Socket.prototype, and moved to the socket types to which they apply. */
+moveMembers(
+  Socket.prototype,
+  [Subscriber, XSubscriber],
+  ["route", "unroute", "dispatch", "conflateTopics"],
+)
+moveMembers(Socket.prototype, [Subscriber], ["updateSubscriptions"])
+moveMembers(Socket.prototype, [Publisher, Router, XPublisher], ["sendToMany"])
+moveMembers(
+  Socket.prototype,
+  [XPublisher],
+  ["hasSubscribers", "trackSubscriptions"],
+)
+moveMembers(Socket.prototype, [Router], ["forgetRoutingId", "internRoutingIds"])
+
 /* Meta functionality to define new socket/context options. */
 const enum Type {
   Bool = "Bool",
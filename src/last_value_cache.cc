@@ -0,0 +1,422 @@
+#include "./last_value_cache.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "./context.h"
+#include "./module.h"
+#include "./socket.h"
+#include "util/arguments.h"
+#include "util/async_scope.h"
+#include "util/error.h"
+#include "util/forward.h"
+#include "util/string_or_buffer.h"
+#include "util/thread.h"
+#include "util/uvthread.h"
+
+namespace zmq {
+static constexpr uint64_t default_max_topics = 65536;
+static constexpr uint64_t default_max_bytes = 64 * 1024 * 1024;
+
+/* The largest integer that a JS number represents exactly. */
+static constexpr double max_safe_integer = 9007199254740991.0;
+
+/* Reads an optional positive integer option. Returns false and throws if the
+   option is invalid. */
+static bool GetInteger(
+    const Napi::Object& options, const char* name, const char* msg, uint64_t& value) {
+    if (!options.Has(name)) {
+        return true;
+    }
+
+    auto const option = options.Get(name);
+    if (option.IsUndefined()) {
+        return true;
+    }
+
+    if (option.IsNumber()) {
+        auto const number = option.As<Napi::Number>().DoubleValue();
+        if (number >= 1 && number <= max_safe_integer && number == std::floor(number)) {
+            value = static_cast<uint64_t>(number);
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(options.Env(), msg).ThrowAsJavaScriptException();
+    return false;
+}
+
+/* Reads the optional prefixes to subscribe to upstream. Returns false and
+   throws if the option is invalid. */
+static bool GetTopics(const Napi::Object& options, std::vector<std::string>& topics) {
+    if (!options.Has("topics")) {
+        return true;
+    }
+
+    auto const option = options.Get("topics");
+    if (option.IsUndefined()) {
+        return true;
+    }
+
+    if (option.IsArray()) {
+        auto const array = option.As<Napi::Array>();
+
+        std::vector<std::string> values;
+        values.reserve(array.Length());
+        for (uint32_t index = 0; index < array.Length(); index++) {
+            auto const topic = array.Get(index);
+            if (!topic.IsString() && !topic.IsBuffer()) {
+                break;
+            }
+
+            values.push_back(convert_string_or_buffer(topic));
+        }
+
+        if (values.size() == array.Length()) {
+            topics = std::move(values);
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(options.Env(), "Topics must be an array of strings or buffers")
+        .ThrowAsJavaScriptException();
+    return false;
+}
+
+LastValueCache::LastValueCache(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<LastValueCache>(info), async_context(Env(), "LastValueCache"),
+      poller(*this), module(*static_cast<Module*>(info.Data())) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Front-end must be a socket object"),
+        Arg::Required<Arg::Object>("Back-end must be a socket object"),
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    auto* front = Socket::Unwrap(info[0].As<Napi::Object>());
+    if (Env().IsExceptionPending()) {
+        return;
+    }
+
+    auto* back = Socket::Unwrap(info[1].As<Napi::Object>());
+    if (Env().IsExceptionPending()) {
+        return;
+    }
+
+    if (front->type != ZMQ_XSUB) {
+        ErrnoException(Env(), EINVAL, "Front-end must be an XSubscriber")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    if (back->type != ZMQ_XPUB) {
+        ErrnoException(Env(), EINVAL, "Back-end must be an XPublisher")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    /* Cache all topics unless told otherwise. */
+    std::vector<std::string> topics{""};
+    auto max_topics = default_max_topics;
+    auto max_bytes = default_max_bytes;
+
+    if (info[2].IsObject()) {
+        auto options = info[2].As<Napi::Object>();
+        if (!GetTopics(options, topics)
+            || !GetInteger(options, "maxTopics", "Max topics must be a positive integer",
+                max_topics)
+            || !GetInteger(options, "maxBytes", "Max bytes must be a positive integer",
+                max_bytes)) {
+            return;
+        }
+    }
+
+    front_ref.Reset(info[0].As<Napi::Object>(), 1);
+    back_ref.Reset(info[1].As<Napi::Object>(), 1);
+    engine = std::make_shared<CacheEngine>(std::move(topics), max_topics, max_bytes);
+}
+
+LastValueCache::~LastValueCache() = default;
+
+void LastValueCache::Close() {}
+
+bool LastValueCache::ValidateSocket(Socket* socket) {
+    if (socket->endpoints == 0) {
+        ErrnoException(Env(), EINVAL, "Socket must be bound or connected")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    /* The cache takes over the sockets in a native thread. */
+    if (socket->offload.Active()) {
+        ErrnoException(Env(), EINVAL, "Sockets with offloaded I/O cannot be cached")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    if (socket->state == Socket::State::Blocked) {
+        ErrnoException(Env(), EBUSY, "Socket is blocked by another operation")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    return true;
+}
+
+Napi::Value LastValueCache::Run(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    ThreadOptions thread_options;
+    if (info[0].IsObject() && !thread_options.Read(info[0].As<Napi::Object>())) {
+        return Env().Undefined();
+    }
+
+    auto* front = Socket::Unwrap(front_ref.Value());
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
+
+    auto* back = Socket::Unwrap(back_ref.Value());
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateSocket(front) || !ValidateSocket(back)) {
+        return Env().Undefined();
+    }
+
+    auto* context = Context::Unwrap(front->context_ref.Value());
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
+
+    /* Use `this` pointer as unique identifier for the control socket. */
+    auto const address = std::string("inproc://zmq.cachecontrol.")
+        + std::to_string(reinterpret_cast<uintptr_t>(this));
+
+    control = zmq_socket(context->context, ZMQ_PAIR);
+    remote_control = zmq_socket(context->context, ZMQ_PAIR);
+    if (control == nullptr || remote_control == nullptr
+        || zmq_bind(remote_control, address.c_str()) < 0
+        || zmq_connect(control, address.c_str()) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        return Env().Undefined();
+    }
+
+    /* The cache replies to statistics requests over the control socket. */
+    uv_os_sock_t file_descriptor = 0;
+    size_t length = sizeof(file_descriptor);
+    if (zmq_getsockopt(control, ZMQ_FD, &file_descriptor, &length) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        return Env().Undefined();
+    }
+
+    if (poller.Initialize(Env(), file_descriptor) < 0) {
+        ErrnoException(Env(), errno).ThrowAsJavaScriptException();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        return Env().Undefined();
+    }
+
+    front->state = Socket::State::Blocked;
+    back->state = Socket::State::Blocked;
+
+    auto res = Napi::Promise::Deferred::New(Env());
+    auto error = std::make_shared<int32_t>(0);
+
+    auto* front_ptr = front->socket;
+    auto* back_ptr = back->socket;
+    auto* remote_ptr = remote_control;
+
+    auto status = UvSpawn(
+        Env(),
+        [engine = engine, error, front_ptr, back_ptr, remote_ptr,
+            thread_options = std::move(thread_options)]() {
+            /* Don't access V8 internals here! Executed in cache thread. */
+            if (auto const err = thread_options.Apply(); err != 0) {
+                *error = err;
+                return;
+            }
+
+            *error = engine->Run(front_ptr, back_ptr, remote_ptr);
+        },
+        [this, front, back, error, res]() {
+            AsyncScope const scope(Env(), async_context);
+
+            /* Statistics that were requested after the cache thread has
+               returned are never answered. */
+            auto unanswered = std::move(statistics_requests);
+            statistics_requests.clear();
+            poller.Close();
+
+            for (auto& request : unanswered) {
+                request.Reject(
+                    ErrnoException(Env(), EBADF, "Cache is not running").Value());
+            }
+
+            front->Close();
+            back->Close();
+            CloseSocket(control);
+            CloseSocket(remote_control);
+
+            if (*error != 0) {
+                res.Reject(ErrnoException(Env(), *error).Value());
+                return;
+            }
+
+            res.Resolve(Env().Undefined());
+        });
+
+    if (status < 0) {
+        front->state = Socket::State::Open;
+        back->state = Socket::State::Open;
+        ErrnoException(Env(), status == UV_EAGAIN ? EAGAIN : EBADF)
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    return res.Promise();
+}
+
+void LastValueCache::SendCommand(char command) {
+    /* Don't send commands if the cache is not running. */
+    if (control == nullptr) {
+        ErrnoException(Env(), EBADF, "Cache is not running").ThrowAsJavaScriptException();
+        return;
+    }
+
+    while (zmq_send(control, &command, 1, 0) < 0) {
+        if (zmq_errno() != EINTR) {
+            ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+            return;
+        }
+    }
+}
+
+void LastValueCache::Terminate(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    SendCommand(CacheEngine::terminate_command);
+}
+
+Napi::Value LastValueCache::Statistics(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    /* Requests join the command that is in progress, if any. */
+    if (statistics_requests.empty()) {
+        SendCommand(CacheEngine::statistics_command);
+        if (Env().IsExceptionPending()) {
+            return Env().Undefined();
+        }
+    }
+
+    auto res = Napi::Promise::Deferred::New(Env());
+    auto promise = res.Promise();
+
+    statistics_requests.push_back(std::move(res));
+    if (statistics_requests.size() == 1) {
+        poller.PollReadable(0);
+        poller.TriggerReadable();
+    }
+
+    return promise;
+}
+
+bool LastValueCache::HasReply() const {
+    if (control == nullptr) {
+        return false;
+    }
+
+    int32_t events = 0;
+    size_t events_size = sizeof(events);
+    while (zmq_getsockopt(control, ZMQ_EVENTS, &events, &events_size) < 0) {
+        if (zmq_errno() != EINTR) {
+            return false;
+        }
+    }
+
+    return (events & ZMQ_POLLIN) != 0;
+}
+
+void LastValueCache::ReceiveStatistics() {
+    AsyncScope const scope(Env(), async_context);
+
+    if (statistics_requests.empty()) {
+        return;
+    }
+
+    if (!HasReply()) {
+        poller.PollReadable(0);
+        return;
+    }
+
+    auto requests = std::move(statistics_requests);
+    statistics_requests.clear();
+
+    /* The cache thread replies as soon as it has written the statistics. */
+    char reply = 0;
+    while (zmq_recv(control, &reply, 1, ZMQ_DONTWAIT) < 0) {
+        if (auto const error = zmq_errno(); error != EINTR) {
+            for (auto& request : requests) {
+                request.Reject(ErrnoException(Env(), error).Value());
+            }
+
+            return;
+        }
+    }
+
+    auto const& statistics = engine->Statistics();
+    for (auto& request : requests) {
+        auto result = Napi::Object::New(Env());
+        result["topics"] = static_cast<double>(statistics.topics);
+        result["bytes"] = static_cast<double>(statistics.bytes);
+        result["hits"] = static_cast<double>(statistics.hits);
+        result["misses"] = static_cast<double>(statistics.misses);
+        result["replayed"] = static_cast<double>(statistics.replayed);
+        result["evictions"] = static_cast<double>(statistics.evictions);
+        request.Resolve(result);
+    }
+}
+
+Napi::Value LastValueCache::GetFrontEnd(const Napi::CallbackInfo& /*info*/) {
+    return front_ref.Value();
+}
+
+Napi::Value LastValueCache::GetBackEnd(const Napi::CallbackInfo& /*info*/) {
+    return back_ref.Value();
+}
+
+void LastValueCache::Initialize(Module& module, Napi::Object& exports) {
+    auto proto = {
+        InstanceMethod<&LastValueCache::Run>("run"),
+        InstanceMethod<&LastValueCache::Terminate>("terminate"),
+        InstanceMethod<&LastValueCache::Statistics>("statistics"),
+
+        InstanceAccessor<&LastValueCache::GetFrontEnd>("frontEnd"),
+        InstanceAccessor<&LastValueCache::GetBackEnd>("backEnd"),
+    };
+
+    auto constructor = DefineClass(exports.Env(), "LastValueCache", proto, &module);
+    module.LastValueCache = Napi::Persistent(constructor);
+    exports.Set("LastValueCache", constructor);
+}
+}  // namespace zmq
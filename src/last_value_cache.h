@@ -0,0 +1,86 @@
+#pragma once
+
+#include <napi.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "./cache_engine.h"
+#include "./closable.h"
+#include "./poller.h"
+
+namespace zmq {
+class Module;
+class Socket;
+
+class LastValueCache : public Napi::ObjectWrap<LastValueCache>, public Closable {
+public:
+    static void Initialize(Module& module, Napi::Object& exports);
+
+    explicit LastValueCache(const Napi::CallbackInfo& info);
+
+    LastValueCache(const LastValueCache&) = delete;
+    LastValueCache(LastValueCache&&) = delete;
+    LastValueCache& operator=(const LastValueCache&) = delete;
+    LastValueCache& operator=(LastValueCache&&) = delete;
+    ~LastValueCache() override;
+
+    void Close() override;
+
+protected:
+    inline Napi::Value Run(const Napi::CallbackInfo& info);
+    inline void Terminate(const Napi::CallbackInfo& info);
+    inline Napi::Value Statistics(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetFrontEnd(const Napi::CallbackInfo& info);
+    inline Napi::Value GetBackEnd(const Napi::CallbackInfo& info);
+
+private:
+    inline bool ValidateSocket(Socket* socket);
+    inline void SendCommand(char command);
+
+    /* Resolves pending statistics requests once the cache has replied. */
+    [[nodiscard]] bool HasReply() const;
+    void ReceiveStatistics();
+
+    class Poller : public zmq::Poller<Poller> {
+        std::reference_wrapper<LastValueCache> cache;
+
+    public:
+        explicit Poller(std::reference_wrapper<LastValueCache> cache) : cache(cache) {}
+
+        [[nodiscard]] bool ValidateReadable() const {
+            return cache.get().HasReply();
+        }
+
+        [[nodiscard]] bool ValidateWritable() const {
+            return false;
+        }
+
+        void ReadableCallback() const {
+            cache.get().ReceiveStatistics();
+        }
+
+        void WritableCallback() const {}
+        void WakeupCallback() const {}
+    };
+
+    Napi::AsyncContext async_context;
+    LastValueCache::Poller poller;
+    Napi::ObjectReference front_ref;
+    Napi::ObjectReference back_ref;
+
+    /* Requests that wait for the statistics command that is in progress. They
+       all share its reply, like those of a broker. */
+    std::deque<Napi::Promise::Deferred> statistics_requests;
+
+    Module& module;
+    std::shared_ptr<CacheEngine> engine;
+    void* control = nullptr;
+    void* remote_control = nullptr;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::LastValueCache>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::LastValueCache>, "not movable");
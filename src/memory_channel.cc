@@ -0,0 +1,588 @@
+
+#include "./memory_channel.h"
+
+#ifdef ZMQ_HAS_MEMORY_CHANNEL
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "./module.h"
+#include "util/arguments.h"
+#include "util/async_scope.h"
+#include "util/error.h"
+#include "util/take.h"
+
+namespace zmq {
+/* Layout of the shared memory: a header of 64 bytes with a magic number, the
+   size of each ring, the process id of each side and a flag that each side
+   sets when it closes the channel, followed by the ring that is written by the
+   creating side and the ring that is written by the opening side. */
+static constexpr uint32_t channel_magic = 0x7a6d6331;
+static constexpr size_t channel_header_size = 64;
+static constexpr size_t pid_index = 2;
+static constexpr size_t closed_index = 4;
+
+/* Interval in milliseconds at which a side that waits checks whether the
+   other side is still alive. A process that exits without closing the channel
+   does not wake up the other side. */
+static constexpr int64_t liveness_interval = 1000;
+
+/* Rings are a multiple of 64 bytes, so that the ring headers of both sides
+   never share a cache line. */
+static constexpr size_t ring_alignment = 64;
+static constexpr size_t default_ring_size = size_t{1} << 20;
+static constexpr size_t min_ring_size = 256;
+static constexpr size_t max_ring_size = size_t{1} << 30;
+
+/* Index of the ring that is written by each side. */
+static constexpr uint32_t creating_side = 0;
+static constexpr uint32_t opening_side = 1;
+
+static std::atomic<int32_t>& HeaderWord(void* memory, size_t index) {
+    static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t));
+
+    auto* words = static_cast<int32_t*>(memory);
+
+    /* NOLINTNEXTLINE(*-pointer-arithmetic, *-reinterpret-cast) */
+    return *reinterpret_cast<std::atomic<int32_t>*>(words + index);
+}
+
+static void CloseDescriptor(int& descriptor) {
+    if (descriptor >= 0) {
+        close(descriptor);
+        descriptor = -1;
+    }
+}
+
+static Napi::Error FailureException(const Napi::Env& env, int32_t error) {
+    return ErrnoException(
+        env, error, error == EPROTO ? "Channel is corrupted" : "Peer is gone");
+}
+
+static std::vector<zmq_msg_t*> Pointers(OutgoingMsg::Parts& parts) {
+    std::vector<zmq_msg_t*> msgs;
+    for (auto& part : parts) {
+        msgs.push_back(part.get());
+    }
+    return msgs;
+}
+
+MemoryChannel::MemoryChannel(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<MemoryChannel>(info), async_context(Env(), "MemoryChannel"),
+      poller(*this), module(*static_cast<Module*>(info.Data())) {
+    Arg::Validator const args{
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    auto ring_size = default_ring_size;
+    Napi::Array peer;
+
+    if (info[0].IsObject()) {
+        auto options = info[0].As<Napi::Object>();
+        if (options.Has("descriptors")) {
+            auto const value = options.Get("descriptors");
+            if (!value.IsArray() || value.As<Napi::Array>().Length() != 3) {
+                Napi::TypeError::New(Env(), "Descriptors must be an array of 3 numbers")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+
+            peer = value.As<Napi::Array>();
+        }
+
+        if (options.Has("size")) {
+            auto const value = options.Get("size");
+            auto const size =
+                value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : 0.0;
+            if (size < min_ring_size || size > max_ring_size) {
+                Napi::TypeError::New(Env(), "Size must be a number between 256 and 2^30")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+
+            auto const aligned = static_cast<size_t>(std::ceil(size / ring_alignment));
+            ring_size = aligned * ring_alignment;
+        }
+    }
+
+    if (!(peer.IsEmpty() ? Create(ring_size) : Open(peer))) {
+        return;
+    }
+
+    uv_os_sock_t file_descriptor = own_events;
+    if (poller.Initialize(Env(), file_descriptor) < 0) {
+        ErrnoException(Env(), errno).ThrowAsJavaScriptException();
+        Unmap();
+        return;
+    }
+
+    /* Initialization was successful, register the channel for cleanup. */
+    module.ObjectReaper.Add(this);
+}
+
+MemoryChannel::~MemoryChannel() {
+    Close();
+}
+
+bool MemoryChannel::Create(size_t ring_size) {
+    descriptors[0] = memfd_create("zeromq-channel", MFD_CLOEXEC);
+    descriptors[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    descriptors[2] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    auto const length = channel_header_size + 2 * ring_size;
+    if (descriptors[0] < 0 || descriptors[1] < 0 || descriptors[2] < 0
+        || ftruncate(descriptors[0], static_cast<off_t>(length)) < 0
+        || !Map(length, creating_side)) {
+        auto const error = errno;
+        Unmap();
+        ErrnoException(Env(), error).ThrowAsJavaScriptException();
+        return false;
+    }
+
+    /* The memory is zero-filled, so both rings start out empty. */
+    auto* header = static_cast<uint32_t*>(memory);
+    header[1] = static_cast<uint32_t>(ring_size);
+    header[0] = channel_magic;
+    Announce();
+    return true;
+}
+
+bool MemoryChannel::Open(const Napi::Array& peer) {
+    for (uint32_t index = 0; index < descriptors.size(); index++) {
+        auto const value = peer.Get(index);
+        if (!value.IsNumber()) {
+            Napi::TypeError::New(Env(), "Descriptors must be an array of 3 numbers")
+                .ThrowAsJavaScriptException();
+            Unmap();
+            return false;
+        }
+
+        /* Use our own copies, so that the given descriptors can be closed. */
+        descriptors[index] =
+            fcntl(value.As<Napi::Number>().Int32Value(), F_DUPFD_CLOEXEC, 0);
+        if (descriptors[index] < 0) {
+            auto const error = errno;
+            Unmap();
+            ErrnoException(Env(), error).ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    struct stat info {};
+    if (fstat(descriptors[0], &info) < 0) {
+        auto const error = errno;
+        Unmap();
+        ErrnoException(Env(), error).ThrowAsJavaScriptException();
+        return false;
+    }
+
+    auto const length = static_cast<size_t>(info.st_size);
+    auto const ring_size = (length - channel_header_size) / 2;
+    if (length < channel_header_size + 2 * min_ring_size
+        || length != channel_header_size + 2 * ring_size
+        || ring_size % ring_alignment != 0 || !Map(length, opening_side)) {
+        Unmap();
+        ErrnoException(Env(), EINVAL, "Descriptors do not refer to a memory channel")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    auto const* header = static_cast<uint32_t*>(memory);
+    if (header[0] != channel_magic || header[1] != ring_size) {
+        Unmap();
+        ErrnoException(Env(), EINVAL, "Descriptors do not refer to a memory channel")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    Announce();
+    return true;
+}
+
+bool MemoryChannel::Map(size_t length, uint32_t side) {
+    auto* mapping =
+        mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, descriptors[0], 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    memory = mapping;
+    memory_size = length;
+
+    auto const ring_size = (length - channel_header_size) / 2;
+    auto* rings = static_cast<uint8_t*>(memory) + channel_header_size;
+
+    /* NOLINTBEGIN(*-reinterpret-cast, *-pointer-arithmetic) */
+    auto* own_ring = reinterpret_cast<int32_t*>(rings + side * ring_size);
+    auto* peer_ring = reinterpret_cast<int32_t*>(rings + (1 - side) * ring_size);
+    /* NOLINTEND(*-reinterpret-cast, *-pointer-arithmetic) */
+
+    writer.emplace(own_ring, ring_size);
+    reader.emplace(peer_ring, ring_size);
+
+    own_events = descriptors[1 + side];
+    peer_events = descriptors[2 - side];
+    own_side = side;
+    return true;
+}
+
+void MemoryChannel::Announce() {
+    HeaderWord(memory, closed_index + own_side).store(0, std::memory_order_relaxed);
+    HeaderWord(memory, pid_index + own_side).store(getpid(), std::memory_order_release);
+}
+
+void MemoryChannel::Unmap() {
+    writer.reset();
+    reader.reset();
+
+    if (memory != nullptr) {
+        munmap(memory, memory_size);
+        memory = nullptr;
+        memory_size = 0;
+    }
+
+    for (auto& descriptor : descriptors) {
+        CloseDescriptor(descriptor);
+    }
+
+    own_events = -1;
+    peer_events = -1;
+}
+
+bool MemoryChannel::ValidateOpen() const {
+    if (memory == nullptr) {
+        ErrnoException(Env(), EBADF, "Channel is closed").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    return true;
+}
+
+bool MemoryChannel::PeerAlive() const {
+    auto const peer_side = 1 - own_side;
+    if (HeaderWord(memory, closed_index + peer_side).load(std::memory_order_acquire)
+        != 0) {
+        return false;
+    }
+
+    /* The channel may not have been opened by the other side yet. A process
+       that cannot be signalled (EPERM) still exists. */
+    auto const pid =
+        HeaderWord(memory, pid_index + peer_side).load(std::memory_order_acquire);
+    return pid == 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+int32_t MemoryChannel::Failure() const {
+    if (writer->Corrupted() || reader->Corrupted()) {
+        return EPROTO;
+    }
+
+    return PeerAlive() ? 0 : EPIPE;
+}
+
+void MemoryChannel::Signal() const {
+    uint64_t const value = 1;
+    while (write(peer_events, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+void MemoryChannel::Drain() const {
+    uint64_t value = 0;
+    while (read(own_events, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+bool MemoryChannel::Write(OutgoingMsg::Parts& parts) {
+    auto msgs = Pointers(parts);
+    if (!writer->Write(msgs.begin(), msgs.end())) {
+        return false;
+    }
+
+    if (writer->ShouldWakeReader()) {
+        Signal();
+    }
+
+    return true;
+}
+
+void MemoryChannel::Read(const Napi::Promise::Deferred& res) {
+    auto list = Napi::Array::New(Env());
+    uint32_t index = 0;
+
+    if (!reader->Read([&](const uint8_t* data, size_t length) {
+            list[index++] = Napi::Buffer<uint8_t>::Copy(Env(), data, length);
+        })) {
+        res.Reject(FailureException(Env(), EPROTO).Value());
+        return;
+    }
+
+    if (reader->ShouldWakeWriter()) {
+        Signal();
+    }
+
+    res.Resolve(list);
+}
+
+void MemoryChannel::Close() {
+    if (memory != nullptr && !closed) {
+        module.ObjectReaper.Remove(this);
+
+        Napi::HandleScope const scope(Env());
+
+        /* Stop all polling and release event handlers before the eventfds
+           are closed. Pending operations are rejected because the channel is
+           marked as closed. */
+        closed = true;
+        poller.Close();
+
+        /* Tell the other side that it will not receive or be able to send
+           anything anymore. */
+        HeaderWord(memory, closed_index + own_side).store(1, std::memory_order_release);
+        Signal();
+
+        Unmap();
+    }
+}
+
+void MemoryChannel::Close(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    Close();
+}
+
+Napi::Value MemoryChannel::Send(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::NotUndefined>("Message must be present"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    if (poller.Writing()) {
+        ErrnoException(Env(), EBUSY,
+            "Channel is busy writing; only one send operation may be in progress at "
+            "any time")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    OutgoingMsg::Parts parts(info[0], module);
+
+    auto res = Napi::Promise::Deferred::New(Env());
+
+    size_t size = 0;
+    for (auto& part : parts) {
+        size += Ring::FrameSize(part.size());
+    }
+
+    if (!writer->Accepts(size)) {
+        res.Reject(ErrnoException(Env(), EMSGSIZE).Value());
+        return res.Promise();
+    }
+
+    /* Announce that we might wait before the final attempt, so that the other
+       side signals us when it makes room. */
+    if (!Write(parts)) {
+        writer->AwaitRoom();
+        if (!Write(parts)) {
+            if (auto const error = Failure(); error != 0) {
+                res.Reject(FailureException(Env(), error).Value());
+                return res.Promise();
+            }
+
+            poller.PollWritable(liveness_interval);
+            return poller.WritePromise(std::move(parts));
+        }
+    }
+
+    res.Resolve(Env().Undefined());
+    return res.Promise();
+}
+
+Napi::Value MemoryChannel::Receive(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    if (poller.Reading()) {
+        ErrnoException(Env(), EBUSY,
+            "Channel is busy reading; only one receive operation may be in progress at "
+            "any time")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    auto res = Napi::Promise::Deferred::New(Env());
+    if (!Readable()) {
+        reader->AwaitMessages();
+        if (!Readable()) {
+            if (auto const error = Failure(); error != 0) {
+                res.Reject(FailureException(Env(), error).Value());
+                return res.Promise();
+            }
+
+            poller.PollReadable(liveness_interval);
+            return poller.ReadPromise();
+        }
+    }
+
+    Read(res);
+    return res.Promise();
+}
+
+Napi::Value MemoryChannel::GetDescriptors(const Napi::CallbackInfo& /*info*/) {
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    auto list = Napi::Array::New(Env(), descriptors.size());
+    for (uint32_t index = 0; index < descriptors.size(); index++) {
+        list[index] = Napi::Number::New(Env(), descriptors[index]);
+    }
+
+    return list;
+}
+
+Napi::Value MemoryChannel::GetClosed(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Boolean::New(Env(), memory == nullptr);
+}
+
+void MemoryChannel::Initialize(Module& module, Napi::Object& exports) {
+    auto proto = {
+        InstanceMethod<&MemoryChannel::Close>("close"),
+        InstanceMethod<&MemoryChannel::Send>("send"),
+        InstanceMethod<&MemoryChannel::Receive>("receive"),
+
+        InstanceAccessor<&MemoryChannel::GetDescriptors>("descriptors"),
+        InstanceAccessor<&MemoryChannel::GetClosed>("closed"),
+    };
+
+    auto constructor = DefineClass(exports.Env(), "MemoryChannel", proto, &module);
+    module.MemoryChannel = Napi::Persistent(constructor);
+    exports.Set("MemoryChannel", constructor);
+}
+
+bool MemoryChannel::Poller::ValidateReadable() {
+    auto& reader = channel.get().reader;
+    if (!reader) {
+        return false;
+    }
+
+    if (!reader->Empty()) {
+        return true;
+    }
+
+    reader->AwaitMessages();
+    return !reader->Empty() || channel.get().Failure() != 0;
+}
+
+bool MemoryChannel::Poller::ValidateWritable() {
+    auto& writer = channel.get().writer;
+    if (!write_deferred || !writer) {
+        return false;
+    }
+
+    auto msgs = Pointers(write_value);
+    if (writer->Fits(msgs.begin(), msgs.end())) {
+        return true;
+    }
+
+    writer->AwaitRoom();
+    return writer->Fits(msgs.begin(), msgs.end()) || channel.get().Failure() != 0;
+}
+
+void MemoryChannel::Poller::ReadableCallback() {
+    assert(read_deferred);
+
+    AsyncScope const scope(channel.get().Env(), channel.get().async_context);
+
+    auto& chan = channel.get();
+    if (chan.closed) {
+        take(read_deferred).Reject(ErrnoException(chan.Env(), EAGAIN).Value());
+        return;
+    }
+
+    if (!chan.Readable()) {
+        if (auto const error = chan.Failure(); error != 0) {
+            take(read_deferred).Reject(FailureException(chan.Env(), error).Value());
+            return;
+        }
+
+        /* The liveness check is due, but the other side is still there. */
+        PollReadable(liveness_interval);
+        return;
+    }
+
+    chan.Read(take(read_deferred));
+}
+
+void MemoryChannel::Poller::WritableCallback() {
+    assert(write_deferred);
+
+    AsyncScope const scope(channel.get().Env(), channel.get().async_context);
+
+    auto& chan = channel.get();
+    if (chan.closed) {
+        take(write_deferred).Reject(ErrnoException(chan.Env(), EAGAIN).Value());
+        write_value.Clear();
+        return;
+    }
+
+    if (!chan.Write(write_value)) {
+        auto const error = chan.Failure();
+        if (error == 0) {
+            /* The liveness check is due, but the other side is still there. */
+            PollWritable(liveness_interval);
+            return;
+        }
+
+        take(write_deferred).Reject(FailureException(chan.Env(), error).Value());
+    } else {
+        take(write_deferred).Resolve(chan.Env().Undefined());
+    }
+
+    write_value.Clear();
+}
+
+Napi::Value MemoryChannel::Poller::ReadPromise() {
+    assert(!read_deferred);
+
+    read_deferred = Napi::Promise::Deferred(channel.get().Env());
+    return read_deferred->Promise();
+}
+
+Napi::Value MemoryChannel::Poller::WritePromise(OutgoingMsg::Parts&& parts) {
+    assert(!write_deferred);
+
+    write_value = std::move(parts);
+    write_deferred = Napi::Promise::Deferred(channel.get().Env());
+    return write_deferred->Promise();
+}
+}  // namespace zmq
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <napi.h>
+
+#include <array>
+#include <functional>
+#include <optional>
+
+#include "./closable.h"
+#include "./inline.h"
+#include "./outgoing_msg.h"
+#include "./poller.h"
+#include "./zmq_inc.h"
+#include "util/ring.h"
+
+#ifdef ZMQ_HAS_MEMORY_CHANNEL
+
+namespace zmq {
+class Module;
+
+/* Exchanges messages with another process through two rings in shared memory,
+   one for each direction. Each side has an eventfd that the other side
+   signals when it has written a message or made room while the first side
+   was waiting. Messages are copied into and out of the shared memory by the
+   sending and receiving process; no system calls are needed while both sides
+   are busy. */
+class MemoryChannel : public Napi::ObjectWrap<MemoryChannel>, public Closable {
+public:
+    static void Initialize(Module& module, Napi::Object& exports);
+
+    explicit MemoryChannel(const Napi::CallbackInfo& info);
+
+    MemoryChannel(const MemoryChannel&) = delete;
+    MemoryChannel(MemoryChannel&&) = delete;
+    MemoryChannel& operator=(const MemoryChannel&) = delete;
+    MemoryChannel& operator=(MemoryChannel&&) = delete;
+    ~MemoryChannel() override;
+
+    void Close() override;
+
+protected:
+    inline void Close(const Napi::CallbackInfo& info);
+    inline Napi::Value Send(const Napi::CallbackInfo& info);
+    inline Napi::Value Receive(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetDescriptors(const Napi::CallbackInfo& info);
+    inline Napi::Value GetClosed(const Napi::CallbackInfo& info);
+
+private:
+    [[nodiscard]] bool Create(size_t ring_size);
+    [[nodiscard]] bool Open(const Napi::Array& descriptors);
+    [[nodiscard]] bool Map(size_t length, uint32_t side);
+    void Unmap();
+
+    /* Publishes the process id of this side in the shared header. */
+    void Announce();
+
+    [[nodiscard]] inline bool ValidateOpen() const;
+
+    [[nodiscard]] bool Readable() const {
+        return reader.has_value() && !reader->Empty() && !reader->Corrupted();
+    }
+
+    force_inline bool Write(OutgoingMsg::Parts& parts);
+
+    /* Resolves with the parts of the next message, or rejects if the ring
+       turns out to be corrupted. */
+    force_inline void Read(const Napi::Promise::Deferred& res);
+
+    /* Returns false if the other side has closed the channel or its process
+       has exited. */
+    [[nodiscard]] bool PeerAlive() const;
+
+    /* Returns the error that ends the exchange with the other side: EPROTO if
+       either ring is corrupted, EPIPE if the other side has gone, or 0. */
+    [[nodiscard]] int32_t Failure() const;
+
+    /* Wakes up the other side, or consumes wake-ups for this side. */
+    void Signal() const;
+    void Drain() const;
+
+    class Poller : public zmq::Poller<Poller> {
+        std::reference_wrapper<MemoryChannel> channel;
+        std::optional<Napi::Promise::Deferred> read_deferred;
+        std::optional<Napi::Promise::Deferred> write_deferred;
+        OutgoingMsg::Parts write_value;
+
+    public:
+        explicit Poller(std::reference_wrapper<MemoryChannel> channel)
+            : channel(channel) {}
+
+        Napi::Value ReadPromise();
+        Napi::Value WritePromise(OutgoingMsg::Parts&& parts);
+
+        [[nodiscard]] bool Reading() const {
+            return read_deferred.has_value();
+        }
+
+        [[nodiscard]] bool Writing() const {
+            return write_deferred.has_value();
+        }
+
+        /* Validation announces that we wait once more if the other side woke
+           us up before the operation became possible. */
+        [[nodiscard]] bool ValidateReadable();
+        [[nodiscard]] bool ValidateWritable();
+
+        void ReadableCallback();
+        void WritableCallback();
+
+        void WakeupCallback() const {
+            channel.get().Drain();
+        }
+    };
+
+    Napi::AsyncContext async_context;
+    MemoryChannel::Poller poller;
+
+    Module& module;
+
+    /* The shared memory, and the eventfds of the creating and the opening
+       side, in the order in which they are passed to other processes. */
+    std::array<int, 3> descriptors{-1, -1, -1};
+    int own_events = -1;
+    int peer_events = -1;
+    uint32_t own_side = 0;
+
+    void* memory = nullptr;
+    size_t memory_size = 0;
+
+    std::optional<RingWriter> writer;
+    std::optional<RingReader> reader;
+
+    /* Set when the channel is closed, before the poller is closed, so that
+       pending operations are rejected. */
+    bool closed = false;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::MemoryChannel>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::MemoryChannel>, "not movable");
+
+#endif
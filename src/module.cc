@@ -2,13 +2,21 @@
 #include "./module.h"
 
 #include <array>
+#include <cmath>
 
+#include "./broker.h"
 #include "./context.h"
+#include "./last_value_cache.h"
+#include "./memory_channel.h"
 #include "./observer.h"
 #include "./outgoing_msg.h"
 #include "./proxy.h"
+#include "./proxy_group.h"
+#include "./shard_proxy.h"
 #include "./socket.h"
+#include "./worker_pool.h"
 #include "./zmq_inc.h"
+#include "util/arguments.h"
 #include "util/error.h"
 
 namespace zmq {
@@ -76,6 +84,53 @@ Napi::Value CurveKeyPair(const Napi::CallbackInfo& info) {
     return result;
 }
 
+/* Takes a detached message out of the registry. Throws if the handle is
+   invalid or the message has already been adopted or released. */
+std::unique_ptr<IncomingMsg> TakeMessage(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Number>("Handle must be a number"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return nullptr;
+    }
+
+    auto& module = *static_cast<Module*>(info.Data());
+    auto const handle = info[0].As<Napi::Number>().DoubleValue();
+
+    std::unique_ptr<IncomingMsg> msg;
+    if (handle >= 1 && handle == std::floor(handle)) {
+        msg = module.Global().DetachedMsgs.Take(static_cast<uint64_t>(handle));
+    }
+
+    if (msg == nullptr) {
+        ErrnoException(info.Env(), EINVAL, "Message handle is invalid")
+            .ThrowAsJavaScriptException();
+    }
+
+    return msg;
+}
+
+Napi::Value AdoptMessage(const Napi::CallbackInfo& info) {
+    auto msg = TakeMessage(info);
+    if (msg == nullptr) {
+        return info.Env().Undefined();
+    }
+
+    return msg->IntoBuffer(info.Env());
+}
+
+void ReleaseMessage(const Napi::CallbackInfo& info) {
+    TakeMessage(info);
+}
+
+#ifdef ZMQ_COUNT_EVENTS
+Napi::Value EventsQueries(const Napi::CallbackInfo& info) {
+    auto& module = *static_cast<Module*>(info.Data());
+    return Napi::Number::New(info.Env(), static_cast<double>(module.EventsQueries));
+}
+#endif
+
 Module::Global::Global() : SharedContext(zmq_ctx_new()) {
     assert(SharedContext != nullptr);
 
@@ -106,14 +161,32 @@ Module::Module(Napi::Env env, Napi::Object exports) : MsgTrash(env) {
     exports.Set("version", zmq::Version(env));
     exports.Set("capability", zmq::Capabilities(env));
     exports.Set("curveKeyPair", Napi::Function::New(env, zmq::CurveKeyPair));
+    exports.Set("adoptMessage",
+        Napi::Function::New(env, zmq::AdoptMessage, "adoptMessage", this));
+    exports.Set("releaseMessage",
+        Napi::Function::New(env, zmq::ReleaseMessage, "releaseMessage", this));
+
+#ifdef ZMQ_COUNT_EVENTS
+    exports.Set("eventsQueries",
+        Napi::Function::New(env, zmq::EventsQueries, "eventsQueries", this));
+#endif
 
     Context::Initialize(*this, exports);
     Socket::Initialize(*this, exports);
     Observer::Initialize(*this, exports);
+    WorkerPool::Initialize(*this, exports);
+    ProxyGroup::Initialize(*this, exports);
+    ShardProxy::Initialize(*this, exports);
+    Broker::Initialize(*this, exports);
+    LastValueCache::Initialize(*this, exports);
 
 #ifdef ZMQ_HAS_STEERABLE_PROXY
     Proxy::Initialize(*this, exports);
 #endif
+
+#ifdef ZMQ_HAS_MEMORY_CHANNEL
+    MemoryChannel::Initialize(*this, exports);
+#endif
 }
 }  // namespace zmq
 
@@ -5,6 +5,7 @@
 #include <chrono>
 
 #include "./closable.h"
+#include "./incoming_msg.h"
 #include "./outgoing_msg.h"
 #include "util/reaper.h"
 #include "util/trash.h"
@@ -48,6 +49,34 @@ struct Terminator {
     }
 };
 
+/* A socket that has been detached from the agent/thread that created it, with
+   the state that is needed to resume using it in another agent/thread. The
+   socket is closed if it is never adopted, unless it is shared. */
+struct DetachedSocket {
+    void* socket = nullptr;
+    std::shared_ptr<void> shared;
+    int32_t type = 0;
+    int64_t send_timeout = -1;
+    int64_t receive_timeout = -1;
+    int64_t busy_poll_micros = 0;
+    int64_t send_queue_capacity = 0;
+    uint32_t endpoints = 0;
+    bool conflate_topics = false;
+
+    DetachedSocket() = default;
+    DetachedSocket(const DetachedSocket&) = delete;
+    DetachedSocket(DetachedSocket&&) = delete;
+    DetachedSocket& operator=(const DetachedSocket&) = delete;
+    DetachedSocket& operator=(DetachedSocket&&) = delete;
+
+    ~DetachedSocket() {
+        if (socket != nullptr && shared == nullptr) {
+            [[maybe_unused]] auto err = zmq_close(socket);
+            assert(err == 0);
+        }
+    }
+};
+
 class Module : public Napi::Addon<Module> {
     /* Contains shared global state that will be accessible by all
        agents/threads. */
@@ -65,6 +94,14 @@ class Module : public Napi::Addon<Module> {
         /* A list of ZMQ contexts that will be terminated on a clean exit. */
         ThreadSafeReaper<void, Terminator> ContextTerminator;
 
+        /* Received messages that have been detached from the agent/thread that
+           received them, and that can be adopted by any agent/thread. */
+        Registry<IncomingMsg> DetachedMsgs;
+
+        /* Sockets that have been detached and can be adopted by any
+           agent/thread. They are closed before the contexts are terminated. */
+        Registry<DetachedSocket> DetachedSockets;
+
         friend class Module;
     };
 
@@ -104,6 +141,17 @@ public:
     Napi::FunctionReference Socket;
     Napi::FunctionReference Observer;
     Napi::FunctionReference Proxy;
+    Napi::FunctionReference ProxyGroup;
+    Napi::FunctionReference ShardProxy;
+    Napi::FunctionReference Broker;
+    Napi::FunctionReference LastValueCache;
+    Napi::FunctionReference WorkerPool;
+    Napi::FunctionReference MemoryChannel;
+
+#ifdef ZMQ_COUNT_EVENTS
+    /* Number of ZMQ_EVENTS queries issued by all sockets of this agent. */
+    uint64_t EventsQueries = 0;
+#endif
 };
 }  // namespace zmq
 
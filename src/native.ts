@@ -61,6 +61,50 @@ export declare function curveKeyPair(): {
   secretKey: string
 }
 
+/**
+ * A handle to a socket that has been detached from the thread that created
+ * it, see {@link Socket.detach}(). Handles are plain numbers, so they can be
+ * sent to other worker threads with `postMessage()`.
+ */
+export type SocketHandle = number
+
+/**
+ * A handle to a received message part that has been detached from the thread
+ * that received it, see {@link Readable.receiveHandles}(). Handles are plain
+ * numbers, so they can be sent to other worker threads with `postMessage()`.
+ */
+export type MessageHandle = number
+
+/**
+ * Adopts a detached message part in the current thread. The message contents
+ * are not copied if possible. Each handle can be adopted (or released) only
+ * once, by any thread of the process.
+ *
+ * ```typescript
+ * // Main thread
+ * const handles = await socket.receiveHandles()
+ * worker.postMessage(handles)
+ *
+ * // Worker thread
+ * parentPort.on("message", handles => {
+ *   const parts = handles.map(handle => zmq.adoptMessage(handle))
+ * })
+ * ```
+ *
+ * @param handle The handle of the message part.
+ * @returns The message part as a buffer.
+ */
+export declare function adoptMessage(handle: MessageHandle): Buffer
+
+/**
+ * Releases a detached message part without adopting it. Message parts that
+ * are neither adopted nor released are only freed when all threads using
+ * ZeroMQ have exited.
+ *
+ * @param handle The handle of the message part.
+ */
+export declare function releaseMessage(handle: MessageHandle): void
+
 /**
  * A ØMQ context. Contexts manage the background I/O to send and receive
  * messages of their associated sockets.
@@ -377,6 +421,84 @@ export declare class Observer {
   receive(): Promise<Event>
 }
 
+/**
+ * Message and byte counts of one side of a {@link Proxy}, as returned by
+ * {@link Proxy.statistics}(). All counts are totals since the proxy started.
+ */
+export interface ProxySocketStatistics {
+  /** The number of messages received by the socket. */
+  messagesIn: number
+
+  /** The number of bytes received by the socket. */
+  bytesIn: number
+
+  /** The number of messages sent by the socket. */
+  messagesOut: number
+
+  /** The number of bytes sent by the socket. */
+  bytesOut: number
+}
+
+/**
+ * Statistics of a {@link Proxy}, as returned by {@link Proxy.statistics}().
+ */
+export interface ProxyStatistics {
+  /** Counts of the front-end socket. */
+  frontEnd: ProxySocketStatistics
+
+  /** Counts of the back-end socket. */
+  backEnd: ProxySocketStatistics
+}
+
+/**
+ * Capture options of a {@link Proxy}. Selected messages are copied to the
+ * capture socket by the proxy thread. To keep the overhead low on busy
+ * proxies, select a small share of the messages, and truncate them if only
+ * their headers are of interest.
+ *
+ * ```typescript
+ * const capture = new Publisher()
+ * await capture.bind("tcp://127.0.0.1:3003")
+ *
+ * // Copy the first 64 bytes of 1 in 100 "order" messages.
+ * await proxy.run({
+ *   capture: {
+ *     socket: capture,
+ *     part: 1,
+ *     prefix: "order",
+ *     sample: 100,
+ *     truncate: 64,
+ *   },
+ * })
+ * ```
+ *
+ * A capture socket that cannot accept more messages never holds up the
+ * proxy; copies are dropped instead. The capture socket cannot be used while
+ * the proxy runs, and remains open when the proxy terminates.
+ */
+export interface ProxyCapture {
+  /** The socket that receives the copies. It must be bound or connected. */
+  socket: Socket
+
+  /**
+   * Copy only one of every `sample` selected messages. Defaults to `1`, which
+   * copies all selected messages.
+   */
+  sample?: number
+
+  /**
+   * Select only messages of which the given part starts with this prefix.
+   * Defaults to selecting all messages.
+   */
+  prefix?: string | Buffer
+
+  /** The index of the part that is matched with `prefix`. Defaults to `0`. */
+  part?: number
+
+  /** The maximum length of each copied part. Defaults to no maximum. */
+  truncate?: number
+}
+
 /**
  * Proxy messages between two ØMQ sockets. The proxy connects a front-end socket
  * to a back-end socket. Conceptually, data flows from front-end to back-end.
@@ -428,16 +550,30 @@ export declare class Proxy<
   constructor(frontEnd: F, backEnd: B)
 
   /**
-   * Starts the proxy loop in a worker thread and waits for its termination.
-   * Before starting, you must set any socket options, and connect or bind both
-   * front-end and back-end sockets.
+   * Starts the proxy loop in a dedicated native thread and waits for its
+   * termination. The thread does not take up any of the threads of the libuv
+   * thread pool. Before starting, you must set any socket options, and connect
+   * or bind both front-end and back-end sockets.
    *
    * On termination the front-end and back-end sockets will be closed
    * automatically.
    *
+   * @param options Thread and capture options. Thread options are only
+   * supported on Linux.
+   * * `threadAffinity` - The CPUs on which the proxy thread may run. Defaults
+   *   to all CPUs.
+   * * `threadPriority` - The nice value of the proxy thread, from `-20`
+   *   (highest priority) to `19` (lowest priority). Raising the priority
+   *   usually requires privileges. Defaults to the nice value of the process.
+   * * `capture` - Copies messages in both directions to a capture socket. See
+   *   {@link ProxyCapture}.
    * @returns Resolved when the proxy has terminated.
    */
-  run(): Promise<void>
+  run(options?: {
+    threadAffinity?: number[]
+    threadPriority?: number
+    capture?: ProxyCapture
+  }): Promise<void>
 
   /**
    * Temporarily suspends any proxy activity. Resume activity with
@@ -456,6 +592,612 @@ export declare class Proxy<
    * the {@link run}() method resolving.
    */
   terminate(): void
+  /**
+   * Requests the message and byte counts of the running proxy. Requires ZeroMQ
+   * 4.3 or later. The counts are totals since the proxy was started, so they
+   * can be sampled periodically to compute throughput.
+   *
+   * ```typescript
+   * let previous = await proxy.statistics()
+   * setInterval(async () => {
+   *   const current = await proxy.statistics()
+   *   const {messagesIn} = current.frontEnd
+   *   metrics.gauge("messages", messagesIn - previous.frontEnd.messagesIn)
+   *   previous = current
+   * }, 1000)
+   * ```
+   *
+   * @returns Resolved with the statistics as soon as the proxy replies.
+   */
+  statistics(): Promise<ProxyStatistics>
+}
+
+/**
+ * Proxies messages between any number of front-end/back-end socket pairs on a
+ * single dedicated native thread. Pairs can be added and removed while the
+ * group is running, so the number of threads stays the same regardless of
+ * the number of pairs.
+ *
+ * ```typescript
+ * const group = new ProxyGroup()
+ * const frontEnd = new Router()
+ * const backEnd = new Dealer()
+ * await frontEnd.bind("tcp://*:3001")
+ * await backEnd.bind("tcp://*:3002")
+ *
+ * const pair = group.add(frontEnd, backEnd)
+ * // ...
+ * group.remove(pair)
+ * ```
+ *
+ * Like a {@link Proxy}, messages are passed on in both directions. A socket
+ * that reaches its high water mark only holds up the pair it belongs to; all
+ * other pairs continue to pass on messages.
+ */
+export declare class ProxyGroup {
+  /**
+   * The number of socket pairs in the group.
+   *
+   * @readonly
+   */
+  readonly size: number
+
+  /**
+   * Whether this group was previously closed with {@link close}().
+   *
+   * @readonly
+   */
+  readonly closed: boolean
+
+  /**
+   * Creates a new group and starts its thread.
+   *
+   * @param options Thread options, which are only supported on Linux. See
+   * {@link Proxy.run}().
+   */
+  constructor(options?: {threadAffinity?: number[]; threadPriority?: number})
+
+  /**
+   * Starts proxying messages between two sockets. Before adding them, you
+   * must set any socket options, and connect or bind both sockets. The
+   * sockets can no longer be used until the pair is removed.
+   *
+   * @param frontEnd The front-end socket.
+   * @param backEnd The back-end socket.
+   * @returns An identifier of the pair.
+   */
+  add(frontEnd: Socket, backEnd: Socket): number
+
+  /**
+   * Stops proxying messages between the sockets of a pair and closes them.
+   *
+   * @param pair The identifier returned by {@link add}().
+   */
+  remove(pair: number): void
+
+  /**
+   * Temporarily suspends proxying messages between the sockets of a pair.
+   * Resume with {@link resume}().
+   *
+   * @param pair The identifier returned by {@link add}().
+   */
+  pause(pair: number): void
+
+  /**
+   * Resumes proxying messages between the sockets of a pair after suspending
+   * it with {@link pause}().
+   *
+   * @param pair The identifier returned by {@link add}().
+   */
+  resume(pair: number): void
+
+  /**
+   * Stops the thread of the group and closes the sockets of all pairs.
+   */
+  close(): void
+}
+
+/**
+ * Passes messages from a front-end socket to one of any number of back-end
+ * sockets, chosen by a key in each message, on a dedicated native thread. The
+ * key is a byte range of one message part. Messages with the same key always
+ * reach the same back-end, without the messages being received in JavaScript.
+ *
+ * ```typescript
+ * const frontEnd = new Router()
+ * await frontEnd.bind("tcp://*:3001")
+ *
+ * // Shard by the first 8 bytes of the part after the routing id.
+ * const shards = new ShardProxy(frontEnd, {part: 1, length: 8})
+ * for (const address of ["tcp://*:3002", "tcp://*:3003"]) {
+ *   const backEnd = new Dealer()
+ *   await backEnd.bind(address)
+ *   shards.add(backEnd)
+ * }
+ * ```
+ *
+ * Keys are assigned to back-ends with a consistent hash ring. Back-ends can be
+ * added and removed at any time; only the keys of the back-end that is added
+ * or removed move to another back-end. The ring only depends on the
+ * identifiers returned by {@link add}(), which are assigned in order, so
+ * adding back-ends in the same order results in the same assignment of keys.
+ *
+ * Messages from the back-ends are passed on to the front-end unchanged. A
+ * back-end that reaches its high water mark holds up the front-end, so that
+ * messages with the same key are never reordered.
+ */
+export declare class ShardProxy {
+  /**
+   * Returns the original front-end socket.
+   *
+   * @readonly
+   */
+  readonly frontEnd: Socket
+
+  /**
+   * The number of back-end sockets.
+   *
+   * @readonly
+   */
+  readonly size: number
+
+  /**
+   * Whether this shard proxy was previously closed with {@link close}().
+   *
+   * @readonly
+   */
+  readonly closed: boolean
+
+  /**
+   * Creates a new shard proxy and starts its thread. Before creating it, you
+   * must set any socket options, and connect or bind the front-end socket.
+   * Messages are not received from the front-end until a back-end is added.
+   *
+   * @param frontEnd The front-end socket.
+   * @param options Key and thread options.
+   * * `part` - The index of the message part that contains the key. Messages
+   *   without this part are all passed on to the same back-end. Defaults to
+   *   `0`.
+   * * `offset` - The offset of the key in the message part. Defaults to `0`.
+   * * `length` - The maximum length of the key. Defaults to the remainder of
+   *   the message part.
+   * * `threadAffinity`, `threadPriority` - Thread options, which are only
+   *   supported on Linux. See {@link Proxy.run}().
+   */
+  constructor(
+    frontEnd: Socket,
+    options?: {
+      part?: number
+      offset?: number
+      length?: number
+      threadAffinity?: number[]
+      threadPriority?: number
+    },
+  )
+
+  /**
+   * Starts passing on messages to a back-end socket. Before adding it, you
+   * must set any socket options, and connect or bind the socket. The socket
+   * can no longer be used until it is removed.
+   *
+   * @param backEnd The back-end socket.
+   * @returns An identifier of the back-end.
+   */
+  add(backEnd: Socket): number
+
+  /**
+   * Stops passing on messages to a back-end socket and closes it. Its keys
+   * are assigned to the remaining back-ends.
+   *
+   * @param shard The identifier returned by {@link add}().
+   */
+  remove(shard: number): void
+
+  /**
+   * Stops the thread and closes the front-end and all back-end sockets.
+   */
+  close(): void
+}
+
+/**
+ * Statistics of a service of a {@link Broker}, as returned by
+ * {@link Broker.statistics}().
+ */
+export interface BrokerStatistics {
+  /** The name of the service. */
+  service: string
+
+  /** The number of workers that have registered for the service. */
+  workers: number
+
+  /** The number of workers that are waiting for a request. */
+  idle: number
+
+  /** The number of requests that are waiting for a worker. */
+  queued: number
+
+  /** The number of requests received from clients. */
+  requests: number
+
+  /** The number of replies returned to clients. */
+  replies: number
+}
+
+/**
+ * Brokers requests between clients and workers following the Majordomo
+ * Protocol ([7/MDP](https://rfc.zeromq.org/spec/7/)), in a dedicated native
+ * thread. Clients and workers connect to the same router socket. Workers
+ * register for a service by name, and requests for a service are handed to
+ * its workers in least recently used order. Requests are queued while a
+ * service has no idle workers.
+ *
+ * ```typescript
+ * const router = new Router()
+ * await router.bind("tcp://*:5555")
+ *
+ * const broker = new Broker(router)
+ * await broker.run()
+ * ```
+ *
+ * Workers receive heartbeats, and are forgotten if they have not sent anything
+ * for a number of heartbeat intervals. This applies to busy workers as well,
+ * so workers must keep sending heartbeats while they handle a request. The
+ * broker enables the `mandatory` option of the router, so that a request is
+ * handed to the next worker if a worker has gone away without disconnecting.
+ */
+export declare class Broker {
+  /**
+   * Returns the original router socket.
+   *
+   * @readonly
+   */
+  readonly socket: Socket
+
+  /**
+   * Creates a new Majordomo broker. Brokering will start when {@link run}() is
+   * called after the socket has been bound or connected.
+   *
+   * @param socket The router socket that clients and workers connect to.
+   * @param options Heartbeat options.
+   * * `heartbeatInterval` - The interval in milliseconds at which workers
+   *   receive heartbeats, or `0` to disable heartbeats. Defaults to
+   *   `2500`.
+   * * `heartbeatLiveness` - The number of heartbeat intervals after which a
+   *   silent worker is forgotten. Defaults to `3`.
+   */
+  constructor(
+    socket: Socket,
+    options?: {heartbeatInterval?: number; heartbeatLiveness?: number},
+  )
+
+  /**
+   * Starts brokering in a dedicated native thread and waits for its
+   * termination. On termination the socket will be closed automatically.
+   *
+   * @param options Thread options, which are only supported on Linux. See
+   * {@link Proxy.run}().
+   * @returns Resolved when the broker has terminated.
+   */
+  run(options?: {
+    threadAffinity?: number[]
+    threadPriority?: number
+  }): Promise<void>
+
+  /**
+   * Gracefully shuts down the broker. The socket will be closed
+   * automatically. There might be a slight delay between terminating and the
+   * {@link run}() method resolving.
+   */
+  terminate(): void
+
+  /**
+   * Requests the statistics of all services of the running broker.
+   *
+   * @returns Resolved with the statistics as soon as the broker thread has
+   * finished handling its current messages. Rejected if the broker stops
+   * before it replies.
+   */
+  statistics(): Promise<BrokerStatistics[]>
+}
+
+/**
+ * Statistics of a {@link LastValueCache}, as returned by
+ * {@link LastValueCache.statistics}().
+ */
+export interface LastValueCacheStatistics {
+  /** The number of topics in the cache. */
+  topics: number
+
+  /** The total size in bytes of all cached messages. */
+  bytes: number
+
+  /** The number of subscriptions that matched at least one cached topic. */
+  hits: number
+
+  /** The number of subscriptions that did not match any cached topic. */
+  misses: number
+
+  /** The number of cached messages that were sent again to subscribers. */
+  replayed: number
+
+  /** The number of topics that were evicted to stay within the limits. */
+  evictions: number
+}
+
+/**
+ * Passes on messages from publishers to subscribers in a dedicated native
+ * thread, and keeps the last message of every topic. The topic of a message
+ * is its first frame. When a subscriber subscribes, the cached messages of all
+ * topics that match the subscription are sent again, so that a new subscriber
+ * does not have to wait for the next update of each topic.
+ *
+ * ```typescript
+ * const frontEnd = new XSubscriber()
+ * frontEnd.connect("tcp://publisher:5556")
+ *
+ * const backEnd = new XPublisher()
+ * await backEnd.bind("tcp://*:5557")
+ *
+ * const cache = new LastValueCache(frontEnd, backEnd)
+ * await cache.run()
+ * ```
+ *
+ * The front-end subscribes to the configured topics up front, so that they
+ * are cached before anyone subscribes to them. Subscriptions on the back-end
+ * are not passed on to the publishers. An XPublisher cannot send a message to
+ * a single subscriber, so other subscribers of a replayed topic receive the
+ * cached message again as well. The cache is bounded by a number of topics and
+ * a number of bytes, and evicts the least recently updated topics first.
+ */
+export declare class LastValueCache {
+  /**
+   * Returns the original front-end socket.
+   *
+   * @readonly
+   */
+  readonly frontEnd: Socket
+
+  /**
+   * Returns the original back-end socket.
+   *
+   * @readonly
+   */
+  readonly backEnd: Socket
+
+  /**
+   * Creates a new last value cache. Caching will start when {@link run}() is
+   * called after both sockets have been bound or connected.
+   *
+   * @param frontEnd The XSubscriber socket that receives the published
+   * messages.
+   * @param backEnd The XPublisher socket that subscribers connect to.
+   * @param options Cache options.
+   * * `topics` - The topic prefixes the front-end subscribes to. Defaults to
+   *   `[""]`, which caches all topics.
+   * * `maxTopics` - The maximum number of cached topics. Defaults to `65536`.
+   * * `maxBytes` - The maximum total size of all cached messages. The most
+   *   recent message is kept even if it exceeds this size on its own. Defaults
+   *   to 64 MiB.
+   */
+  constructor(
+    frontEnd: Socket,
+    backEnd: Socket,
+    options?: {
+      topics?: Array<string | Buffer>
+      maxTopics?: number
+      maxBytes?: number
+    },
+  )
+
+  /**
+   * Starts caching in a dedicated native thread and waits for its
+   * termination. On termination both sockets will be closed automatically.
+   *
+   * @param options Thread options, which are only supported on Linux. See
+   * {@link Proxy.run}().
+   * @returns Resolved when the cache has terminated.
+   */
+  run(options?: {
+    threadAffinity?: number[]
+    threadPriority?: number
+  }): Promise<void>
+
+  /**
+   * Gracefully shuts down the cache. Both sockets will be closed
+   * automatically. There might be a slight delay between terminating and the
+   * {@link run}() method resolving.
+   */
+  terminate(): void
+
+  /**
+   * Requests the statistics of the running cache.
+   *
+   * @returns Resolved with the statistics as soon as the cache thread has
+   * finished handling its current messages. Rejected if the cache stops
+   * before it replies.
+   */
+  statistics(): Promise<LastValueCacheStatistics>
+}
+
+/**
+ * Statistics of a worker slot of a {@link WorkerPool}, as returned by
+ * {@link WorkerPool.statistics}().
+ */
+export interface WorkerStatistics {
+  /** Whether a worker is attached to the slot. */
+  attached: boolean
+
+  /** The number of messages waiting in the queue of the slot. */
+  queued: number
+
+  /** The number of messages the worker is handling. */
+  active: number
+
+  /** The number of messages the worker has finished handling. */
+  processed: number
+
+  /** The number of messages the worker took from the queues of other slots. */
+  stolen: number
+
+  /**
+   * The fraction of time since the pool was created during which the worker
+   * was handling at least one message, between `0` and `1`.
+   */
+  utilization: number
+}
+
+/**
+ * Distributes messages over worker threads. Messages are sent to the pool with
+ * a {@link Push} socket that is connected to {@link address}. Worker threads
+ * receive them with a {@link PoolWorker} that is connected to
+ * {@link workerAddress}. Both addresses use the shared global context, so they
+ * can be used from any worker thread.
+ *
+ * ```typescript
+ * const pool = new WorkerPool({workers: 4})
+ * for (let i = 0; i < 4; i++) {
+ *   new Worker("./worker.js", {workerData: {address: pool.workerAddress}})
+ * }
+ *
+ * const sender = new Push()
+ * sender.connect(pool.address)
+ * await sender.send("task")
+ *
+ * // In worker.js
+ * const worker = new PoolWorker(workerData.address)
+ * for await (const [task] of worker) {
+ *   // handle task
+ * }
+ * ```
+ *
+ * Messages are dispatched by a native thread. Each worker has its own bounded
+ * queue and receives one message at a time, only after it has finished the
+ * previous one. New messages are queued for the worker with the least messages
+ * queued and in progress. A worker with an empty queue takes the most
+ * recently queued message of the longest other queue, so that workers are not
+ * held up by a slow message in front of them. When all queues are full, the
+ * pool stops accepting messages and senders wait until there is room again.
+ *
+ * With `affinity` enabled, the first part of each message is a key. All
+ * messages with the same key are queued for the same worker and are handled
+ * in order; they are never taken over by another worker. Messages with an
+ * empty key are distributed as usual.
+ */
+export declare class WorkerPool {
+  /**
+   * The address to which {@link Push} sockets connect to send messages to the
+   * pool.
+   *
+   * @readonly
+   */
+  readonly address: string
+
+  /**
+   * The address to which workers connect, see {@link PoolWorker}.
+   *
+   * @readonly
+   */
+  readonly workerAddress: string
+
+  /**
+   * Whether this pool was previously closed with {@link close}().
+   *
+   * @readonly
+   */
+  readonly closed: boolean
+
+  /**
+   * Creates a new pool and starts dispatching messages.
+   *
+   * @param options Pool options.
+   * * `workers` - The maximum number of attached workers. Defaults to the
+   *   number of CPU cores. Additional workers will not receive any messages.
+   * * `queueCapacity` - The maximum number of messages that are queued for
+   *   each worker. Defaults to `16`.
+   * * `affinity` - Whether the first part of each message is a key that
+   *   selects the worker. Defaults to `false`.
+   */
+  constructor(options?: {
+    workers?: number
+    queueCapacity?: number
+    affinity?: boolean
+  })
+
+  /**
+   * Returns statistics of every worker slot of the pool, which can be used to
+   * monitor the queue depths and the load of each worker.
+   */
+  statistics(): WorkerStatistics[]
+
+  /**
+   * Stops dispatching messages and closes the pool. Messages that have not
+   * been passed on to workers are discarded.
+   */
+  close(): void
+}
+
+/**
+ * Exchanges messages with another process on the same machine through shared
+ * memory, without sending them through the kernel. This is only available on
+ * Linux.
+ *
+ * One process creates a channel and passes its {@link descriptors} to the
+ * other process, for example as additional `stdio` entries when spawning it.
+ * The other process opens the channel by passing the descriptors it received
+ * to the constructor. Both sides can then send and receive messages.
+ *
+ * ```typescript
+ * const channel = new MemoryChannel()
+ * const child = spawn(process.execPath, ["child.js"], {
+ *   stdio: ["inherit", "inherit", "inherit", ...channel.descriptors],
+ * })
+ * await channel.send("hello")
+ *
+ * // In child.js
+ * const channel = new MemoryChannel({descriptors: [3, 4, 5]})
+ * const [msg] = await channel.receive()
+ * ```
+ *
+ * Each direction uses a ring of the given size in shared memory. Messages are
+ * copied into the ring by the sender and out of the ring by the receiver.
+ * When the ring is full, sending waits until the other side has received
+ * enough messages. A side is only woken up through its event descriptor while
+ * it waits, so no system calls are made while both sides are busy.
+ */
+export declare class MemoryChannel {
+  /**
+   * The descriptors of the shared memory and the event descriptors of both
+   * sides, which the other process passes to the constructor to open the
+   * channel.
+   *
+   * @readonly
+   */
+  readonly descriptors: number[]
+
+  /**
+   * Whether this channel was previously closed with {@link close}().
+   *
+   * @readonly
+   */
+  readonly closed: boolean
+
+  /**
+   * Creates a new channel, or opens a channel created by another process.
+   *
+   * @param options Channel options.
+   * * `size` - The size in bytes of the ring for each direction. Messages
+   *   must be smaller than half of this size. Defaults to 1 MiB.
+   * * `descriptors` - The {@link descriptors} of a channel created by another
+   *   process. The channel is opened instead of created if this is set.
+   */
+  constructor(options?: {size?: number; descriptors?: number[]})
+
+  /**
+   * Closes the channel. Pending send and receive operations are rejected with
+   * `EAGAIN`. Operations of the other process that wait for this side are
+   * rejected with `EPIPE`.
+   */
+  close(): void
 }
 
 /**
@@ -537,7 +1279,9 @@ export declare abstract class Socket {
   /**
    * Closes the socket and disposes of all resources. Any messages that are
    * queued may be discarded or sent in the background depending on the
-   * {@link linger} setting.
+   * {@link linger} setting. A pending {@link Writable.send}() is cancelled,
+   * and messages that are waiting behind it in the send queue are not sent;
+   * their promises are rejected with an `EBADF` error.
    *
    * After this method is called, it is no longer possible to call any other
    * methods on this socket.
@@ -551,6 +1295,78 @@ export declare abstract class Socket {
    */
   close(): void
 
+  /**
+   * Detaches the socket from the current thread, so that it can be adopted by
+   * another worker thread with {@link Socket.adopt}(). The connections of the
+   * socket and any messages queued by ØMQ are retained. After this method is
+   * called, the socket is considered closed in the current thread.
+   *
+   * Only sockets of the default global {@link context} can be detached. Thread
+   * safe sockets and sockets created with the `offload` option cannot be
+   * detached. Detaching fails with `EBUSY` while calls to
+   * {@link Readable.receive}() or {@link Writable.send}() are in progress.
+   *
+   * ```typescript
+   * const handle = socket.detach()
+   * worker.postMessage(handle)
+   * ```
+   *
+   * @returns A handle that can be sent to another thread with `postMessage()`.
+   */
+  detach(): SocketHandle
+
+  /**
+   * Creates a handle with which another worker thread can use this socket at
+   * the same time, by passing it to {@link Socket.adopt}(). This is only
+   * possible for thread safe sockets (such as `Server` and `Client`) of the
+   * default global {@link context}. Each handle can be adopted once; call this
+   * method once per thread that should use the socket.
+   *
+   * Every adopted socket polls the shared socket from its own thread, so that
+   * messages can be received and sent by all threads in parallel. A received
+   * message is only delivered to one of them. The underlying socket is closed
+   * once all threads have closed their socket.
+   *
+   * ```typescript
+   * const server = new Server()
+   * await server.bind("tcp://*:5555")
+   * for (const worker of workers) {
+   *   worker.postMessage(server.share())
+   * }
+   *
+   * // Worker thread
+   * parentPort.on("message", handle => {
+   *   const server = Server.adopt(handle)
+   * })
+   * ```
+   *
+   * If a {@link Readable.receiveTimeout} or {@link Writable.sendTimeout} is
+   * set, an operation may time out early when another thread has taken the
+   * message or capacity it was waiting for.
+   *
+   * @returns A handle that can be sent to another thread with `postMessage()`.
+   */
+  share(): SocketHandle
+
+  /**
+   * Adopts a socket that was detached with {@link detach}() or shared with
+   * {@link share}() in another thread.
+   * Call this method on the class of the detached socket, for example
+   * `Dealer.adopt(handle)`. The socket is polled by the event loop of the
+   * current thread from now on. Each handle can be adopted only once.
+   *
+   * Options such as {@link Readable.receiveTimeout} are retained. Sockets that
+   * are never adopted are closed when all threads have exited.
+   *
+   * @param handle The handle returned by {@link detach}().
+   * @returns The adopted socket.
+   */
+  static adopt<T extends Socket>(
+    // eslint-disable-next-line @typescript-eslint/ban-types
+    this: new (options?: {}) => T,
+    handle: SocketHandle,
+  ): T
+
   /**
    * Binds the socket to the given address. During {@link bind}() the socket
    * cannot be used. Do not call any other methods until the returned promise
@@ -148,9 +148,12 @@ Observer::Observer(const Napi::CallbackInfo& info)
     auto address = std::string("inproc://zmq.monitor.")
         + std::to_string(reinterpret_cast<uintptr_t>(this));
 
-    if (zmq_socket_monitor(target->socket, address.c_str(), ZMQ_EVENT_ALL) < 0) {
-        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
-        return;
+    {
+        Offload::Pause const pause(target->offload);
+        if (zmq_socket_monitor(target->socket, address.c_str(), ZMQ_EVENT_ALL) < 0) {
+            ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+            return;
+        }
     }
 
     auto* context = Context::Unwrap(target->context_ref.Value());
@@ -61,6 +61,7 @@ private:
 
         void ReadableCallback();
         void WritableCallback() {}
+        void WakeupCallback() {}
     };
 
     Napi::AsyncContext async_context;
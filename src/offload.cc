@@ -0,0 +1,223 @@
+#include "./offload.h"
+
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <string>
+
+#include "util/forward.h"
+
+namespace zmq {
+/* Commands sent over the control socket. */
+auto constexpr pause_command = 'P';
+auto constexpr resume_command = 'R';
+auto constexpr terminate_command = 'T';
+auto constexpr paused_reply = 'A';
+
+/* Interval in milliseconds at which the main thread checks whether the I/O
+   thread has stopped while it waits for the control socket. */
+auto constexpr exit_check_interval = 100L;
+
+Offload::~Offload() {
+    Stop();
+}
+
+int32_t Offload::Start(void* context, void* target) {
+    assert(!Active());
+
+    /* Use `this` pointer as unique identifier for the inproc endpoints. */
+    auto const address = std::string("inproc://zmq.offload.")
+        + std::to_string(reinterpret_cast<uintptr_t>(this));
+    auto const control_address = address + ".control";
+
+    const auto error = [this]() {
+        auto const err = zmq_errno();
+        CloseSocket(local);
+        CloseSocket(remote);
+        CloseSocket(local_control);
+        CloseSocket(remote_control);
+        errno = err;
+        return -1;
+    };
+
+    local = zmq_socket(context, ZMQ_PAIR);
+    remote = zmq_socket(context, ZMQ_PAIR);
+    local_control = zmq_socket(context, ZMQ_PAIR);
+    remote_control = zmq_socket(context, ZMQ_PAIR);
+
+    if (local == nullptr || remote == nullptr || local_control == nullptr
+        || remote_control == nullptr) {
+        return error();
+    }
+
+    if (zmq_bind(remote, address.c_str()) < 0
+        || zmq_connect(local, address.c_str()) < 0
+        || zmq_bind(remote_control, control_address.c_str()) < 0
+        || zmq_connect(local_control, control_address.c_str()) < 0) {
+        return error();
+    }
+
+    socket = target;
+    exited.store(false, std::memory_order_relaxed);
+    exit_error = 0;
+    thread = std::thread([this]() { Run(); });
+    return 0;
+}
+
+void Offload::Stop() {
+    if (!Active()) {
+        return;
+    }
+
+    SendCommand(terminate_command);
+    thread.join();
+
+    CloseSocket(local);
+    CloseSocket(local_control);
+
+    socket = nullptr;
+    pauses = 0;
+}
+
+void Offload::Run() {
+    /* Executed in the I/O thread. Only the socket, the remote end of the PAIR
+       and the remote control socket may be accessed here. */
+    auto up = Flow::Drained;
+    auto down = Flow::Drained;
+
+    while (true) {
+        up = Forward(socket, remote, forward_batch_size);
+        down = Forward(remote, socket, forward_batch_size);
+
+        if (up == Flow::Terminated || down == Flow::Terminated) {
+            exit_error = ETERM;
+            break;
+        }
+
+        /* Wait for messages on either side, or for the side that blocked a
+           transfer to accept messages again. */
+        auto const socket_events = static_cast<int16_t>(
+            (up != Flow::Blocked ? ZMQ_POLLIN : 0)
+            | (down == Flow::Blocked ? ZMQ_POLLOUT : 0));
+        auto const remote_events = static_cast<int16_t>(
+            (down != Flow::Blocked ? ZMQ_POLLIN : 0)
+            | (up == Flow::Blocked ? ZMQ_POLLOUT : 0));
+
+        /* Commands are checked between batches, without waiting. */
+        auto const timeout = up == Flow::Limited || down == Flow::Limited ? 0L : -1L;
+
+        std::array<zmq_pollitem_t, 3> items{{
+            {socket, 0, socket_events, 0},
+            {remote, 0, remote_events, 0},
+            {remote_control, 0, ZMQ_POLLIN, 0},
+        }};
+
+        if (zmq_poll(items.data(), items.size(), timeout) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+
+            exit_error = zmq_errno();
+            down = Flow::Terminated;
+            break;
+        }
+
+        if ((items[2].revents & ZMQ_POLLIN) != 0 && !Control()) {
+            break;
+        }
+    }
+
+    /* Pass on any outgoing messages that were queued before termination. */
+    if (down != Flow::Terminated) {
+        Forward(remote, socket);
+    }
+
+    exited.store(true, std::memory_order_release);
+    CloseSocket(remote);
+    CloseSocket(remote_control);
+}
+
+bool Offload::Control() {
+    char command = 0;
+    while (zmq_recv(remote_control, &command, 1, 0) < 0) {
+        if (zmq_errno() != EINTR) {
+            exit_error = zmq_errno();
+            return false;
+        }
+    }
+
+    if (command == pause_command) {
+        while (zmq_send(remote_control, &paused_reply, 1, 0) < 0) {
+            if (zmq_errno() != EINTR) {
+                exit_error = zmq_errno();
+                return false;
+            }
+        }
+
+        /* Wait until the main thread is done accessing the socket. */
+        while (zmq_recv(remote_control, &command, 1, 0) < 0) {
+            if (zmq_errno() != EINTR) {
+                exit_error = zmq_errno();
+                return false;
+            }
+        }
+    }
+
+    return command != terminate_command;
+}
+
+bool Offload::AwaitControl(int16_t events) {
+    while (!exited.load(std::memory_order_acquire)) {
+        zmq_pollitem_t item{local_control, 0, events, 0};
+        auto const count = zmq_poll(&item, 1, exit_check_interval);
+        if (count > 0) {
+            return true;
+        }
+
+        if (count < 0 && zmq_errno() != EINTR) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void Offload::SendCommand(char command) {
+    /* A PAIR socket would block forever once the I/O thread has closed its
+       end, so commands are only sent while the thread is still there. */
+    while (zmq_send(local_control, &command, 1, ZMQ_DONTWAIT) < 0) {
+        if (zmq_errno() != EINTR
+            && (zmq_errno() != EAGAIN || !AwaitControl(ZMQ_POLLOUT))) {
+            return;
+        }
+    }
+}
+
+void Offload::Suspend() {
+    if (!Active() || pauses++ > 0) {
+        return;
+    }
+
+    SendCommand(pause_command);
+
+    /* Wait for the I/O thread to confirm it no longer accesses the socket, or
+       to have stopped, after which it never accesses the socket again. */
+    char reply = 0;
+    while (zmq_recv(local_control, &reply, 1, ZMQ_DONTWAIT) < 0) {
+        if (zmq_errno() != EINTR
+            && (zmq_errno() != EAGAIN || !AwaitControl(ZMQ_POLLIN))) {
+            return;
+        }
+    }
+}
+
+void Offload::Resume() {
+    if (pauses == 0) {
+        return;
+    }
+
+    if (--pauses == 0) {
+        SendCommand(resume_command);
+    }
+}
+}  // namespace zmq
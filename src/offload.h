@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "./zmq_inc.h"
+
+namespace zmq {
+/* Moves all I/O of a socket to a dedicated native thread. The thread passes
+   messages between the socket and an inproc PAIR socket for as long as the
+   receiving side accepts them, independently of the main thread. Inproc
+   pipes are lock-free single producer/single consumer queues, so messages
+   are exchanged without any further synchronisation. The main thread sends
+   and receives on the local end of the PAIR instead of the socket itself. */
+class Offload {
+public:
+    Offload() = default;
+
+    Offload(const Offload&) = delete;
+    Offload(Offload&&) = delete;
+    Offload& operator=(const Offload&) = delete;
+    Offload& operator=(Offload&&) = delete;
+    ~Offload();
+
+    /* Start the I/O thread for the given socket. Returns -1 and sets the ZMQ
+       errno on failure. The socket may no longer be accessed by the calling
+       thread, unless the I/O thread is paused. */
+    int32_t Start(void* context, void* target);
+
+    /* Stop the I/O thread and close all internal sockets. Outgoing messages
+       that have not been passed on to the socket are discarded. */
+    void Stop();
+
+    [[nodiscard]] bool Active() const {
+        return local != nullptr;
+    }
+
+    /* Returns the error that made the I/O thread stop on its own, typically
+       ETERM once the context was terminated, or 0 while it is running. No
+       messages are passed on after that. */
+    [[nodiscard]] int32_t Error() const {
+        return exited.load(std::memory_order_acquire) ? exit_error : 0;
+    }
+
+    /* The socket on which messages are sent and received by the main thread. */
+    [[nodiscard]] void* Local() const {
+        return local;
+    }
+
+    /* Suspend the I/O thread, so that the socket can be accessed safely by
+       the calling thread. Calls can be nested; the thread continues after
+       the last suspension is matched by a call to Resume(). A thread that has
+       stopped no longer accesses the socket, so this returns right away. */
+    void Suspend();
+    void Resume();
+
+    /* Suspends the I/O thread for as long as this object exists. */
+    class Pause {
+        Offload& offload;
+
+    public:
+        explicit Pause(Offload& offload) : offload(offload) {
+            offload.Suspend();
+        }
+
+        Pause(const Pause&) = delete;
+        Pause(Pause&&) = delete;
+        Pause& operator=(const Pause&) = delete;
+        Pause& operator=(Pause&&) = delete;
+        ~Pause() {
+            offload.Resume();
+        }
+    };
+
+private:
+    void Run();
+    [[nodiscard]] bool Control();
+    void SendCommand(char command);
+    [[nodiscard]] bool AwaitControl(int16_t events);
+
+    std::thread thread;
+
+    void* socket = nullptr;
+    void* local = nullptr;
+    void* remote = nullptr;
+    void* local_control = nullptr;
+    void* remote_control = nullptr;
+
+    uint32_t pauses = 0;
+
+    /* Set by the I/O thread once it no longer accesses the socket, before it
+       closes its end of the control socket. Commands are not answered after
+       that, so the main thread checks this while waiting for a reply. The
+       error is written before the flag is set. */
+    std::atomic<bool> exited{false};
+    int32_t exit_error = 0;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::Offload>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::Offload>, "not movable");
@@ -31,6 +31,10 @@ public:
         return &msg;
     }
 
+    [[nodiscard]] size_t size() const {
+        return zmq_msg_size(&msg);
+    }
+
 private:
     class Reference {
         Napi::Reference<Napi::Value> persistent;
@@ -70,6 +74,15 @@ public:
     bool SetRoutingId(Napi::Value value);
 #endif
 
+    /* Total size of all message parts in bytes. */
+    [[nodiscard]] size_t Size() const {
+        size_t size = 0;
+        for (const auto& part : parts) {
+            size += part.size();
+        }
+        return size;
+    }
+
     void Clear() {
         parts.clear();
     }
@@ -163,11 +163,13 @@ private:
 
     /* Callback is called when FD is set to a readable state. This is an
        edge trigger that should allow us to check for read AND write events.
-       There is no guarantee that any events are available. */
+       There is no guarantee that any events are available, but any event
+       state that was cached by the owner is now stale. */
     static void Callback(uv_poll_t* poll, int32_t status, int32_t /*events*/) {
         if (status == 0) {
             // NOLINTNEXTLINE(*-pro-type-reinterpret-cast)
             auto& poller = *static_cast<Poller*>(poll->data);
+            static_cast<T&>(poller).WakeupCallback();
             poller.TriggerReadable();
             poller.TriggerWritable();
         }
@@ -1,28 +1,95 @@
 
 #include "./proxy.h"
 
+#include <array>
+#include <cmath>
 #include <cstdint>
 
+#include "./capture_proxy.h"
 #include "./context.h"
 #include "./module.h"
 #include "./socket.h"
 #include "util/arguments.h"
 #include "util/async_scope.h"
 #include "util/error.h"
-#include "util/uvwork.h"
+#include "util/string_or_buffer.h"
+#include "util/thread.h"
+#include "util/uvthread.h"
 
 #ifdef ZMQ_HAS_STEERABLE_PROXY
 
 namespace zmq {
 struct ProxyContext {
     std::string address;
+    ThreadOptions thread_options;
+    void* capture = nullptr;
+    CaptureProxy::Filter filter;
     uint32_t error = 0;
 
-    explicit ProxyContext(std::string&& address) : address(std::move(address)) {}
+    explicit ProxyContext(std::string&& address, ThreadOptions&& thread_options)
+        : address(std::move(address)), thread_options(std::move(thread_options)) {}
 };
 
+/* Reads an optional integer option of at least the given minimum. Returns
+   false and throws if the option is invalid. */
+static bool GetInteger(const Napi::Object& options, const char* name, const char* msg,
+    double min, uint32_t& value) {
+    if (!options.Has(name)) {
+        return true;
+    }
+
+    auto const option = options.Get(name);
+    if (option.IsUndefined()) {
+        return true;
+    }
+
+    if (option.IsNumber()) {
+        auto const number = option.As<Napi::Number>().DoubleValue();
+        if (number >= min && number <= UINT32_MAX && number == std::floor(number)) {
+            value = static_cast<uint32_t>(number);
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(options.Env(), msg).ThrowAsJavaScriptException();
+    return false;
+}
+
+/* Reads the capture socket and filter. Returns false and throws if any of the
+   options are invalid. */
+static bool ReadCapture(const Napi::Object& options, CaptureProxy::Filter& filter) {
+    if (!options.Get("socket").IsObject()) {
+        Napi::TypeError::New(options.Env(), "Capture socket must be a socket object")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    if (!GetInteger(options, "sample", "Capture sample must be a positive integer", 1,
+            filter.sample)
+        || !GetInteger(options, "part", "Capture part must be a non-negative integer", 0,
+            filter.part)
+        || !GetInteger(options, "truncate",
+            "Capture truncate must be a non-negative integer", 0, filter.truncate)) {
+        return false;
+    }
+
+    if (options.Has("prefix")) {
+        auto const prefix = options.Get("prefix");
+        if (prefix.IsString() || prefix.IsBuffer()) {
+            filter.prefix = convert_string_or_buffer(prefix);
+        } else if (!prefix.IsUndefined()) {
+            Napi::TypeError::New(
+                options.Env(), "Capture prefix must be a string or buffer")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    return true;
+}
+
 Proxy::Proxy(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<Proxy>(info), async_context(Env(), "Proxy"),
+    : Napi::ObjectWrap<Proxy>(info), async_context(Env(), "Proxy"), poller(*this),
       module(*static_cast<Module*>(info.Data())) {
     Arg::Validator const args{
         Arg::Required<Arg::Object>("Front-end must be a socket object"),
@@ -51,10 +118,39 @@ Proxy::~Proxy() = default;
 void Proxy::Close() {}
 
 Napi::Value Proxy::Run(const Napi::CallbackInfo& info) {
-    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+    Arg::Validator const args{
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
         return Env().Undefined();
     }
 
+    ThreadOptions thread_options;
+    CaptureProxy::Filter filter;
+    Napi::Object capture_options;
+
+    if (info[0].IsObject()) {
+        auto options = info[0].As<Napi::Object>();
+        if (!thread_options.Read(options)) {
+            return Env().Undefined();
+        }
+
+        if (options.Has("capture")) {
+            auto const capture = options.Get("capture");
+            if (capture.IsObject()) {
+                capture_options = capture.As<Napi::Object>();
+                if (!ReadCapture(capture_options, filter)) {
+                    return Env().Undefined();
+                }
+            } else if (!capture.IsUndefined()) {
+                Napi::TypeError::New(Env(), "Capture must be an object")
+                    .ThrowAsJavaScriptException();
+                return Env().Undefined();
+            }
+        }
+    }
+
     auto* front = Socket::Unwrap(front_ref.Value());
     if (Env().IsExceptionPending()) {
         return Env().Undefined();
@@ -77,6 +173,39 @@ Napi::Value Proxy::Run(const Napi::CallbackInfo& info) {
         return Env().Undefined();
     }
 
+    /* The proxy takes over the sockets in a worker thread. */
+    if (front->offload.Active() || back->offload.Active()) {
+        ErrnoException(Env(), EINVAL, "Sockets with offloaded I/O cannot be proxied")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    Socket* capture = nullptr;
+    if (!capture_options.IsEmpty()) {
+        capture = Socket::Unwrap(capture_options.Get("socket").As<Napi::Object>());
+        if (Env().IsExceptionPending()) {
+            return Env().Undefined();
+        }
+
+        if (capture->endpoints == 0) {
+            ErrnoException(Env(), EINVAL, "Capture socket must be bound or connected")
+                .ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+
+        if (capture->offload.Active()) {
+            ErrnoException(Env(), EINVAL, "Sockets with offloaded I/O cannot be proxied")
+                .ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+
+        if (capture->state == Socket::State::Blocked) {
+            ErrnoException(Env(), EBUSY, "Socket is blocked by another operation")
+                .ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+    }
+
     auto* context = Context::Unwrap(front->context_ref.Value());
     if (Env().IsExceptionPending()) {
         return Env().Undefined();
@@ -104,35 +233,97 @@ Napi::Value Proxy::Run(const Napi::CallbackInfo& info) {
         return Env().Undefined();
     }
 
+    /* The proxy replies to statistics requests over the same socket. */
+    uv_os_sock_t file_descriptor = 0;
+    size_t length = sizeof(file_descriptor);
+    if (zmq_getsockopt(control_pub, ZMQ_FD, &file_descriptor, &length) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    if (poller.Initialize(Env(), file_descriptor) < 0) {
+        ErrnoException(Env(), errno).ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
     front->state = Socket::State::Blocked;
     back->state = Socket::State::Blocked;
 
     auto res = Napi::Promise::Deferred::New(Env());
-    auto run_ctx = std::make_shared<ProxyContext>(std::move(address));
+    auto run_ctx =
+        std::make_shared<ProxyContext>(std::move(address), std::move(thread_options));
+
+    /* The capture socket is only used by the proxy while it runs. */
+    if (capture != nullptr) {
+        capture->state = Socket::State::Blocked;
+        capture_ref.Reset(capture_options.Get("socket").As<Napi::Object>(), 1);
+        run_ctx->capture = capture->socket;
+        run_ctx->filter = std::move(filter);
+    }
 
     auto* front_ptr = front->socket;
     auto* back_ptr = back->socket;
 
-    auto status = UvQueue(
+    /* The proxy blocks its thread until it terminates, so it gets a thread of
+       its own instead of one of the few threads of the libuv thread pool. */
+    auto status = UvSpawn(
         Env(),
         [this, run_ctx, front_ptr, back_ptr]() {
-            /* Don't access V8 internals here! Executed in worker thread. */
+            /* Don't access V8 internals here! Executed in proxy thread. */
+            if (auto const err = run_ctx->thread_options.Apply(); err != 0) {
+                run_ctx->error = static_cast<uint32_t>(err);
+                return;
+            }
+
             if (zmq_bind(control_sub, run_ctx->address.c_str()) < 0) {
                 run_ctx->error = static_cast<uint32_t>(zmq_errno());
                 return;
             }
 
+            /* zmq_proxy_steerable() copies every message to the capture
+               socket and waits for it to accept them, so filtered capture
+               uses a proxy loop of its own. */
+            if (run_ctx->capture != nullptr) {
+                CaptureProxy proxy(
+                    front_ptr, back_ptr, run_ctx->capture, std::move(run_ctx->filter));
+                run_ctx->error = static_cast<uint32_t>(proxy.Run(control_sub));
+                return;
+            }
+
             if (zmq_proxy_steerable(front_ptr, back_ptr, nullptr, control_sub) < 0) {
                 run_ctx->error = static_cast<uint32_t>(zmq_errno());
                 return;
             }
         },
-        [this, front, back, run_ctx, res]() {
+        [this, front, back, capture, run_ctx, res]() {
             AsyncScope const scope(Env(), async_context);
 
             front->Close();
             back->Close();
 
+            /* Unlike the front-end and back-end, the capture socket remains
+               open. */
+            if (capture != nullptr) {
+                capture->state = Socket::State::Open;
+                capture_ref.Reset();
+
+                if (capture->request_close) {
+                    capture->Close();
+                }
+            }
+
+            /* Statistics that were requested while the proxy was terminating
+               are never answered. */
+            auto unanswered = std::move(statistics_requests);
+            statistics_requests.clear();
+            discarded_replies = 0;
+            poller.Close();
+
+            for (auto& request : unanswered) {
+                request.Reject(
+                    ErrnoException(Env(), EBADF, "Proxy has terminated").Value());
+            }
+
             [[maybe_unused]] auto err1 = zmq_close(control_pub);
             assert(err1 == 0);
 
@@ -152,7 +343,15 @@ Napi::Value Proxy::Run(const Napi::CallbackInfo& info) {
         });
 
     if (status < 0) {
-        ErrnoException(Env(), EBADF).ThrowAsJavaScriptException();
+        front->state = Socket::State::Open;
+        back->state = Socket::State::Open;
+        if (capture != nullptr) {
+            capture->state = Socket::State::Open;
+            capture_ref.Reset();
+        }
+
+        ErrnoException(Env(), status == UV_EAGAIN ? EAGAIN : EBADF)
+            .ThrowAsJavaScriptException();
         return Env().Undefined();
     }
 
@@ -198,6 +397,143 @@ void Proxy::Terminate(const Napi::CallbackInfo& info) {
     SendCommand("TERMINATE");
 }
 
+Napi::Value Proxy::Statistics(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+#ifdef ZMQ_HAS_PROXY_STATISTICS
+    SendCommand("STATISTICS");
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
+
+    /* Replies arrive in the order in which statistics were requested. */
+    auto res = Napi::Promise::Deferred::New(Env());
+    auto promise = res.Promise();
+
+    statistics_requests.push_back(std::move(res));
+    if (statistics_requests.size() == 1 && discarded_replies == 0) {
+        poller.PollReadable(0);
+        poller.TriggerReadable();
+    }
+
+    return promise;
+#else
+    ErrnoException(Env(), ENOTSUP, "Proxy statistics require ZeroMQ 4.3 or later")
+        .ThrowAsJavaScriptException();
+    return Env().Undefined();
+#endif
+}
+
+bool Proxy::HasReply() const {
+    if (control_pub == nullptr) {
+        return false;
+    }
+
+    int32_t events = 0;
+    size_t events_size = sizeof(events);
+    while (zmq_getsockopt(control_pub, ZMQ_EVENTS, &events, &events_size) < 0) {
+        if (zmq_errno() != EINTR) {
+            return false;
+        }
+    }
+
+    return (events & ZMQ_POLLIN) != 0;
+}
+
+int32_t Proxy::ReceiveReply(std::array<uint64_t, 8>& values) {
+    const auto more = [this]() {
+        int32_t value = 0;
+        size_t value_size = sizeof(value);
+        return zmq_getsockopt(control_pub, ZMQ_RCVMORE, &value, &value_size) == 0
+            && value != 0;
+    };
+
+    int32_t error = 0;
+    for (size_t index = 0; index < values.size() && error == 0; index++) {
+        auto size = -1;
+        do {
+            size = zmq_recv(
+                control_pub, &values.at(index), sizeof(uint64_t), ZMQ_DONTWAIT);
+        } while (size < 0 && zmq_errno() == EINTR);
+
+        if (size < 0) {
+            return zmq_errno();
+        }
+
+        /* Every part must be complete, and the last part must end the reply. */
+        if (static_cast<size_t>(size) != sizeof(uint64_t)
+            || more() != (index + 1 < values.size())) {
+            error = EPROTO;
+        }
+    }
+
+    /* Skip the rest of a malformed reply, so the next reply starts fresh. */
+    while (more()) {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        auto const received = zmq_msg_recv(&msg, control_pub, ZMQ_DONTWAIT);
+        zmq_msg_close(&msg);
+        if (received < 0 && zmq_errno() != EINTR) {
+            break;
+        }
+    }
+
+    return error;
+}
+
+void Proxy::ReceiveStatistics() {
+    AsyncScope const scope(Env(), async_context);
+
+    /* Replies to requests that were already rejected are dropped. */
+    while (discarded_replies > 0 && HasReply()) {
+        std::array<uint64_t, 8> values{};
+        ReceiveReply(values);
+        discarded_replies--;
+    }
+
+    while (discarded_replies == 0 && !statistics_requests.empty() && HasReply()) {
+        /* Message and byte counts received and sent by the front-end and by
+           the back-end, each as a separate part. */
+        std::array<uint64_t, 8> values{};
+        if (auto const error = ReceiveReply(values); error != 0) {
+            /* Replies can no longer be matched to requests reliably. Reject
+               all of them, and drop the replies that are still to come. */
+            auto rejected = std::move(statistics_requests);
+            statistics_requests.clear();
+            discarded_replies = rejected.size() - (error == EPROTO ? 1 : 0);
+
+            for (auto& request : rejected) {
+                request.Reject(ErrnoException(Env(), error).Value());
+            }
+
+            break;
+        }
+
+        auto const counters = [&](size_t offset) {
+            auto result = Napi::Object::New(Env());
+            result["messagesIn"] = static_cast<double>(values.at(offset));
+            result["bytesIn"] = static_cast<double>(values.at(offset + 1));
+            result["messagesOut"] = static_cast<double>(values.at(offset + 2));
+            result["bytesOut"] = static_cast<double>(values.at(offset + 3));
+            return result;
+        };
+
+        auto stats = Napi::Object::New(Env());
+        stats["frontEnd"] = counters(0);
+        stats["backEnd"] = counters(4);
+
+        auto res = std::move(statistics_requests.front());
+        statistics_requests.pop_front();
+        res.Resolve(stats);
+    }
+
+    if (!statistics_requests.empty() || discarded_replies > 0) {
+        poller.PollReadable(0);
+    }
+}
+
 Napi::Value Proxy::GetFrontEnd(const Napi::CallbackInfo& /*info*/) {
     return front_ref.Value();
 }
@@ -212,6 +548,7 @@ void Proxy::Initialize(Module& module, Napi::Object& exports) {
         InstanceMethod<&Proxy::Pause>("pause"),
         InstanceMethod<&Proxy::Resume>("resume"),
         InstanceMethod<&Proxy::Terminate>("terminate"),
+        InstanceMethod<&Proxy::Statistics>("statistics"),
 
         InstanceAccessor<&Proxy::GetFrontEnd>("frontEnd"),
         InstanceAccessor<&Proxy::GetBackEnd>("backEnd"),
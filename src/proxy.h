@@ -2,6 +2,12 @@
 
 #include <napi.h>
 
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "./poller.h"
 #include "./zmq_inc.h"
 #include "closable.h"
 
@@ -30,6 +36,7 @@ protected:
     inline void Pause(const Napi::CallbackInfo& info);
     inline void Resume(const Napi::CallbackInfo& info);
     inline void Terminate(const Napi::CallbackInfo& info);
+    inline Napi::Value Statistics(const Napi::CallbackInfo& info);
 
     inline Napi::Value GetFrontEnd(const Napi::CallbackInfo& info);
     inline Napi::Value GetBackEnd(const Napi::CallbackInfo& info);
@@ -37,7 +44,45 @@ protected:
 private:
     inline void SendCommand(const char* command);
 
+    /* Resolves pending statistics requests for which the proxy replied. */
+    [[nodiscard]] bool HasReply() const;
+    void ReceiveStatistics();
+
+    /* Receives all parts of a reply into the given values. Returns 0, or an
+       error if the reply could not be received or is malformed, in which
+       case any remaining parts of the reply are discarded. */
+    int32_t ReceiveReply(std::array<uint64_t, 8>& values);
+
+    class Poller : public zmq::Poller<Poller> {
+        std::reference_wrapper<Proxy> proxy;
+
+    public:
+        explicit Poller(std::reference_wrapper<Proxy> proxy) : proxy(proxy) {}
+
+        [[nodiscard]] bool ValidateReadable() const {
+            return proxy.get().HasReply();
+        }
+
+        [[nodiscard]] bool ValidateWritable() const {
+            return false;
+        }
+
+        void ReadableCallback() const {
+            proxy.get().ReceiveStatistics();
+        }
+
+        void WritableCallback() const {}
+        void WakeupCallback() const {}
+    };
+
     Napi::AsyncContext async_context;
+    Proxy::Poller poller;
+    std::deque<Napi::Promise::Deferred> statistics_requests;
+
+    /* Number of replies that are still to arrive for requests that were
+       rejected after a malformed reply. They are discarded on arrival. */
+    size_t discarded_replies = 0;
+
     Napi::ObjectReference front_ref;
     Napi::ObjectReference back_ref;
     Napi::ObjectReference capture_ref;
@@ -0,0 +1,294 @@
+#include "./proxy_engine.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <string>
+
+namespace zmq {
+/* Commands sent over the control socket. */
+auto constexpr add_command = 'A';
+auto constexpr remove_command = 'D';
+auto constexpr pause_command = 'P';
+auto constexpr resume_command = 'R';
+auto constexpr terminate_command = 'T';
+
+/* Interval in milliseconds at which the calling thread checks whether the
+   proxy thread has stopped while it waits for the control socket. */
+auto constexpr exit_check_interval = 100L;
+
+ProxyEngine::~ProxyEngine() {
+    Stop();
+}
+
+int32_t ProxyEngine::Start(void* context, const ThreadOptions& options) {
+    assert(!Active());
+
+    /* Use `this` pointer as unique identifier for the inproc endpoint. */
+    auto const control_address = std::string("inproc://zmq.proxyengine.")
+        + std::to_string(reinterpret_cast<uintptr_t>(this));
+
+    const auto error = [this]() {
+        auto const err = zmq_errno();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        errno = err;
+        return -1;
+    };
+
+    control = zmq_socket(context, ZMQ_PAIR);
+    remote_control = zmq_socket(context, ZMQ_PAIR);
+
+    if (control == nullptr || remote_control == nullptr) {
+        return error();
+    }
+
+    if (zmq_bind(remote_control, control_address.c_str()) < 0
+        || zmq_connect(control, control_address.c_str()) < 0) {
+        return error();
+    }
+
+    exited.store(false, std::memory_order_relaxed);
+    thread = std::thread([this, options]() { Run(options); });
+
+    /* The thread reports whether the thread options could be applied. */
+    int32_t status = 0;
+    if (!ReceiveValue(control, status)) {
+        status = zmq_errno();
+    }
+
+    if (status != 0) {
+        thread.join();
+        CloseSocket(control);
+        errno = status;
+        return -1;
+    }
+
+    return 0;
+}
+
+void ProxyEngine::Stop() {
+    if (!Active()) {
+        return;
+    }
+
+    /* A thread that has stopped on its own no longer reads commands. */
+    Command command;
+    command.type = terminate_command;
+    while (zmq_send(control, &command, sizeof(command), ZMQ_DONTWAIT) < 0) {
+        if (zmq_errno() != EINTR
+            && (zmq_errno() != EAGAIN || !AwaitControl(ZMQ_POLLOUT))) {
+            break;
+        }
+    }
+
+    thread.join();
+    CloseSocket(control);
+}
+
+int32_t ProxyEngine::Add(uint32_t id, void* front, void* back) {
+    Command command;
+    command.type = add_command;
+    command.id = id;
+    command.front = front;
+    command.back = back;
+    return Request(command);
+}
+
+int32_t ProxyEngine::Remove(uint32_t id) {
+    Command command;
+    command.type = remove_command;
+    command.id = id;
+    return Request(command);
+}
+
+int32_t ProxyEngine::Pause(uint32_t id) {
+    Command command;
+    command.type = pause_command;
+    command.id = id;
+    return Request(command);
+}
+
+int32_t ProxyEngine::Resume(uint32_t id) {
+    Command command;
+    command.type = resume_command;
+    command.id = id;
+    return Request(command);
+}
+
+int32_t ProxyEngine::Request(const Command& command) {
+    if (!Active()) {
+        errno = EBADF;
+        return -1;
+    }
+
+    /* The proxy thread handles commands after at most one batch of messages
+       per pair, so the reply arrives quickly even under sustained load. If
+       the thread has stopped instead, the request fails as if the engine was
+       no longer active. */
+    if (!AwaitControl(ZMQ_POLLOUT) || !SendValue(control, command)
+        || !AwaitControl(ZMQ_POLLIN)) {
+        errno = EBADF;
+        return -1;
+    }
+
+    int32_t status = 0;
+    if (!ReceiveValue(control, status)) {
+        return -1;
+    }
+
+    if (status != 0) {
+        errno = status;
+        return -1;
+    }
+
+    return 0;
+}
+
+bool ProxyEngine::AwaitControl(int16_t events) {
+    while (true) {
+        zmq_pollitem_t item{control, 0, events, 0};
+        auto const count = zmq_poll(&item, 1, exit_check_interval);
+        if (count > 0) {
+            return true;
+        }
+
+        if (count < 0 && zmq_errno() != EINTR) {
+            return false;
+        }
+
+        /* A reply that was sent just before the thread stopped is still
+           received, so the flag is only checked after polling. */
+        if (exited.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+}
+
+void ProxyEngine::Run(const ThreadOptions& options) {
+    /* Executed in the proxy thread. Only the sockets of the pairs and the
+       remote control socket may be accessed here. */
+    auto const status = options.Apply();
+    if (!SendValue(remote_control, status) || status != 0) {
+        CloseSocket(remote_control);
+        return;
+    }
+
+    std::vector<zmq_pollitem_t> items;
+
+    while (true) {
+        for (auto& pair : pairs) {
+            if (pair.paused || !pair.pending) {
+                continue;
+            }
+
+            pair.up = Forward(pair.front, pair.back, forward_batch_size);
+            pair.down = Forward(pair.back, pair.front, forward_batch_size);
+
+            /* Pairs with more messages are served again after commands and
+               the other pairs had their turn. */
+            pair.pending = pair.up == Flow::Limited || pair.down == Flow::Limited;
+        }
+
+        /* Wait for messages on either side of every pair that is not paused,
+           or for the side that blocked a transfer to accept messages again.
+           Pairs whose context was terminated are no longer polled. */
+        items.clear();
+        items.push_back({remote_control, 0, ZMQ_POLLIN, 0});
+
+        auto timeout = -1L;
+        for (auto const& pair : pairs) {
+            if (pair.pending && !pair.paused) {
+                timeout = 0;
+            }
+
+            auto const active = !pair.paused && pair.up != Flow::Terminated
+                && pair.down != Flow::Terminated;
+
+            auto const front_events = static_cast<int16_t>(
+                (pair.up != Flow::Blocked ? ZMQ_POLLIN : 0)
+                | (pair.down == Flow::Blocked ? ZMQ_POLLOUT : 0));
+            auto const back_events = static_cast<int16_t>(
+                (pair.down != Flow::Blocked ? ZMQ_POLLIN : 0)
+                | (pair.up == Flow::Blocked ? ZMQ_POLLOUT : 0));
+
+            items.push_back({pair.front, 0, active ? front_events : int16_t{0}, 0});
+            items.push_back({pair.back, 0, active ? back_events : int16_t{0}, 0});
+        }
+
+        if (zmq_poll(items.data(), static_cast<int>(items.size()), timeout) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        /* Commands may change the pairs, so their poll items are only
+           inspected if there was no command. */
+        if ((items[0].revents & ZMQ_POLLIN) != 0) {
+            if (!Control()) {
+                break;
+            }
+
+            continue;
+        }
+
+        for (size_t index = 0; index < pairs.size(); index++) {
+            if (items[1 + 2 * index].revents != 0 || items[2 + 2 * index].revents != 0) {
+                pairs[index].pending = true;
+            }
+        }
+    }
+
+    pairs.clear();
+    exited.store(true, std::memory_order_release);
+    CloseSocket(remote_control);
+}
+
+bool ProxyEngine::Control() {
+    Command command;
+    if (!ReceiveValue(remote_control, command)) {
+        return false;
+    }
+
+    if (command.type == terminate_command) {
+        return false;
+    }
+
+    return SendValue(remote_control, Apply(command));
+}
+
+int32_t ProxyEngine::Apply(const Command& command) {
+    if (command.type == add_command) {
+        Pair pair;
+        pair.id = command.id;
+        pair.front = command.front;
+        pair.back = command.back;
+        pairs.push_back(pair);
+        return 0;
+    }
+
+    auto const iter = std::find_if(pairs.begin(), pairs.end(),
+        [&](const Pair& pair) { return pair.id == command.id; });
+    if (iter == pairs.end()) {
+        return EINVAL;
+    }
+
+    switch (command.type) {
+    case remove_command:
+        pairs.erase(iter);
+        return 0;
+    case pause_command:
+        iter->paused = true;
+        return 0;
+    case resume_command:
+        /* Messages may have arrived while the pair was paused. */
+        iter->paused = false;
+        iter->pending = true;
+        return 0;
+    default:
+        return EINVAL;
+    }
+}
+}  // namespace zmq
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "./zmq_inc.h"
+#include "util/forward.h"
+#include "util/thread.h"
+
+namespace zmq {
+/* Proxies messages between any number of front-end/back-end socket pairs on
+   a single dedicated native thread. All sockets are polled together with an
+   inproc control socket, over which pairs are added, removed, paused and
+   resumed while the thread runs. Every command waits until the thread has
+   applied it, so that sockets that were removed are no longer accessed by the
+   thread afterwards.
+
+   Unlike zmq_proxy(), a destination that reaches its high water mark does not
+   block the thread; only the pair with the blocked destination stops
+   receiving until the destination accepts messages again. */
+class ProxyEngine {
+public:
+    ProxyEngine() = default;
+
+    ProxyEngine(const ProxyEngine&) = delete;
+    ProxyEngine(ProxyEngine&&) = delete;
+    ProxyEngine& operator=(const ProxyEngine&) = delete;
+    ProxyEngine& operator=(ProxyEngine&&) = delete;
+    ~ProxyEngine();
+
+    /* Start the proxy thread with the given thread options. Returns -1 and
+       sets the errno on failure. */
+    int32_t Start(void* context, const ThreadOptions& options);
+
+    /* Stop the proxy thread. The sockets of all pairs are left open. */
+    void Stop();
+
+    [[nodiscard]] bool Active() const {
+        return control != nullptr;
+    }
+
+    /* Commands for the pair with the given id. The sockets of a pair may not
+       be accessed by the calling thread until the pair was removed. Return -1
+       and set the errno on failure, which is EBADF once the proxy thread has
+       stopped on its own, for example because the context was terminated. */
+    int32_t Add(uint32_t id, void* front, void* back);
+    int32_t Remove(uint32_t id);
+    int32_t Pause(uint32_t id);
+    int32_t Resume(uint32_t id);
+
+private:
+    struct Command {
+        char type = 0;
+        uint32_t id = 0;
+        void* front = nullptr;
+        void* back = nullptr;
+    };
+
+    /* A socket pair; only accessed by the proxy thread. */
+    struct Pair {
+        uint32_t id = 0;
+        void* front = nullptr;
+        void* back = nullptr;
+        Flow up = Flow::Drained;
+        Flow down = Flow::Drained;
+        bool paused = false;
+        bool pending = true;
+    };
+
+    void Run(const ThreadOptions& options);
+    [[nodiscard]] bool Control();
+    [[nodiscard]] int32_t Apply(const Command& command);
+    int32_t Request(const Command& command);
+    [[nodiscard]] bool AwaitControl(int16_t events);
+
+    std::thread thread;
+
+    /* Set by the proxy thread before it closes its control socket, after
+       which commands would never be answered. */
+    std::atomic<bool> exited{false};
+
+    void* control = nullptr;
+    void* remote_control = nullptr;
+
+    std::vector<Pair> pairs;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::ProxyEngine>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::ProxyEngine>, "not movable");
@@ -0,0 +1,247 @@
+#include "./proxy_group.h"
+
+#include <cmath>
+
+#include "./module.h"
+#include "./socket.h"
+#include "util/arguments.h"
+#include "util/error.h"
+
+namespace zmq {
+ProxyGroup::ProxyGroup(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<ProxyGroup>(info), module(*static_cast<Module*>(info.Data())) {
+    Arg::Validator const args{
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    ThreadOptions thread_options;
+    if (info[0].IsObject() && !thread_options.Read(info[0].As<Napi::Object>())) {
+        return;
+    }
+
+    if (engine.Start(module.Global().SharedContext, thread_options) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return;
+    }
+
+    module.ObjectReaper.Add(this);
+}
+
+ProxyGroup::~ProxyGroup() {
+    Close();
+}
+
+void ProxyGroup::Close() {
+    if (engine.Active()) {
+        module.ObjectReaper.Remove(this);
+
+        Napi::HandleScope const scope(Env());
+
+        /* Stop the thread before any of the sockets are closed. */
+        engine.Stop();
+
+        for (auto& [id, pair] : pairs) {
+            Release(pair);
+        }
+
+        pairs.clear();
+    }
+}
+
+void ProxyGroup::Close(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    Close();
+}
+
+bool ProxyGroup::ValidateOpen() const {
+    if (!engine.Active()) {
+        ErrnoException(Env(), EBADF, "Proxy group is closed")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    return true;
+}
+
+Socket* ProxyGroup::ValidateSocket(const Napi::Value& value, const char* msg) {
+    auto* socket = Socket::Unwrap(value.As<Napi::Object>());
+    if (Env().IsExceptionPending()) {
+        return nullptr;
+    }
+
+    if (socket->endpoints == 0) {
+        ErrnoException(Env(), EINVAL, msg).ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    /* The proxy thread takes over the socket. */
+    if (socket->offload.Active()) {
+        ErrnoException(Env(), EINVAL, "Sockets with offloaded I/O cannot be proxied")
+            .ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    if (socket->state == Socket::State::Blocked) {
+        ErrnoException(Env(), EBUSY, "Socket is blocked by another operation")
+            .ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    return socket;
+}
+
+ProxyGroup::Pair* ProxyGroup::ValidatePair(const Napi::Value& value) {
+    auto const number = value.As<Napi::Number>().DoubleValue();
+    if (number >= 0 && number <= UINT32_MAX && number == std::floor(number)) {
+        auto const iter = pairs.find(static_cast<uint32_t>(number));
+        if (iter != pairs.end()) {
+            return &iter->second;
+        }
+    }
+
+    ErrnoException(Env(), EINVAL, "Pair does not exist").ThrowAsJavaScriptException();
+    return nullptr;
+}
+
+void ProxyGroup::Release(Pair& pair) {
+    /* Like a terminated proxy, a removed pair closes its sockets. */
+    Socket::Unwrap(pair.front_ref.Value())->Close();
+    Socket::Unwrap(pair.back_ref.Value())->Close();
+    pair.front_ref.Reset();
+    pair.back_ref.Reset();
+}
+
+Napi::Value ProxyGroup::Add(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Front-end must be a socket object"),
+        Arg::Required<Arg::Object>("Back-end must be a socket object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    auto* front = ValidateSocket(info[0], "Front-end socket must be bound or connected");
+    if (front == nullptr) {
+        return Env().Undefined();
+    }
+
+    auto* back = ValidateSocket(info[1], "Back-end socket must be bound or connected");
+    if (back == nullptr) {
+        return Env().Undefined();
+    }
+
+    if (front == back) {
+        ErrnoException(Env(), EINVAL, "Front-end and back-end must be different sockets")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    auto const id = next_id++;
+    if (engine.Add(id, front->socket, back->socket) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    /* The group closes the sockets when the pair is removed or the group is
+       closed, after the proxy thread no longer accesses them. */
+    front->state = Socket::State::Blocked;
+    back->state = Socket::State::Blocked;
+    module.ObjectReaper.Remove(front);
+    module.ObjectReaper.Remove(back);
+
+    auto& pair = pairs[id];
+    pair.front_ref.Reset(info[0].As<Napi::Object>(), 1);
+    pair.back_ref.Reset(info[1].As<Napi::Object>(), 1);
+
+    return Napi::Number::New(Env(), id);
+}
+
+void ProxyGroup::Remove(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Number>("Pair must be a number"),
+    };
+
+    if (args.ThrowIfInvalid(info) || !ValidateOpen()) {
+        return;
+    }
+
+    auto* pair = ValidatePair(info[0]);
+    if (pair == nullptr) {
+        return;
+    }
+
+    auto const id = info[0].As<Napi::Number>().Uint32Value();
+    if (engine.Remove(id) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return;
+    }
+
+    Release(*pair);
+    pairs.erase(id);
+}
+
+void ProxyGroup::Pause(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Number>("Pair must be a number"),
+    };
+
+    if (args.ThrowIfInvalid(info) || !ValidateOpen() || ValidatePair(info[0]) == nullptr) {
+        return;
+    }
+
+    if (engine.Pause(info[0].As<Napi::Number>().Uint32Value()) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+    }
+}
+
+void ProxyGroup::Resume(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Number>("Pair must be a number"),
+    };
+
+    if (args.ThrowIfInvalid(info) || !ValidateOpen() || ValidatePair(info[0]) == nullptr) {
+        return;
+    }
+
+    if (engine.Resume(info[0].As<Napi::Number>().Uint32Value()) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+    }
+}
+
+Napi::Value ProxyGroup::GetSize(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Number::New(Env(), static_cast<double>(pairs.size()));
+}
+
+Napi::Value ProxyGroup::GetClosed(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Boolean::New(Env(), !engine.Active());
+}
+
+void ProxyGroup::Initialize(Module& module, Napi::Object& exports) {
+    auto proto = {
+        InstanceMethod<&ProxyGroup::Close>("close"),
+        InstanceMethod<&ProxyGroup::Add>("add"),
+        InstanceMethod<&ProxyGroup::Remove>("remove"),
+        InstanceMethod<&ProxyGroup::Pause>("pause"),
+        InstanceMethod<&ProxyGroup::Resume>("resume"),
+
+        InstanceAccessor<&ProxyGroup::GetSize>("size"),
+        InstanceAccessor<&ProxyGroup::GetClosed>("closed"),
+    };
+
+    auto constructor = DefineClass(exports.Env(), "ProxyGroup", proto, &module);
+    module.ProxyGroup = Napi::Persistent(constructor);
+    exports.Set("ProxyGroup", constructor);
+}
+}  // namespace zmq
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "./closable.h"
+#include "./proxy_engine.h"
+
+namespace zmq {
+class Module;
+class Socket;
+
+class ProxyGroup : public Napi::ObjectWrap<ProxyGroup>, public Closable {
+public:
+    static void Initialize(Module& module, Napi::Object& exports);
+
+    explicit ProxyGroup(const Napi::CallbackInfo& info);
+
+    ProxyGroup(const ProxyGroup&) = delete;
+    ProxyGroup(ProxyGroup&&) = delete;
+    ProxyGroup& operator=(const ProxyGroup&) = delete;
+    ProxyGroup& operator=(ProxyGroup&&) = delete;
+    ~ProxyGroup() override;
+
+    void Close() override;
+
+protected:
+    inline void Close(const Napi::CallbackInfo& info);
+    inline Napi::Value Add(const Napi::CallbackInfo& info);
+    inline void Remove(const Napi::CallbackInfo& info);
+    inline void Pause(const Napi::CallbackInfo& info);
+    inline void Resume(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetSize(const Napi::CallbackInfo& info);
+    inline Napi::Value GetClosed(const Napi::CallbackInfo& info);
+
+private:
+    struct Pair {
+        Napi::ObjectReference front_ref;
+        Napi::ObjectReference back_ref;
+    };
+
+    [[nodiscard]] bool ValidateOpen() const;
+    [[nodiscard]] Socket* ValidateSocket(const Napi::Value& value, const char* msg);
+    [[nodiscard]] Pair* ValidatePair(const Napi::Value& value);
+    void Release(Pair& pair);
+
+    Module& module;
+    ProxyEngine engine;
+    std::unordered_map<uint32_t, Pair> pairs;
+    uint32_t next_id = 1;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::ProxyGroup>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::ProxyGroup>, "not movable");
@@ -0,0 +1,174 @@
+import {Readable} from "."
+import {Socket} from "./native"
+
+/* Layout of the ring; also see src/util/ring.h. */
+const writeIndex = 0
+const readIndex = 1
+const headerLength = 4
+const frameHeaderSize = 8
+const wrapLength = -1
+const moreFlag = 1
+
+/* Maximum time in milliseconds that pumpIntoRing() waits for the reader
+   before it checks again whether the socket was closed. */
+const readerTimeout = 100
+
+type WaitAsync = (
+  typedArray: Int32Array,
+  index: number,
+  value: number,
+  timeout?: number,
+) =>
+  | {async: false; value: "not-equal" | "timed-out"}
+  | {async: true; value: Promise<"ok" | "timed-out">}
+
+/* Atomics.waitAsync() is not available in all supported Node.js versions. */
+const waitAsync = (Atomics as {waitAsync?: WaitAsync}).waitAsync
+
+/**
+ * Creates a ring that can be passed to {@link Readable.receiveInto}() and
+ * shared with worker threads, for example with `postMessage()` or as
+ * `workerData`. The ring is backed by a `SharedArrayBuffer`.
+ *
+ * @param byteLength The size of the ring in bytes. It will be rounded up to a
+ * multiple of 4. Messages can be at most half this size.
+ */
+export function createRing(byteLength: number): Int32Array {
+  const length = Math.ceil(byteLength / Int32Array.BYTES_PER_ELEMENT)
+  return new Int32Array(
+    new SharedArrayBuffer(length * Int32Array.BYTES_PER_ELEMENT),
+  )
+}
+
+/**
+ * Reads messages from a ring that is written by
+ * {@link Readable.receiveInto}(). There may only be one reader per ring. A
+ * reader is typically used in a worker thread, while the socket remains in
+ * the main thread.
+ *
+ * ```typescript
+ * const reader = new RingReader(workerData.ring)
+ * while (true) {
+ *   reader.wait()
+ *   for (let msg = reader.read(); msg; msg = reader.read()) {
+ *     // handle message parts
+ *   }
+ * }
+ * ```
+ */
+export class RingReader {
+  private readonly ring: Int32Array
+  private readonly capacity: number
+
+  /**
+   * @param ring A ring created with {@link createRing}().
+   */
+  constructor(ring: Int32Array) {
+    this.ring = ring
+    this.capacity =
+      ring.byteLength - headerLength * Int32Array.BYTES_PER_ELEMENT
+  }
+
+  /**
+   * Reads the next message from the ring, if available. The message parts are
+   * copied, so that the space they occupied can be reused immediately.
+   *
+   * @returns The message parts, or `undefined` if the ring is empty.
+   */
+  read(): Buffer[] | undefined {
+    let offset = Atomics.load(this.ring, readIndex)
+    if (offset === Atomics.load(this.ring, writeIndex)) {
+      return undefined
+    }
+
+    const parts: Buffer[] = []
+    while (true) {
+      if (this.capacity - offset < frameHeaderSize) {
+        offset = 0
+      }
+
+      const index = headerLength + offset / Int32Array.BYTES_PER_ELEMENT
+      const length = this.ring[index]
+      if (length === wrapLength) {
+        offset = 0
+        continue
+      }
+
+      const start =
+        this.ring.byteOffset +
+        (headerLength * Int32Array.BYTES_PER_ELEMENT + offset + frameHeaderSize)
+      parts.push(Buffer.from(new Uint8Array(this.ring.buffer, start, length)))
+
+      offset += frameHeaderSize + Math.ceil(length / 4) * 4
+      if (offset === this.capacity) {
+        offset = 0
+      }
+
+      if ((this.ring[index + 1] & moreFlag) === 0) {
+        break
+      }
+    }
+
+    /* Wake up pumpIntoRing() if it waits for room in the ring. */
+    Atomics.store(this.ring, readIndex, offset)
+    Atomics.notify(this.ring, readIndex)
+    return parts
+  }
+
+  /**
+   * Blocks the current thread until the ring contains at least one message.
+   * This cannot be used on the main thread, because it blocks the event loop.
+   *
+   * @param timeout The maximum number of milliseconds to wait.
+   * @returns `false` if the timeout expired, `true` otherwise.
+   */
+  wait(timeout?: number): boolean {
+    const offset = Atomics.load(this.ring, readIndex)
+    return Atomics.wait(this.ring, writeIndex, offset, timeout) !== "timed-out"
+  }
+}
+
+/* Waits until the reader has moved the read index away from the given offset,
+   or until the timeout expires. Without Atomics.waitAsync(), the read index is
+   polled after a short delay instead. */
+async function waitForReader(ring: Int32Array, offset: number) {
+  if (waitAsync) {
+    const result = waitAsync(ring, readIndex, offset, readerTimeout)
+    if (result.async) {
+      await result.value
+    }
+    return
+  }
+
+  await new Promise(resolve => setTimeout(resolve, 1))
+}
+
+/**
+ * Receives messages from a socket into a ring until the socket is closed.
+ * Messages are written as they arrive; if the ring is full, writing resumes
+ * as soon as the reader has made room.
+ *
+ * @param socket The socket to receive messages from.
+ * @param ring A ring created with {@link createRing}().
+ * @returns Resolved when the socket has been closed.
+ */
+export async function pumpIntoRing(
+  socket: Socket & Readable,
+  ring: Int32Array,
+) {
+  while (!socket.closed) {
+    try {
+      /* The read index is taken before writing, so that room made by the
+         reader in the meantime is not waited for. */
+      const offset = Atomics.load(ring, readIndex)
+      if ((await socket.receiveInto(ring)) === 0) {
+        await waitForReader(ring, offset)
+      }
+    } catch (err) {
+      if (socket.closed) {
+        break
+      }
+      throw err
+    }
+  }
+}
@@ -0,0 +1,340 @@
+#include "./shard_engine.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <string>
+#include <string_view>
+
+#include "util/hash.h"
+
+namespace zmq {
+/* Commands sent over the control socket. */
+auto constexpr add_command = 'A';
+auto constexpr remove_command = 'D';
+auto constexpr terminate_command = 'T';
+
+/* The number of points of each back-end on the hash ring. More points spread
+   the keys more evenly over the back-ends. */
+auto constexpr ring_points = uint32_t{160};
+
+ShardEngine::~ShardEngine() {
+    Stop();
+}
+
+int32_t ShardEngine::Start(void* context, void* front_socket, const Key& shard_key,
+    const ThreadOptions& options) {
+    assert(!Active());
+
+    /* Use `this` pointer as unique identifier for the inproc endpoint. */
+    auto const control_address = std::string("inproc://zmq.shardengine.")
+        + std::to_string(reinterpret_cast<uintptr_t>(this));
+
+    const auto error = [this]() {
+        auto const err = zmq_errno();
+        CloseSocket(control);
+        CloseSocket(remote_control);
+        errno = err;
+        return -1;
+    };
+
+    control = zmq_socket(context, ZMQ_PAIR);
+    remote_control = zmq_socket(context, ZMQ_PAIR);
+
+    if (control == nullptr || remote_control == nullptr) {
+        return error();
+    }
+
+    if (zmq_bind(remote_control, control_address.c_str()) < 0
+        || zmq_connect(control, control_address.c_str()) < 0) {
+        return error();
+    }
+
+    front = front_socket;
+    key = shard_key;
+
+    thread = std::thread([this, options]() { Run(options); });
+
+    /* The thread reports whether the thread options could be applied. */
+    int32_t status = 0;
+    if (!ReceiveValue(control, status)) {
+        status = zmq_errno();
+    }
+
+    if (status != 0) {
+        thread.join();
+        CloseSocket(control);
+        errno = status;
+        return -1;
+    }
+
+    return 0;
+}
+
+void ShardEngine::Stop() {
+    if (!Active()) {
+        return;
+    }
+
+    Command command;
+    command.type = terminate_command;
+    SendValue(control, command);
+
+    thread.join();
+    CloseSocket(control);
+}
+
+int32_t ShardEngine::Add(uint32_t id, void* back) {
+    Command command;
+    command.type = add_command;
+    command.id = id;
+    command.back = back;
+    return Request(command);
+}
+
+int32_t ShardEngine::Remove(uint32_t id) {
+    Command command;
+    command.type = remove_command;
+    command.id = id;
+    return Request(command);
+}
+
+int32_t ShardEngine::Request(const Command& command) {
+    if (!Active()) {
+        errno = EBADF;
+        return -1;
+    }
+
+    int32_t status = 0;
+    if (!SendValue(control, command) || !ReceiveValue(control, status)) {
+        return -1;
+    }
+
+    if (status != 0) {
+        errno = status;
+        return -1;
+    }
+
+    return 0;
+}
+
+void ShardEngine::Run(const ThreadOptions& options) {
+    /* Executed in the shard thread. Only the front-end, the back-ends and the
+       remote control socket may be accessed here. */
+    auto const status = options.Apply();
+    if (!SendValue(remote_control, status) || status != 0) {
+        CloseSocket(remote_control);
+        return;
+    }
+
+    std::vector<zmq_pollitem_t> items;
+
+    while (true) {
+        if (pending && up != Flow::Terminated) {
+            up = Route();
+
+            /* More messages are routed after commands and replies had their
+               turn. */
+            pending = up == Flow::Limited;
+        }
+
+        auto replies_blocked = false;
+        auto terminated = up == Flow::Terminated;
+
+        for (auto& backend : backends) {
+            if (backend.pending && backend.down != Flow::Terminated) {
+                backend.down = Forward(backend.socket, front, forward_batch_size);
+                backend.pending = backend.down == Flow::Limited;
+            }
+
+            replies_blocked |= backend.down == Flow::Blocked;
+            terminated |= backend.down == Flow::Terminated;
+        }
+
+        /* Wait for messages on the front-end while no message is waiting, for
+           the back-end of a waiting message to accept messages again, or for
+           replies on any back-end. Once the context was terminated, only the
+           control socket is polled. */
+        items.clear();
+        items.push_back({remote_control, 0, ZMQ_POLLIN, 0});
+
+        /* Unfinished batches continue right after polling without waiting. */
+        auto timeout = -1L;
+        if (!terminated
+            && (pending
+                || std::any_of(backends.begin(), backends.end(),
+                    [](const Backend& backend) { return backend.pending; }))) {
+            timeout = 0;
+        }
+
+        auto const front_events = static_cast<int16_t>(
+            (up != Flow::Blocked ? ZMQ_POLLIN : 0) | (replies_blocked ? ZMQ_POLLOUT : 0));
+        items.push_back({front, 0, terminated ? int16_t{0} : front_events, 0});
+
+        for (auto const& backend : backends) {
+            auto const back_events = static_cast<int16_t>(
+                (backend.down != Flow::Blocked ? ZMQ_POLLIN : 0)
+                | (up == Flow::Blocked && blocked_id == backend.id ? ZMQ_POLLOUT : 0));
+            items.push_back(
+                {backend.socket, 0, terminated ? int16_t{0} : back_events, 0});
+        }
+
+        if (zmq_poll(items.data(), static_cast<int>(items.size()), timeout) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        /* Commands may change the back-ends, so their poll items are only
+           inspected if there was no command. */
+        if ((items[0].revents & ZMQ_POLLIN) != 0) {
+            if (!Control()) {
+                break;
+            }
+
+            continue;
+        }
+
+        if (items[1].revents != 0) {
+            pending = true;
+            for (auto& backend : backends) {
+                backend.pending |= backend.down == Flow::Blocked;
+            }
+        }
+
+        for (size_t index = 0; index < backends.size(); index++) {
+            if (items[2 + index].revents != 0) {
+                auto& backend = backends[index];
+                backend.pending = true;
+                pending |= up == Flow::Blocked && blocked_id == backend.id;
+            }
+        }
+    }
+
+    message.reset();
+    backends.clear();
+    ring.clear();
+    CloseSocket(remote_control);
+}
+
+Flow ShardEngine::Route() {
+    for (uint32_t count = 0;; count++) {
+        if (!message) {
+            if (count == forward_batch_size) {
+                return Flow::Limited;
+            }
+
+            message.emplace();
+
+            auto const received = message->Receive(front);
+            if (received <= 0) {
+                message.reset();
+                return received < 0 ? Flow::Terminated : Flow::Drained;
+            }
+        }
+
+        /* Without any back-ends, the message waits until one is added. */
+        auto* backend = Lookup(*message);
+        if (backend == nullptr) {
+            blocked_id = 0;
+            return Flow::Blocked;
+        }
+
+        auto const events = Events(backend->socket);
+        if (events < 0) {
+            return Flow::Terminated;
+        }
+
+        if ((events & ZMQ_POLLOUT) == 0 || !message->Send(backend->socket)) {
+            blocked_id = backend->id;
+            return Flow::Blocked;
+        }
+
+        message.reset();
+    }
+}
+
+ShardEngine::Backend* ShardEngine::Lookup(Frames& msg) {
+    if (ring.empty()) {
+        return nullptr;
+    }
+
+    /* Messages that lack the part or byte range are hashed as an empty key,
+       so they all reach the same back-end. */
+    std::string_view data;
+    if (key.part < msg.Size()) {
+        data = msg.Part(key.part);
+        data = key.offset < data.size() ? data.substr(key.offset, key.length)
+                                        : std::string_view{};
+    }
+
+    auto iter = ring.lower_bound(Mix(Hash(data)));
+    if (iter == ring.end()) {
+        iter = ring.begin();
+    }
+
+    return Find(iter->second);
+}
+
+ShardEngine::Backend* ShardEngine::Find(uint32_t id) {
+    auto const iter = std::find_if(backends.begin(), backends.end(),
+        [&](const Backend& backend) { return backend.id == id; });
+    return iter == backends.end() ? nullptr : &*iter;
+}
+
+bool ShardEngine::Control() {
+    Command command;
+    if (!ReceiveValue(remote_control, command)) {
+        return false;
+    }
+
+    if (command.type == terminate_command) {
+        return false;
+    }
+
+    return SendValue(remote_control, Apply(command));
+}
+
+int32_t ShardEngine::Apply(const Command& command) {
+    switch (command.type) {
+    case add_command: {
+        if (Find(command.id) != nullptr) {
+            return EINVAL;
+        }
+
+        Backend backend;
+        backend.id = command.id;
+        backend.socket = command.back;
+        backends.push_back(backend);
+
+        /* The points of a back-end only depend on its id, so the keys of the
+           other back-ends stay where they are. */
+        for (uint32_t point = 0; point < ring_points; point++) {
+            ring.emplace(Mix((uint64_t{command.id} << 32U) | point), command.id);
+        }
+        break;
+    }
+    case remove_command: {
+        auto const iter = std::find_if(backends.begin(), backends.end(),
+            [&](const Backend& backend) { return backend.id == command.id; });
+        if (iter == backends.end()) {
+            return EINVAL;
+        }
+
+        backends.erase(iter);
+        for (auto point = ring.begin(); point != ring.end();) {
+            point = point->second == command.id ? ring.erase(point) : std::next(point);
+        }
+        break;
+    }
+    default:
+        return EINVAL;
+    }
+
+    /* A waiting message may now be routed to another back-end. */
+    pending = true;
+    return 0;
+}
+}  // namespace zmq
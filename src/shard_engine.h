@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "./zmq_inc.h"
+#include "util/forward.h"
+#include "util/frames.h"
+#include "util/thread.h"
+
+namespace zmq {
+/* Passes messages from a front-end socket to one of any number of back-end
+   sockets on a dedicated native thread. The back-end is chosen by hashing a
+   byte range of one part of each message onto a consistent hash ring, so
+   that messages with the same key always reach the same back-end, and only
+   the keys of a back-end that is added or removed move to another back-end.
+   Messages from the back-ends are passed on to the front-end unchanged.
+
+   Back-ends are added and removed over an inproc control socket while the
+   thread runs. Every command waits until the thread has applied it, so that
+   sockets that were removed are no longer accessed by the thread afterwards.
+
+   A back-end that reaches its high water mark holds up the front-end until
+   it accepts messages again, because later messages with the same key must
+   not overtake the message that is waiting. */
+class ShardEngine {
+public:
+    /* The byte range of a message part that is hashed. */
+    struct Key {
+        uint32_t part = 0;
+        uint32_t offset = 0;
+        uint32_t length = UINT32_MAX;
+    };
+
+    ShardEngine() = default;
+
+    ShardEngine(const ShardEngine&) = delete;
+    ShardEngine(ShardEngine&&) = delete;
+    ShardEngine& operator=(const ShardEngine&) = delete;
+    ShardEngine& operator=(ShardEngine&&) = delete;
+    ~ShardEngine();
+
+    /* Start the thread for the given front-end socket. Returns -1 and sets
+       the errno on failure. */
+    int32_t Start(void* context, void* front, const Key& key,
+        const ThreadOptions& options);
+
+    /* Stop the thread. The front-end and all back-ends are left open. */
+    void Stop();
+
+    [[nodiscard]] bool Active() const {
+        return control != nullptr;
+    }
+
+    /* Commands for the back-end with the given id. The socket of a back-end
+       may not be accessed by the calling thread until it was removed. Return
+       -1 and set the errno on failure. */
+    int32_t Add(uint32_t id, void* back);
+    int32_t Remove(uint32_t id);
+
+private:
+    struct Command {
+        char type = 0;
+        uint32_t id = 0;
+        void* back = nullptr;
+    };
+
+    /* A back-end socket; only accessed by the thread. */
+    struct Backend {
+        uint32_t id = 0;
+        void* socket = nullptr;
+        Flow down = Flow::Drained;
+        bool pending = true;
+    };
+
+    void Run(const ThreadOptions& options);
+    [[nodiscard]] bool Control();
+    [[nodiscard]] int32_t Apply(const Command& command);
+    int32_t Request(const Command& command);
+
+    [[nodiscard]] Flow Route();
+    [[nodiscard]] Backend* Lookup(Frames& message);
+    [[nodiscard]] Backend* Find(uint32_t id);
+
+    std::thread thread;
+
+    void* control = nullptr;
+    void* remote_control = nullptr;
+
+    void* front = nullptr;
+    Key key;
+
+    std::vector<Backend> backends;
+
+    /* Points on the hash ring, each mapped to the id of a back-end. */
+    std::map<uint64_t, uint32_t> ring;
+
+    /* The message that waits for its back-end to accept messages. */
+    std::optional<Frames> message;
+    uint32_t blocked_id = 0;
+    Flow up = Flow::Drained;
+    bool pending = true;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::ShardEngine>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::ShardEngine>, "not movable");
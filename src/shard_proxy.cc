@@ -0,0 +1,235 @@
+#include "./shard_proxy.h"
+
+#include <cmath>
+
+#include "./module.h"
+#include "./socket.h"
+#include "util/arguments.h"
+#include "util/error.h"
+
+namespace zmq {
+/* Reads an optional non-negative integer option. Returns false and throws if
+   the option is invalid. */
+static bool GetIndex(
+    const Napi::Object& options, const char* name, const char* msg, uint32_t& value) {
+    if (!options.Has(name)) {
+        return true;
+    }
+
+    auto const option = options.Get(name);
+    if (option.IsUndefined()) {
+        return true;
+    }
+
+    if (option.IsNumber()) {
+        auto const number = option.As<Napi::Number>().DoubleValue();
+        if (number >= 0 && number <= UINT32_MAX && number == std::floor(number)) {
+            value = static_cast<uint32_t>(number);
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(options.Env(), msg).ThrowAsJavaScriptException();
+    return false;
+}
+
+ShardProxy::ShardProxy(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<ShardProxy>(info), module(*static_cast<Module*>(info.Data())) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Front-end must be a socket object"),
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    ShardEngine::Key key;
+    ThreadOptions thread_options;
+
+    if (info[1].IsObject()) {
+        auto options = info[1].As<Napi::Object>();
+        if (!GetIndex(options, "part", "Part must be a non-negative integer", key.part)
+            || !GetIndex(options, "offset", "Offset must be a non-negative integer",
+                key.offset)
+            || !GetIndex(options, "length", "Length must be a non-negative integer",
+                key.length)
+            || !thread_options.Read(options)) {
+            return;
+        }
+    }
+
+    auto* front = ValidateSocket(info[0], "Front-end socket must be bound or connected");
+    if (front == nullptr) {
+        return;
+    }
+
+    if (engine.Start(module.Global().SharedContext, front->socket, key, thread_options)
+        < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return;
+    }
+
+    /* The front-end is closed together with the shard proxy, after the thread
+       no longer accesses it. */
+    front->state = Socket::State::Blocked;
+    module.ObjectReaper.Remove(front);
+    front_ref.Reset(info[0].As<Napi::Object>(), 1);
+
+    module.ObjectReaper.Add(this);
+}
+
+ShardProxy::~ShardProxy() {
+    Close();
+}
+
+void ShardProxy::Close() {
+    if (engine.Active()) {
+        module.ObjectReaper.Remove(this);
+
+        Napi::HandleScope const scope(Env());
+
+        /* Stop the thread before any of the sockets are closed. */
+        engine.Stop();
+
+        for (auto& [id, back_ref] : backends) {
+            Socket::Unwrap(back_ref.Value())->Close();
+            back_ref.Reset();
+        }
+
+        backends.clear();
+
+        Socket::Unwrap(front_ref.Value())->Close();
+    }
+}
+
+void ShardProxy::Close(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    Close();
+}
+
+bool ShardProxy::ValidateOpen() const {
+    if (!engine.Active()) {
+        ErrnoException(Env(), EBADF, "Shard proxy is closed")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    return true;
+}
+
+Socket* ShardProxy::ValidateSocket(const Napi::Value& value, const char* msg) {
+    auto* socket = Socket::Unwrap(value.As<Napi::Object>());
+    if (Env().IsExceptionPending()) {
+        return nullptr;
+    }
+
+    if (socket->endpoints == 0) {
+        ErrnoException(Env(), EINVAL, msg).ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    /* The shard thread takes over the socket. */
+    if (socket->offload.Active()) {
+        ErrnoException(Env(), EINVAL, "Sockets with offloaded I/O cannot be proxied")
+            .ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    if (socket->state == Socket::State::Blocked) {
+        ErrnoException(Env(), EBUSY, "Socket is blocked by another operation")
+            .ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    return socket;
+}
+
+Napi::Value ShardProxy::Add(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Back-end must be a socket object"),
+    };
+
+    if (args.ThrowIfInvalid(info) || !ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    auto* back = ValidateSocket(info[0], "Back-end socket must be bound or connected");
+    if (back == nullptr) {
+        return Env().Undefined();
+    }
+
+    auto const id = next_id++;
+    if (engine.Add(id, back->socket) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    back->state = Socket::State::Blocked;
+    module.ObjectReaper.Remove(back);
+    backends[id].Reset(info[0].As<Napi::Object>(), 1);
+
+    return Napi::Number::New(Env(), id);
+}
+
+void ShardProxy::Remove(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Number>("Shard must be a number"),
+    };
+
+    if (args.ThrowIfInvalid(info) || !ValidateOpen()) {
+        return;
+    }
+
+    auto const number = info[0].As<Napi::Number>().DoubleValue();
+    auto const iter = number >= 0 && number <= UINT32_MAX && number == std::floor(number)
+        ? backends.find(static_cast<uint32_t>(number))
+        : backends.end();
+
+    if (iter == backends.end()) {
+        ErrnoException(Env(), EINVAL, "Shard does not exist")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    if (engine.Remove(iter->first) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return;
+    }
+
+    /* Like a removed proxy pair, a removed back-end is closed. */
+    Socket::Unwrap(iter->second.Value())->Close();
+    backends.erase(iter);
+}
+
+Napi::Value ShardProxy::GetFrontEnd(const Napi::CallbackInfo& /*info*/) {
+    return front_ref.Value();
+}
+
+Napi::Value ShardProxy::GetSize(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Number::New(Env(), static_cast<double>(backends.size()));
+}
+
+Napi::Value ShardProxy::GetClosed(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Boolean::New(Env(), !engine.Active());
+}
+
+void ShardProxy::Initialize(Module& module, Napi::Object& exports) {
+    auto proto = {
+        InstanceMethod<&ShardProxy::Close>("close"),
+        InstanceMethod<&ShardProxy::Add>("add"),
+        InstanceMethod<&ShardProxy::Remove>("remove"),
+
+        InstanceAccessor<&ShardProxy::GetFrontEnd>("frontEnd"),
+        InstanceAccessor<&ShardProxy::GetSize>("size"),
+        InstanceAccessor<&ShardProxy::GetClosed>("closed"),
+    };
+
+    auto constructor = DefineClass(exports.Env(), "ShardProxy", proto, &module);
+    module.ShardProxy = Napi::Persistent(constructor);
+    exports.Set("ShardProxy", constructor);
+}
+}  // namespace zmq
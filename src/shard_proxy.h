@@ -0,0 +1,51 @@
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "./closable.h"
+#include "./shard_engine.h"
+
+namespace zmq {
+class Module;
+class Socket;
+
+class ShardProxy : public Napi::ObjectWrap<ShardProxy>, public Closable {
+public:
+    static void Initialize(Module& module, Napi::Object& exports);
+
+    explicit ShardProxy(const Napi::CallbackInfo& info);
+
+    ShardProxy(const ShardProxy&) = delete;
+    ShardProxy(ShardProxy&&) = delete;
+    ShardProxy& operator=(const ShardProxy&) = delete;
+    ShardProxy& operator=(ShardProxy&&) = delete;
+    ~ShardProxy() override;
+
+    void Close() override;
+
+protected:
+    inline void Close(const Napi::CallbackInfo& info);
+    inline Napi::Value Add(const Napi::CallbackInfo& info);
+    inline void Remove(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetFrontEnd(const Napi::CallbackInfo& info);
+    inline Napi::Value GetSize(const Napi::CallbackInfo& info);
+    inline Napi::Value GetClosed(const Napi::CallbackInfo& info);
+
+private:
+    [[nodiscard]] bool ValidateOpen() const;
+    [[nodiscard]] Socket* ValidateSocket(const Napi::Value& value, const char* msg);
+
+    Module& module;
+    ShardEngine engine;
+    Napi::ObjectReference front_ref;
+    std::unordered_map<uint32_t, Napi::ObjectReference> backends;
+    uint32_t next_id = 1;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::ShardProxy>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::ShardProxy>, "not movable");
@@ -1,10 +1,13 @@
 #include "./socket.h"
 
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <unordered_set>
+#include <utility>
 
 #include "./context.h"
 #include "./incoming_msg.h"
@@ -14,8 +17,8 @@
 #include "util/async_scope.h"
 #include "util/error.h"
 #include "util/object.h"
+#include "util/ring.h"
 #include "util/string_or_buffer.h"
-#include "util/take.h"
 #include "util/uvdelayed.h"
 #include "util/uvwork.h"
 
@@ -24,6 +27,27 @@ namespace zmq {
    methods will force the returned promise to be resolved in the next tick. */
 [[maybe_unused]] auto constexpr max_sync_operations = 1U << 9U;
 
+/* The maximum number of receive operations that may be waiting for a message
+   at the same time. Receives beyond this limit are rejected with EBUSY. */
+auto constexpr max_queued_receives = 1U << 10U;
+
+/* The maximum number of messages that are received from a socket with topic
+   conflation on each receive. This bounds the time spent if messages arrive
+   faster than they can be drained. */
+auto constexpr max_conflated_messages = 1U << 14U;
+
+/* The maximum number of messages that are passed to routes on each dispatch.
+   Messages that arrive faster are left for the next dispatch. */
+auto constexpr max_routed_messages = 1U << 10U;
+
+/* The maximum number of routing ids interned by a router. This is far more
+   than the number of peers a router usually has, so that only a router with a
+   constantly changing set of peers will evict routing ids. */
+auto constexpr max_interned_routing_ids = 1U << 16U;
+
+/* Minimum number of bytes available for frames in a ring. */
+auto constexpr min_ring_capacity = 48U;
+
 /* Ordinary static cast for all available numeric types. */
 template <typename T>
 T NumberCast(const Napi::Number& num) {
@@ -80,8 +104,27 @@ Socket::Socket(const Napi::CallbackInfo& info)
 
     type = info[0].As<Napi::Number>().Int32Value();
 
+    bool offload_io = false;
+    double adopt_handle = 0;
     if (info[1].IsObject()) {
         auto options = info[1].As<Napi::Object>();
+        if (options.Has("adopt")) {
+            auto const handle = options.Get("adopt");
+            if (!handle.IsNumber()) {
+                Napi::TypeError::New(Env(), "Handle must be a number")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+
+            adopt_handle = handle.As<Napi::Number>().DoubleValue();
+            options.Delete("adopt");
+        }
+
+        if (options.Has("offload")) {
+            offload_io = options.Get("offload").ToBoolean();
+            options.Delete("offload");
+        }
+
         if (options.Has("context")) {
             context_ref.Reset(options.Get("context").As<Napi::Object>(), 1);
             options.Delete("context");
@@ -97,10 +140,40 @@ Socket::Socket(const Napi::CallbackInfo& info)
         return;
     }
 
-    socket = zmq_socket(context->context, type);
-    if (socket == nullptr) {
-        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
-        return;
+    if (adopt_handle != 0) {
+        /* Take over a socket that was detached by another agent/thread. The
+           registry lock acts as a full memory barrier between both threads. */
+        std::unique_ptr<DetachedSocket> detached;
+        if (adopt_handle >= 1 && adopt_handle == std::floor(adopt_handle)
+            && context->context == module.Global().SharedContext) {
+            auto const same_type = [this](const DetachedSocket& candidate) {
+                return candidate.type == type;
+            };
+
+            detached = module.Global().DetachedSockets.TakeIf(
+                static_cast<uint64_t>(adopt_handle), same_type);
+        }
+
+        if (detached == nullptr) {
+            ErrnoException(Env(), EINVAL, "Socket handle is invalid")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+
+        socket = std::exchange(detached->socket, nullptr);
+        shared = std::move(detached->shared);
+        send_timeout = detached->send_timeout;
+        receive_timeout = detached->receive_timeout;
+        busy_poll_micros = detached->busy_poll_micros;
+        send_queue_capacity = detached->send_queue_capacity;
+        endpoints = detached->endpoints;
+        conflate_topics = detached->conflate_topics;
+    } else {
+        socket = zmq_socket(context->context, type);
+        if (socket == nullptr) {
+            ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+            return;
+        }
     }
 
     auto file_descriptor = uv_os_sock_t{};
@@ -125,6 +198,13 @@ Socket::Socket(const Napi::CallbackInfo& info)
     }
 #endif
 
+    /* Thread safe sockets cannot be handed to another thread exclusively. */
+    if (thread_safe && offload_io) {
+        ErrnoException(Env(), EINVAL).ThrowAsJavaScriptException();
+        error();
+        return;
+    }
+
     std::function<void()> finalize = nullptr;
 
     /* Currently only some DRAFT sockets are threadsafe. */
@@ -166,8 +246,22 @@ Socket::Socket(const Napi::CallbackInfo& info)
         error();
 #endif
     } else {
+        io_socket = socket;
+
+        /* Move all I/O to a separate thread if requested. Messages are then
+           exchanged with that thread over an internal socket. */
+        if (offload_io) {
+            if (offload.Start(context->context, socket) < 0) {
+                ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+                error();
+                return;
+            }
+
+            io_socket = offload.Local();
+        }
+
         size_t length = sizeof(file_descriptor);
-        if (zmq_getsockopt(socket, ZMQ_FD, &file_descriptor, &length) < 0) {
+        if (zmq_getsockopt(io_socket, ZMQ_FD, &file_descriptor, &length) < 0) {
             ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
             error();
         }
@@ -246,52 +340,242 @@ bool Socket::ValidateOpen() const {
         ErrnoException(Env(), EBADF).ThrowAsJavaScriptException();
         return false;
     default:
-        return true;
+        break;
+    }
+
+    /* Messages are no longer passed on once the I/O thread has stopped. */
+    if (auto const error = offload.Error(); error != 0) {
+        ErrnoException(Env(), error, "I/O thread has stopped")
+            .ThrowAsJavaScriptException();
+        return false;
     }
+
+    return true;
 }
 
 bool Socket::HasEvents(uint32_t requested_events) const {
+    /* Events that were reported earlier in the same call are assumed to be
+       still available, unless they were used up since. */
+    if ((cached_events & requested_events) != 0) {
+        return true;
+    }
+
     uint32_t events = 0;
     size_t events_size = sizeof(events);
 
-    while (zmq_getsockopt(socket, ZMQ_EVENTS, &events, &events_size) < 0) {
+#ifdef ZMQ_COUNT_EVENTS
+    module.EventsQueries++;
+#endif
+
+    while (zmq_getsockopt(io_socket, ZMQ_EVENTS, &events, &events_size) < 0) {
         /* Ignore errors. */
         if (zmq_errno() != EINTR) {
             return false;
         }
     }
 
+    /* Thread safe sockets may be used by other threads, so only a fresh
+       query is reliable. */
+    if (!thread_safe) {
+        cached_events = events;
+    }
+
     return (events & requested_events) != 0;
 }
 
-void Socket::Close() {
-    if (socket != nullptr) {
-        module.ObjectReaper.Remove(this);
+void Socket::ConsumeEvents(uint32_t used_events) const {
+    /* REQ and REP sockets alternate between sending and receiving, so using
+       up one event changes the other as well. */
+    if (type == ZMQ_REQ || type == ZMQ_REP) {
+        cached_events = 0;
+        return;
+    }
 
-        Napi::HandleScope const scope(Env());
+    cached_events &= ~used_events;
+}
+
+bool Socket::BusyPoll(uint32_t requested_events) const {
+    /* Spin on the socket for a short while before falling back to the event
+       loop. This trades CPU time for avoiding the latency of a round trip
+       through the poller when a message is expected to arrive soon. */
+    if (busy_poll_micros <= 0) {
+        return false;
+    }
+
+    auto const deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(busy_poll_micros);
+
+    do {
+        if (HasEvents(requested_events)) {
+            return true;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    return false;
+}
+
+bool Socket::Readable() const {
+    /* A message that did not fit into a ring or a conflated message can be
+       delivered immediately. */
+    return !ring_pending.empty() || HasConflated() || HasEvents(ZMQ_POLLIN);
+}
+
+Socket::Features& Socket::EnsureFeatures() {
+    if (features == nullptr) {
+        features = std::make_unique<Features>(max_interned_routing_ids);
+    }
 
-        /* Clear endpoint count. */
-        endpoints = 0;
+    return *features;
+}
+
+void Socket::Close() {
+    if (socket != nullptr) {
+        auto* const released = Release();
 
-        /* Stop all polling and release event handlers. */
-        poller.Close();
+        /* Other handles may still use a shared socket. */
+        if (shared != nullptr) {
+            shared.reset();
+            return;
+        }
 
         /* Close succeeds unless socket is invalid. */
-        [[maybe_unused]] auto err = zmq_close(socket);
+        [[maybe_unused]] auto err = zmq_close(released);
         assert(err == 0);
+    }
+}
 
-        /* Release reference to context and observer. */
-        observer_ref.Reset();
-        context_ref.Reset();
+Napi::Value Socket::Detach(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
 
-        state = State::Closed;
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
 
-        /* Reset pointer to avoid double close. */
-        socket = nullptr;
+    if (poller.Reading() || poller.Writing() || !ring_pending.empty()
+        || HasConflated()) {
+        ErrnoException(Env(), EBUSY, "Socket is busy reading or writing")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    /* Only sockets in the shared context can be used by other agents/threads.
+       Thread safe sockets and offloaded sockets hold thread specific state. */
+    auto* context = Context::Unwrap(context_ref.Value());
+    if (thread_safe || offload.Active()
+        || context->context != module.Global().SharedContext) {
+        ErrnoException(Env(), EINVAL, "Socket cannot be detached")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    auto detached = CaptureState();
+
+    /* The socket is closed for this agent/thread, but remains connected. */
+    detached->socket = Release();
+
+    auto const handle = module.Global().DetachedSockets.Add(std::move(detached));
+    return Napi::Number::New(Env(), static_cast<double>(handle));
+}
+
+Napi::Value Socket::Share(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    auto* context = Context::Unwrap(context_ref.Value());
+    if (!thread_safe || context->context != module.Global().SharedContext) {
+        ErrnoException(Env(), EINVAL, "Socket cannot be shared")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    if (shared == nullptr) {
+        shared = std::shared_ptr<void>(socket, [](void* ptr) {
+            [[maybe_unused]] auto err = zmq_close(ptr);
+            assert(err == 0);
+        });
+    }
+
+    /* Each handle can be adopted once, and has its own poller. */
+    auto detached = CaptureState();
+    detached->socket = socket;
+    detached->shared = shared;
+
+    auto const handle = module.Global().DetachedSockets.Add(std::move(detached));
+    return Napi::Number::New(Env(), static_cast<double>(handle));
+}
+
+std::unique_ptr<DetachedSocket> Socket::CaptureState() const {
+    auto detached = std::make_unique<DetachedSocket>();
+    detached->type = type;
+    detached->send_timeout = send_timeout;
+    detached->receive_timeout = receive_timeout;
+    detached->busy_poll_micros = busy_poll_micros;
+    detached->send_queue_capacity = send_queue_capacity;
+    detached->endpoints = endpoints;
+    detached->conflate_topics = conflate_topics;
+    return detached;
+}
+
+Napi::Value Socket::Adopt(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Number>("Handle must be a number"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return info.Env().Undefined();
     }
+
+    /* Construct an instance of the class this method was called on. */
+    auto options = Napi::Object::New(info.Env());
+    options.Set("adopt", info[0]);
+    return info.This().As<Napi::Function>().New({options});
+}
+
+void* Socket::Release() {
+    module.ObjectReaper.Remove(this);
+
+    Napi::HandleScope const scope(Env());
+
+    /* Clear endpoint count. */
+    endpoints = 0;
+
+    /* Discard any message that was not written to a ring. */
+    ring_pending.clear();
+
+    /* Stop all polling and release event handlers. */
+    InvalidateEvents();
+    poller.Close();
+
+    state = State::Closed;
+
+    /* Discard conflated messages, and release all handlers and routing ids;
+       handlers may refer to this socket. */
+    features.reset();
+
+    /* Stop the I/O thread, if any, before the socket is closed. */
+    offload.Stop();
+
+    /* Release reference to context and observer. */
+    observer_ref.Reset();
+    context_ref.Reset();
+
+    /* Reset pointer to avoid double close. */
+    auto* const released = socket;
+    socket = nullptr;
+    io_socket = nullptr;
+    return released;
 }
 
 void Socket::Send(const Napi::Promise::Deferred& res, OutgoingMsg::Parts& parts) {
+    ConsumeEvents(ZMQ_POLLOUT);
+
     auto iter = parts.begin();
     auto end = parts.end();
 
@@ -300,7 +584,7 @@ void Socket::Send(const Napi::Promise::Deferred& res, OutgoingMsg::Parts& parts)
         iter++;
 
         auto const flags = iter == end ? ZMQ_DONTWAIT : ZMQ_DONTWAIT | ZMQ_SNDMORE;
-        while (zmq_msg_send(part.get(), socket, flags) < 0) {
+        while (zmq_msg_send(part.get(), io_socket, flags) < 0) {
             if (zmq_errno() != EINTR) {
                 res.Reject(ErrnoException(Env(), zmq_errno()).Value());
                 return;
@@ -311,21 +595,44 @@ void Socket::Send(const Napi::Promise::Deferred& res, OutgoingMsg::Parts& parts)
     res.Resolve(Env().Undefined());
 }
 
-void Socket::Receive(const Napi::Promise::Deferred& res) {
+void Socket::Receive(const Napi::Promise::Deferred& res, bool detach) {
     /* Return an array of message parts, or an array with a single message
        followed by a metadata object. */
     auto list = Napi::Array::New(Env(), 1);
 
+    ConsumeEvents(ZMQ_POLLIN);
+
     uint32_t i_part = 0;
     while (true) {
         IncomingMsg part;
-        while (zmq_msg_recv(part.get(), socket, ZMQ_DONTWAIT) < 0) {
+        while (zmq_msg_recv(part.get(), io_socket, ZMQ_DONTWAIT) < 0) {
             if (zmq_errno() != EINTR) {
                 res.Reject(ErrnoException(Env(), zmq_errno()).Value());
                 return;
             }
         }
 
+        if (track_subscriptions && i_part == 0) {
+            TrackSubscription(part.get());
+        }
+
+        if (detach) {
+            /* Metadata is not retained by detached messages. */
+            auto const more = zmq_msg_more(part.get()) != 0;
+            list[i_part++] = part.IntoHandle(Env(), module.Global().DetachedMsgs);
+            if (!more) {
+                break;
+            }
+
+            continue;
+        }
+
+        if (i_part == 0 && features != nullptr && features->routing_ids.Enabled()) {
+            /* Routing ids are always followed by other parts. */
+            list[i_part++] = features->routing_ids.Get(Env(), part.get());
+            continue;
+        }
+
         list[i_part++] = part.IntoBuffer(Env());
 
 #ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
@@ -373,6 +680,9 @@ Napi::Value Socket::Bind(const Napi::CallbackInfo& info) {
     auto res = Napi::Promise::Deferred::New(Env());
     auto run_ctx = std::make_shared<AddressContext>(info[0].As<Napi::String>());
 
+    /* The worker thread accesses the socket, so the I/O thread must wait. */
+    offload.Suspend();
+
     auto status = UvQueue(
         Env(),
         [this, run_ctx]() {
@@ -387,6 +697,7 @@ Napi::Value Socket::Bind(const Napi::CallbackInfo& info) {
         [this, run_ctx, res]() {
             AsyncScope const scope(Env(), async_context);
 
+            offload.Resume();
             state = Socket::State::Open;
             endpoints++;
 
@@ -405,6 +716,7 @@ Napi::Value Socket::Bind(const Napi::CallbackInfo& info) {
         });
 
     if (status < 0) {
+        offload.Resume();
         ErrnoException(Env(), EBADF).ThrowAsJavaScriptException();
         return Env().Undefined();
     }
@@ -428,6 +740,7 @@ Napi::Value Socket::BindSync(const Napi::CallbackInfo& info) {
     state = Socket::State::Blocked;
     auto run_ctx = std::make_shared<AddressContext>(info[0].As<Napi::String>());
 
+    Offload::Pause pause(offload);
     while (zmq_bind(socket, run_ctx->address.c_str()) < 0) {
         if (zmq_errno() != EINTR) {
             run_ctx->error = static_cast<uint32_t>(zmq_errno());
@@ -467,6 +780,9 @@ Napi::Value Socket::Unbind(const Napi::CallbackInfo& info) {
     auto res = Napi::Promise::Deferred::New(Env());
     auto run_ctx = std::make_shared<AddressContext>(info[0].As<Napi::String>());
 
+    /* The worker thread accesses the socket, so the I/O thread must wait. */
+    offload.Suspend();
+
     auto status = UvQueue(
         Env(),
         [this, run_ctx]() {
@@ -481,7 +797,9 @@ Napi::Value Socket::Unbind(const Napi::CallbackInfo& info) {
         [this, run_ctx, res]() {
             AsyncScope const scope(Env(), async_context);
 
+            offload.Resume();
             state = Socket::State::Open;
+            InvalidateEvents();
             --endpoints;
 
             if (request_close) {
@@ -499,6 +817,7 @@ Napi::Value Socket::Unbind(const Napi::CallbackInfo& info) {
         });
 
     if (status < 0) {
+        offload.Resume();
         ErrnoException(Env(), EBADF).ThrowAsJavaScriptException();
         return Env().Undefined();
     }
@@ -522,6 +841,7 @@ Napi::Value Socket::UnbindSync(const Napi::CallbackInfo& info) {
     state = Socket::State::Blocked;
     auto run_ctx = std::make_shared<AddressContext>(info[0].As<Napi::String>());
 
+    Offload::Pause pause(offload);
     while (zmq_unbind(socket, run_ctx->address.c_str()) < 0) {
         if (zmq_errno() != EINTR) {
             run_ctx->error = static_cast<uint32_t>(zmq_errno());
@@ -530,6 +850,7 @@ Napi::Value Socket::UnbindSync(const Napi::CallbackInfo& info) {
     }
 
     state = Socket::State::Open;
+    InvalidateEvents();
     --endpoints;
 
     if (request_close) {
@@ -558,6 +879,8 @@ void Socket::Connect(const Napi::CallbackInfo& info) {
     }
 
     std::string const address = info[0].As<Napi::String>();
+
+    Offload::Pause const pause(offload);
     if (zmq_connect(socket, address.c_str()) < 0) {
         ErrnoException(Env(), zmq_errno(), address).ThrowAsJavaScriptException();
         return;
@@ -580,11 +903,14 @@ void Socket::Disconnect(const Napi::CallbackInfo& info) {
     }
 
     std::string const address = info[0].As<Napi::String>();
+
+    Offload::Pause const pause(offload);
     if (zmq_disconnect(socket, address.c_str()) < 0) {
         ErrnoException(Env(), zmq_errno(), address).ThrowAsJavaScriptException();
         return;
     }
 
+    InvalidateEvents();
     --endpoints;
 }
 
@@ -603,6 +929,8 @@ void Socket::Close(const Napi::CallbackInfo& info) {
 }
 
 Napi::Value Socket::Send(const Napi::CallbackInfo& info) {
+    InvalidateEvents();
+
 #ifdef _MSC_VER
 #pragma warning(disable : 4065)
 #endif
@@ -638,7 +966,7 @@ Napi::Value Socket::Send(const Napi::CallbackInfo& info) {
         return Env().Undefined();
     }
 
-    if (poller.Writing()) {
+    if (poller.Writing() && send_queue_capacity == 0) {
         ErrnoException(Env(), EBUSY,
             "Socket is busy writing; only one send operation may be in progress "
             "at any time")
@@ -666,6 +994,19 @@ Napi::Value Socket::Send(const Napi::CallbackInfo& info) {
     }
 #endif
 
+    if (poller.Writing()) {
+        /* Queue behind the pending send operations, unless this would exceed
+           the capacity of the send queue. */
+        auto const size = parts.Size();
+        if (poller.WriteQueueSize() + size > static_cast<size_t>(send_queue_capacity)) {
+            ErrnoException(Env(), EBUSY, "Socket is busy writing; send queue is full")
+                .ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+
+        return poller.WritePromise(std::move(parts));
+    }
+
     if (send_timeout == 0 || HasEvents(ZMQ_POLLOUT)) {
         /* We can send on the socket immediately. This is a fast path. NOTE: We
            must make sure to not keep returning synchronously resolved promises,
@@ -703,8 +1044,21 @@ Napi::Value Socket::Send(const Napi::CallbackInfo& info) {
     return poller.WritePromise(std::move(parts));
 }
 
-Napi::Value Socket::Receive(const Napi::CallbackInfo& info) {
-    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+Napi::Value Socket::SendToMany(const Napi::CallbackInfo& info) {
+    InvalidateEvents();
+
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Envelopes must be an array"),
+        Arg::Required<Arg::NotUndefined>("Payload must be present"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!info[0].IsArray()) {
+        Napi::TypeError::New(Env(), "Envelopes must be an array")
+            .ThrowAsJavaScriptException();
         return Env().Undefined();
     }
 
@@ -712,88 +1066,803 @@ Napi::Value Socket::Receive(const Napi::CallbackInfo& info) {
         return Env().Undefined();
     }
 
-    if (poller.Reading()) {
-        ErrnoException(Env(), EBUSY,
-            "Socket is busy reading; only one receive operation may be in "
-            "progress at any time")
+    /* Messages must not overtake messages that are waiting to be sent. */
+    if (poller.Writing()) {
+        ErrnoException(Env(), EBUSY, "Socket is busy writing")
             .ThrowAsJavaScriptException();
         return Env().Undefined();
     }
 
-    if (receive_timeout == 0 || HasEvents(ZMQ_POLLIN)) {
-        /* We can read from the socket immediately. This is a fast path.
-           Also see the related comments in Send(). */
-#ifdef ZMQ_NO_SYNC_RESOLVE
-        Warn(Env(), "Promise resolution by receive() is delayed (ZMQ_NO_SYNC_RESOLVE).");
-#else
-        if (receive_timeout == 0 || sync_operations++ < max_sync_operations) {
-            auto res = Napi::Promise::Deferred::New(Env());
-            Receive(res);
+    /* The payload is only converted once. Every destination receives a copy
+       that shares the data with the original. */
+    OutgoingMsg::Parts payload(info[1], module);
+    if (Env().IsExceptionPending()) {
+        return Env().Undefined();
+    }
 
-            /* This operation may have caused a state change, so we must also
-               update the poller state manually! */
-            poller.TriggerWritable();
-            return res.Promise();
-        }
-#endif
+    if (payload.begin() == payload.end()) {
+        ErrnoException(Env(), EINVAL, "Payload must not be empty")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
 
-        /* We can read from the socket immediately, but we don't, in order to
-           avoid starving the event loop. Reads will be delayed. */
-        UvScheduleDelayed(Env(), [&]() {
-            poller.ReadableCallback();
-            if (socket == nullptr) {
-                return;
+    /* Sends a part, or returns the error. */
+    auto const send = [this](zmq_msg_t* msg, int32_t flags) -> int32_t {
+        while (zmq_msg_send(msg, io_socket, flags) < 0) {
+            if (zmq_errno() != EINTR) {
+                return zmq_errno();
             }
-            poller.TriggerWritable();
-        });
-    } else {
-        poller.PollReadable(receive_timeout);
-    }
+        }
 
-    return poller.ReadPromise();
-}
+        return 0;
+    };
 
-void Socket::Join([[maybe_unused]] const Napi::CallbackInfo& info) {
-#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
-    for (size_t i_value = 0; i_value < info.Length(); ++i_value) {
-        const auto& value = info[i_value];
-        this->JoinElement(value);
-    }
-#endif
-}
+    /* All envelopes are converted before anything is sent, so that invalid
+       envelopes are rejected without sending any message. */
+    auto const array = info[0].As<Napi::Array>();
+    std::vector<OutgoingMsg::Parts> envelopes;
+    envelopes.reserve(array.Length());
+    for (uint32_t index = 0; index < array.Length(); index++) {
+        auto& envelope = envelopes.emplace_back(array.Get(index), module);
+        if (Env().IsExceptionPending()) {
+            return Env().Undefined();
+        }
 
-void Socket::JoinElement([[maybe_unused]] const Napi::Value& value) {
-#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
-    if (!ValidateOpen()) {
-        return;
+        if (envelope.begin() == envelope.end()) {
+            ErrnoException(Env(), EINVAL, "Envelope must not be empty")
+                .ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
     }
 
-    const auto str = convert_string_or_buffer(value);
+    /* Copies of the payload for one destination. Sent copies are left empty,
+       so closing all of them is always safe. */
+    std::vector<zmq_msg_t> copies(
+        static_cast<size_t>(std::distance(payload.begin(), payload.end())));
+    auto const close = [&copies]() {
+        for (auto& copy : copies) {
+            zmq_msg_close(&copy);
+        }
+    };
 
-    if (zmq_join(socket, str.c_str()) < 0) {
-        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
-        return;
+    uint32_t sent = 0;
+    for (auto& envelope : envelopes) {
+        /* The copies are made before the first part is sent, so that a failed
+           copy does not leave an incomplete message behind. */
+        auto copied = true;
+        auto source = payload.begin();
+        for (auto& copy : copies) {
+            zmq_msg_init(&copy);
+            copied = copied && zmq_msg_copy(&copy, source->get()) == 0;
+            source++;
+        }
+
+        if (!copied) {
+            auto const error = zmq_errno();
+            close();
+            ErrnoException(Env(), error).ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+
+        /* Destinations that cannot accept a message right away, or that are
+           unknown to a router in mandatory mode, are skipped. Once the first
+           part has been accepted, the remaining parts are queued as well, so
+           a later part only fails if the socket can no longer be used at all.
+           In that case the error is thrown, leaving an incomplete message on
+           the socket. */
+        auto first = true;
+        auto error = 0;
+        for (auto& part : envelope) {
+            error = send(part.get(), ZMQ_DONTWAIT | ZMQ_SNDMORE);
+            if (error != 0) {
+                break;
+            }
+
+            first = false;
+        }
+
+        for (size_t index = 0; error == 0 && index < copies.size(); index++) {
+            auto const flags = index + 1 < copies.size() ? ZMQ_DONTWAIT | ZMQ_SNDMORE
+                                                         : ZMQ_DONTWAIT;
+            error = send(&copies[index], flags);
+        }
+
+        close();
+
+        if (first && (error == EAGAIN || error == EHOSTUNREACH)) {
+            continue;
+        }
+
+        if (error != 0) {
+            ErrnoException(Env(), error).ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+
+        sent++;
     }
-#endif
+
+    /* This operation may have caused a state change, so we must also update
+       the poller state manually! */
+    poller.TriggerReadable();
+    return Napi::Number::New(Env(), sent);
 }
 
-void Socket::Leave([[maybe_unused]] const Napi::CallbackInfo& info) {
-#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
-    for (size_t i_value = 0; i_value < info.Length(); ++i_value) {
-        const auto& value = info[i_value];
-        this->LeaveElement(value);
+Napi::Value Socket::Receive(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
     }
-#endif
-}
 
-void Socket::LeaveElement([[maybe_unused]] const Napi::Value& value) {
-#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
     if (!ValidateOpen()) {
-        return;
+        return Env().Undefined();
     }
 
-    const auto str = convert_string_or_buffer(value);
+    return ScheduleReceive(Delivery::Buffers);
+}
+
+Napi::Value Socket::ReceiveInto(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::TypedArray>("Ring must be an Int32Array"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    auto const ring = info[0].As<Napi::TypedArray>();
+    if (ring.TypedArrayType() != napi_int32_array) {
+        Napi::TypeError::New(Env(), "Ring must be an Int32Array")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    if (conflate_topics) {
+        ErrnoException(Env(), EINVAL, "Rings cannot be used with topic conflation")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    if (ring.ByteLength() < RingWriter::header_size + min_ring_capacity) {
+        ErrnoException(Env(), EINVAL, "Ring must be at least 64 bytes")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    return ScheduleReceive(Delivery::Ring, ring);
+}
+
+Napi::Value Socket::ReceiveHandles(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    return ScheduleReceive(Delivery::Handles);
+}
+
+Napi::Value Socket::ScheduleReceive(Delivery delivery, const Napi::Object& ring) {
+    InvalidateEvents();
+
+    if (poller.Reading()) {
+        if (poller.ReadQueueSize() >= max_queued_receives) {
+            ErrnoException(Env(), EBUSY,
+                "Socket is busy reading; too many receive operations are in "
+                "progress")
+                .ThrowAsJavaScriptException();
+            return Env().Undefined();
+        }
+
+        /* Queue behind the pending receive operations; they will be resolved
+           in order when messages arrive. */
+        return poller.ReadPromise(delivery, ring);
+    }
+
+    if (receive_timeout == 0 || Readable() || BusyPoll(ZMQ_POLLIN)) {
+        /* We can read from the socket immediately. This is a fast path.
+           Also see the related comments in Send(). */
+#ifdef ZMQ_NO_SYNC_RESOLVE
+        Warn(Env(), "Promise resolution by receive() is delayed (ZMQ_NO_SYNC_RESOLVE).");
+#else
+        if (receive_timeout == 0 || sync_operations++ < max_sync_operations) {
+            auto res = Napi::Promise::Deferred::New(Env());
+            Receive(res, delivery, ring);
+
+            /* This operation may have caused a state change, so we must also
+               update the poller state manually! */
+            poller.TriggerWritable();
+            return res.Promise();
+        }
+#endif
+
+        /* We can read from the socket immediately, but we don't, in order to
+           avoid starving the event loop. Reads will be delayed. */
+        UvScheduleDelayed(Env(), [&]() {
+            poller.ReadableCallback();
+            if (socket == nullptr) {
+                return;
+            }
+            poller.TriggerWritable();
+        });
+    } else {
+        poller.PollReadable(receive_timeout);
+    }
+
+    return poller.ReadPromise(delivery, ring);
+}
+
+void Socket::Receive(
+    const Napi::Promise::Deferred& res, Delivery delivery, const Napi::Object& ring) {
+    /* Conflated messages that are left after conflation was disabled are
+       received first. Routes take messages from the conflated topics. */
+    if ((conflate_topics || HasConflated()) && delivery != Delivery::Routes) {
+        ReceiveConflated(res, delivery == Delivery::Handles);
+        return;
+    }
+
+    switch (delivery) {
+    case Delivery::Buffers:
+        Receive(res);
+        break;
+    case Delivery::Handles:
+        Receive(res, true);
+        break;
+    case Delivery::Ring:
+        ReceiveInto(res, ring);
+        break;
+    case Delivery::Routes:
+        Dispatch(res);
+        break;
+    }
+}
+
+void Socket::ReceiveInto(const Napi::Promise::Deferred& res, const Napi::Object& ring) {
+    auto const array = ring.As<Napi::Int32Array>();
+    RingWriter writer(array.Data(), array.ByteLength());
+
+    ConsumeEvents(ZMQ_POLLIN);
+
+    /* Receives all parts of the next message, or returns the error. */
+    auto const receive = [this]() -> int32_t {
+        while (true) {
+            auto& part = ring_pending.emplace_back(std::make_unique<IncomingMsg>());
+            while (zmq_msg_recv(part->get(), io_socket, ZMQ_DONTWAIT) < 0) {
+                if (zmq_errno() != EINTR) {
+                    ring_pending.clear();
+                    return zmq_errno();
+                }
+            }
+
+            if (track_subscriptions && ring_pending.size() == 1) {
+                TrackSubscription(part->get());
+            }
+
+            if (zmq_msg_more(part->get()) == 0) {
+                return 0;
+            }
+        }
+    };
+
+    /* Write as many messages as are available and fit into the ring, without
+       creating any JS values for them. Only the first message is required. */
+    uint32_t count = 0;
+    while (true) {
+        if (ring_pending.empty()) {
+            if (auto const error = receive(); error != 0) {
+                if (count == 0) {
+                    res.Reject(ErrnoException(Env(), error).Value());
+                    return;
+                }
+
+                /* No more messages are available. */
+                break;
+            }
+        }
+
+        std::vector<zmq_msg_t*> parts;
+        parts.reserve(ring_pending.size());
+
+        size_t size = 0;
+        for (auto& part : ring_pending) {
+            parts.push_back(part->get());
+            size += RingWriter::FrameSize(zmq_msg_size(part->get()));
+        }
+
+        if (!writer.Accepts(size)) {
+            /* The message can never be written to this ring, drop it. */
+            ring_pending.clear();
+            if (count == 0) {
+                res.Reject(ErrnoException(Env(), EMSGSIZE).Value());
+                return;
+            }
+            break;
+        }
+
+        if (!writer.Write(parts.begin(), parts.end())) {
+            /* The ring is full or its offsets were overwritten; keep the
+               message for the next call. */
+            if (writer.Corrupted() && count == 0) {
+                res.Reject(ErrnoException(Env(), EPROTO, "Ring is corrupted").Value());
+                return;
+            }
+
+            break;
+        }
+
+        ring_pending.clear();
+        count++;
+    }
+
+    if (count > 0) {
+        /* Wake up any readers that wait for the write offset to change. */
+        auto atomics = Env().Global().Get("Atomics").As<Napi::Object>();
+        atomics.Get("notify").As<Napi::Function>().Call(
+            atomics, {array, Napi::Number::New(Env(), 0)});
+    }
+
+    res.Resolve(Napi::Number::New(Env(), count));
+}
+
+void Socket::ReceiveConflated(const Napi::Promise::Deferred& res, bool detach) {
+    ConsumeEvents(ZMQ_POLLIN);
+
+    auto& conflater = EnsureFeatures().conflater;
+
+    /* Replace older messages of the same topics with whatever has arrived
+       since the last receive. */
+    if (conflate_topics) {
+        if (auto const error = conflater.Drain(io_socket, max_conflated_messages);
+            error != 0) {
+            res.Reject(ErrnoException(Env(), error).Value());
+            return;
+        }
+    }
+
+    if (conflater.Empty()) {
+        res.Reject(ErrnoException(Env(), EAGAIN).Value());
+        return;
+    }
+
+    auto parts = conflater.Pop();
+    auto list = Napi::Array::New(Env(), parts.size());
+    for (uint32_t index = 0; index < parts.size(); index++) {
+        list[index] = detach
+            ? parts[index]->IntoHandle(Env(), module.Global().DetachedMsgs)
+            : parts[index]->IntoBuffer(Env());
+    }
+
+    res.Resolve(list);
+}
+
+void Socket::Dispatch(const Napi::Promise::Deferred& res) {
+    ConsumeEvents(ZMQ_POLLIN);
+
+    /* Handlers may close the socket, which releases the features, so they are
+       looked up again for every message. */
+    auto const conflated = conflate_topics || HasConflated();
+    if (conflate_topics) {
+        if (auto const error
+            = EnsureFeatures().conflater.Drain(io_socket, max_conflated_messages);
+            error != 0) {
+            res.Reject(ErrnoException(Env(), error).Value());
+            return;
+        }
+    }
+
+    /* Receives all parts of the next message, or returns the error. */
+    auto const receive = [this](Conflater::Parts& parts) -> int32_t {
+        while (true) {
+            auto& part = parts.emplace_back(std::make_unique<IncomingMsg>());
+            while (zmq_msg_recv(part->get(), io_socket, ZMQ_DONTWAIT) < 0) {
+                if (zmq_errno() != EINTR) {
+                    return zmq_errno();
+                }
+            }
+
+            if (zmq_msg_more(part->get()) == 0) {
+                return 0;
+            }
+        }
+    };
+
+    uint32_t count = 0;
+    while (count < max_routed_messages && state != State::Closed && !poller.Closing()) {
+        Conflater::Parts parts;
+        if (conflated) {
+            if (!HasConflated()) {
+                break;
+            }
+
+            parts = features->conflater.Pop();
+        } else if (auto const error = receive(parts); error != 0) {
+            if (count == 0) {
+                res.Reject(ErrnoException(Env(), error).Value());
+                return;
+            }
+
+            /* No more messages are available. */
+            break;
+        }
+
+        count++;
+
+        Napi::HandleScope const scope(Env());
+
+        /* The topic is matched on the message data. Only messages that have a
+           handler are converted to buffers. */
+        auto* topic = parts.front()->get();
+        std::vector<Napi::Function> handlers;
+        EnsureFeatures().routes.Match(
+            {static_cast<char*>(zmq_msg_data(topic)), zmq_msg_size(topic)},
+            [&](const Napi::FunctionReference& handler) {
+                handlers.push_back(handler.Value());
+            });
+
+        if (handlers.empty()) {
+            continue;
+        }
+
+        auto list = Napi::Array::New(Env(), parts.size());
+        for (uint32_t index = 0; index < parts.size(); index++) {
+            list[index] = parts[index]->IntoBuffer(Env());
+        }
+
+        /* Handlers may add or remove routes or close the socket, so they are
+           only called once all matching handlers are known. */
+        for (auto const& handler : handlers) {
+            try {
+                handler.Call({list});
+            } catch (const Napi::Error& err) {
+                res.Reject(err.Value());
+                return;
+            }
+        }
+    }
+
+    if (count == 0) {
+        res.Reject(ErrnoException(Env(), EAGAIN).Value());
+        return;
+    }
+
+    res.Resolve(Napi::Number::New(Env(), count));
+}
+
+Napi::Value Socket::WritableReady(const Napi::CallbackInfo& info) {
+    InvalidateEvents();
+
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    /* Resolve after all pending send operations have completed. */
+    if (poller.Writing()) {
+        return poller.ReadyPromise();
+    }
+
+    if (HasEvents(ZMQ_POLLOUT)) {
+        auto res = Napi::Promise::Deferred::New(Env());
+        res.Resolve(Env().Undefined());
+        return res.Promise();
+    }
+
+    if (send_timeout == 0) {
+        auto res = Napi::Promise::Deferred::New(Env());
+        res.Reject(ErrnoException(Env(), EAGAIN).Value());
+        return res.Promise();
+    }
+
+    poller.PollWritable(send_timeout);
+    return poller.ReadyPromise();
+}
+
+void Socket::Route(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::String, Arg::Buffer>("Prefix must be a string or buffer"),
+        Arg::Required<Arg::Function>("Handler must be a function"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    if (!ValidateOpen()) {
+        return;
+    }
+
+    if (type != ZMQ_SUB && type != ZMQ_XSUB) {
+        ErrnoException(Env(), EINVAL, "Routes require a subscriber socket")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto const prefix = convert_string_or_buffer(info[0]);
+    EnsureFeatures().routes.Insert(
+        prefix, Napi::Persistent(info[1].As<Napi::Function>()));
+}
+
+Napi::Value Socket::Unroute(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::String, Arg::Buffer>("Prefix must be a string or buffer"),
+        Arg::Optional<Arg::Function>("Handler must be a function"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (features == nullptr) {
+        return Napi::Number::New(Env(), 0);
+    }
+
+    /* Without a handler, all handlers of the prefix are removed. */
+    auto const handler = info[1];
+    auto const removed = features->routes.Remove(convert_string_or_buffer(info[0]),
+        [&](const Napi::FunctionReference& route) {
+            return handler.IsUndefined() || route.Value().StrictEquals(handler);
+        });
+
+    return Napi::Number::New(Env(), static_cast<double>(removed));
+}
+
+Napi::Value Socket::Dispatch(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    return ScheduleReceive(Delivery::Routes);
+}
+
+/* Reads an array of prefixes into a set. Returns false and throws if any of
+   the prefixes is invalid. */
+static bool GetPrefixes(const Napi::Value& value, std::unordered_set<std::string>& set) {
+    if (value.IsUndefined()) {
+        return true;
+    }
+
+    if (!value.IsArray()) {
+        Napi::TypeError::New(value.Env(), "Prefixes must be an array")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    auto const array = value.As<Napi::Array>();
+    for (uint32_t index = 0; index < array.Length(); index++) {
+        auto const prefix = array.Get(index);
+        if (!prefix.IsString() && !prefix.IsBuffer()) {
+            Napi::TypeError::New(value.Env(), "Prefixes must be strings or buffers")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
 
+        set.insert(convert_string_or_buffer(prefix));
+    }
+
+    return true;
+}
+
+void Socket::UpdateSubscriptions(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::Object>("Prefixes must be an array"),
+        Arg::Optional<Arg::Object>("Prefixes must be an array"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    /* Duplicates within one call count once. */
+    std::unordered_set<std::string> added;
+    std::unordered_set<std::string> removed;
+    if (!GetPrefixes(info[0], added) || !GetPrefixes(info[1], removed)) {
+        return;
+    }
+
+    if (!ValidateOpen()) {
+        return;
+    }
+
+    if (type != ZMQ_SUB) {
+        ErrnoException(Env(), EINVAL, "Subscriptions require a subscriber socket")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    Offload::Pause const pause(offload);
+    auto& subscriptions = EnsureFeatures().subscriptions;
+
+    /* Changes the reference count of a prefix. Only counts that change from or
+       to zero are passed on to the socket, which sends them upstream. The
+       count is left as it is if the socket rejects the change. */
+    auto const change = [&](const std::string& prefix, bool subscribe) {
+        auto const iter = subscriptions.try_emplace(prefix, 0).first;
+        if (iter->second == (subscribe ? 0 : 1)) {
+            auto const option = subscribe ? ZMQ_SUBSCRIBE : ZMQ_UNSUBSCRIBE;
+            if (zmq_setsockopt(socket, option, prefix.data(), prefix.size()) < 0) {
+                if (iter->second == 0) {
+                    subscriptions.erase(iter);
+                }
+
+                return false;
+            }
+        }
+
+        iter->second = subscribe ? iter->second + 1 : iter->second - 1;
+        if (iter->second == 0) {
+            subscriptions.erase(iter);
+        }
+
+        return true;
+    };
+
+    /* The changes are applied all or nothing; if one fails, those applied
+       before it are reverted. */
+    std::vector<std::pair<const std::string*, bool>> applied;
+    auto const revert = [&]() {
+        auto const error = zmq_errno();
+        for (auto iter = applied.rbegin(); iter != applied.rend(); iter++) {
+            change(*iter->first, !iter->second);
+        }
+
+        ErrnoException(Env(), error).ThrowAsJavaScriptException();
+    };
+
+    for (auto const& prefix : added) {
+        if (removed.erase(prefix) > 0) {
+            continue;
+        }
+
+        if (!change(prefix, true)) {
+            revert();
+            return;
+        }
+
+        applied.emplace_back(&prefix, true);
+    }
+
+    for (auto const& prefix : removed) {
+        if (subscriptions.find(prefix) == subscriptions.end()) {
+            continue;
+        }
+
+        if (!change(prefix, false)) {
+            revert();
+            return;
+        }
+
+        applied.emplace_back(&prefix, false);
+    }
+}
+
+void Socket::TrackSubscription(zmq_msg_t* msg) {
+    /* Subscriptions consist of a single part that starts with 1 to subscribe
+       or 0 to unsubscribe, followed by the prefix. */
+    auto const* data = static_cast<const char*>(zmq_msg_data(msg));
+    auto const size = zmq_msg_size(msg);
+    if (size == 0 || zmq_msg_more(msg) != 0 || (data[0] != 0 && data[0] != 1)) {
+        return;
+    }
+
+    auto& counts = EnsureFeatures().subscriber_counts;
+    auto& prefixes = features->subscribed_prefixes;
+
+    auto prefix = std::string(data + 1, size - 1);
+    if (data[0] == 1) {
+        if (counts[prefix]++ == 0) {
+            prefixes.Insert(prefix, true);
+        }
+
+        return;
+    }
+
+    auto const iter = counts.find(prefix);
+    if (iter != counts.end() && --iter->second == 0) {
+        counts.erase(iter);
+        prefixes.Remove(prefix, [](bool /*value*/) { return true; });
+    }
+}
+
+Napi::Value Socket::HasSubscribers(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::String, Arg::Buffer>("Topic must be a string or buffer"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!ValidateOpen()) {
+        return Env().Undefined();
+    }
+
+    if (!track_subscriptions) {
+        ErrnoException(Env(), EINVAL, "Subscriptions are not tracked")
+            .ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    /* Only subscriptions that were received are counted; the socket itself
+       is left alone, so no message is taken from the application. */
+    auto const topic = convert_string_or_buffer(info[0]);
+
+    auto found = false;
+    if (features != nullptr) {
+        features->subscribed_prefixes.Match(
+            topic, [&](bool /*value*/) { found = true; });
+    }
+
+    return Napi::Boolean::New(Env(), found);
+}
+
+Napi::Value Socket::ForgetRoutingId(const Napi::CallbackInfo& info) {
+    Arg::Validator const args{
+        Arg::Required<Arg::String, Arg::Buffer>("Routing id must be a string or buffer"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    auto const id = convert_string_or_buffer(info[0]);
+    return Napi::Boolean::New(
+        Env(), features != nullptr && features->routing_ids.Forget(id));
+}
+
+void Socket::Join([[maybe_unused]] const Napi::CallbackInfo& info) {
+#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
+    for (size_t i_value = 0; i_value < info.Length(); ++i_value) {
+        const auto& value = info[i_value];
+        this->JoinElement(value);
+    }
+#endif
+}
+
+void Socket::JoinElement([[maybe_unused]] const Napi::Value& value) {
+#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
+    if (!ValidateOpen()) {
+        return;
+    }
+
+    const auto str = convert_string_or_buffer(value);
+
+    Offload::Pause const pause(offload);
+    if (zmq_join(socket, str.c_str()) < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return;
+    }
+#endif
+}
+
+void Socket::Leave([[maybe_unused]] const Napi::CallbackInfo& info) {
+#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
+    for (size_t i_value = 0; i_value < info.Length(); ++i_value) {
+        const auto& value = info[i_value];
+        this->LeaveElement(value);
+    }
+#endif
+}
+
+void Socket::LeaveElement([[maybe_unused]] const Napi::Value& value) {
+#ifdef ZMQ_HAS_POLLABLE_THREAD_SAFE
+    if (!ValidateOpen()) {
+        return;
+    }
+
+    const auto str = convert_string_or_buffer(value);
+
+    Offload::Pause const pause(offload);
     if (zmq_leave(socket, str.c_str()) < 0) {
         ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
         return;
@@ -815,6 +1884,8 @@ Napi::Value Socket::GetSockOpt<bool>(const Napi::CallbackInfo& info) {
 
     int32_t value = 0;
     size_t length = sizeof(value);
+
+    Offload::Pause const pause(offload);
     if (zmq_getsockopt(socket, option, &value, &length) < 0) {
         ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
         return Env().Undefined();
@@ -838,6 +1909,8 @@ void Socket::SetSockOpt<bool>(const Napi::CallbackInfo& info) {
     WarnUnlessImmediateOption(option);
 
     int32_t value = static_cast<int32_t>(info[1].As<Napi::Boolean>());
+
+    Offload::Pause const pause(offload);
     if (zmq_setsockopt(socket, option, &value, sizeof(value)) < 0) {
         ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
         return;
@@ -859,6 +1932,8 @@ Napi::Value Socket::GetSockOpt<char*>(const Napi::CallbackInfo& info) {
     static constexpr auto max_value_length = 1024;  //+
     auto value = std::array<char, max_value_length>();  //+
     size_t length = value.size();  //+
+
+    Offload::Pause const pause(offload);
     if (zmq_getsockopt(socket, option, value.data(), &length) < 0) {  //+
         ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
         return Env().Undefined();
@@ -887,6 +1962,8 @@ void Socket::SetSockOpt<char*>(const Napi::CallbackInfo& info) {
     int32_t const option = info[0].As<Napi::Number>();
     WarnUnlessImmediateOption(option);
 
+    Offload::Pause const pause(offload);
+
     int32_t err = 0;
     if (info[1].IsBuffer()) {
         auto const buf = info[1].As<Napi::Object>();
@@ -924,6 +2001,8 @@ Napi::Value Socket::GetSockOpt(const Napi::CallbackInfo& info) {
 
     T value = 0;
     size_t length = sizeof(value);
+
+    Offload::Pause const pause(offload);
     if (zmq_getsockopt(socket, option, &value, &length) < 0) {
         ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
         return Env().Undefined();
@@ -947,6 +2026,8 @@ void Socket::SetSockOpt(const Napi::CallbackInfo& info) {
     WarnUnlessImmediateOption(option);
 
     T value = NumberCast<T>(info[1].As<Napi::Number>());
+
+    Offload::Pause const pause(offload);
     if (zmq_setsockopt(socket, option, &value, sizeof(value)) < 0) {
         ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
         return;
@@ -983,13 +2064,161 @@ Napi::Value Socket::GetClosed(const Napi::CallbackInfo& /*info*/) {
 }
 
 Napi::Value Socket::GetReadable(const Napi::CallbackInfo& /*info*/) {
+    InvalidateEvents();
     return Napi::Boolean::New(Env(), HasEvents(ZMQ_POLLIN));
 }
 
 Napi::Value Socket::GetWritable(const Napi::CallbackInfo& /*info*/) {
+    InvalidateEvents();
     return Napi::Boolean::New(Env(), HasEvents(ZMQ_POLLOUT));
 }
 
+Napi::Value Socket::GetBusyPollMicros(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Number::New(Env(), static_cast<double>(busy_poll_micros));
+}
+
+void Socket::SetBusyPollMicros(
+    const Napi::CallbackInfo& /*info*/, const Napi::Value& value) {
+    auto const validate = Arg::Required<Arg::Number>("Option value must be a number");
+    if (auto err = validate(0, value)) {
+        err->ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto const micros = value.As<Napi::Number>().Int64Value();
+    if (micros < 0) {
+        ErrnoException(Env(), EINVAL).ThrowAsJavaScriptException();
+        return;
+    }
+
+    busy_poll_micros = micros;
+}
+
+Napi::Value Socket::GetSendQueueCapacity(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Number::New(Env(), static_cast<double>(send_queue_capacity));
+}
+
+void Socket::SetSendQueueCapacity(
+    const Napi::CallbackInfo& /*info*/, const Napi::Value& value) {
+    auto const validate = Arg::Required<Arg::Number>("Option value must be a number");
+    if (auto err = validate(0, value)) {
+        err->ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto const capacity = value.As<Napi::Number>().Int64Value();
+    if (capacity < 0) {
+        ErrnoException(Env(), EINVAL).ThrowAsJavaScriptException();
+        return;
+    }
+
+    send_queue_capacity = capacity;
+}
+
+Napi::Value Socket::GetSendQueueSize(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Number::New(Env(), static_cast<double>(poller.WriteQueueSize()));
+}
+
+Napi::Value Socket::GetConflateTopics(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Boolean::New(Env(), conflate_topics);
+}
+
+void Socket::SetConflateTopics(
+    const Napi::CallbackInfo& /*info*/, const Napi::Value& value) {
+    auto const validate = Arg::Required<Arg::Boolean>("Option value must be a boolean");
+    if (auto err = validate(0, value)) {
+        err->ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto const enable = value.As<Napi::Boolean>().Value();
+    if (enable && type != ZMQ_SUB && type != ZMQ_XSUB) {
+        ErrnoException(Env(), EINVAL, "Topic conflation requires a subscriber socket")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    conflate_topics = enable;
+}
+
+Napi::Value Socket::GetTrackSubscriptions(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Boolean::New(Env(), track_subscriptions);
+}
+
+void Socket::SetTrackSubscriptions(
+    const Napi::CallbackInfo& /*info*/, const Napi::Value& value) {
+    auto const validate = Arg::Required<Arg::Boolean>("Option value must be a boolean");
+    if (auto err = validate(0, value)) {
+        err->ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto const enable = value.As<Napi::Boolean>().Value();
+    if (enable && type != ZMQ_XPUB) {
+        ErrnoException(Env(), EINVAL, "Subscription tracking requires an XPublisher")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    /* Counts are only accurate if they were tracked from the start. */
+    if (!enable && features != nullptr) {
+        features->subscriber_counts.clear();
+        features->subscribed_prefixes.Clear();
+    }
+
+    track_subscriptions = enable;
+}
+
+Napi::Value Socket::GetInternRoutingIds(const Napi::CallbackInfo& /*info*/) {
+    if (features == nullptr) {
+        return Env().Null();
+    }
+
+    switch (features->routing_ids.GetMode()) {
+    case IdentityCache::Mode::Buffer:
+        return Napi::String::New(Env(), "buffer");
+    case IdentityCache::Mode::String:
+        return Napi::String::New(Env(), "string");
+    default:
+        return Env().Null();
+    }
+}
+
+void Socket::SetInternRoutingIds(
+    const Napi::CallbackInfo& /*info*/, const Napi::Value& value) {
+    auto const validate = Arg::Required<Arg::String, Arg::Null>(
+        "Option value must be \"buffer\", \"string\" or null");
+    if (auto err = validate(0, value)) {
+        err->ThrowAsJavaScriptException();
+        return;
+    }
+
+    auto mode = IdentityCache::Mode::Disabled;
+    if (value.IsString()) {
+        auto const str = value.As<Napi::String>().Utf8Value();
+        if (str == "buffer") {
+            mode = IdentityCache::Mode::Buffer;
+        } else if (str == "string") {
+            mode = IdentityCache::Mode::String;
+        } else {
+            Napi::TypeError::New(
+                Env(), "Option value must be \"buffer\", \"string\" or null")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    if (mode != IdentityCache::Mode::Disabled && type != ZMQ_ROUTER) {
+        ErrnoException(Env(), EINVAL, "Interning routing ids requires a router socket")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    if (mode != IdentityCache::Mode::Disabled || features != nullptr) {
+        EnsureFeatures().routing_ids.SetMode(mode);
+    }
+}
+
 void Socket::Initialize(Module& module, Napi::Object& exports) {
     auto proto = {
         InstanceMethod<&Socket::Bind>("bind"),
@@ -1006,9 +2235,25 @@ void Socket::Initialize(Module& module, Napi::Object& exports) {
            prototype and re-assigned to the sockets to which they apply. */
         InstanceMethod<&Socket::Send>("send", napi_configurable),
         InstanceMethod<&Socket::Receive>("receive", napi_configurable),
+        InstanceMethod<&Socket::ReceiveInto>("receiveInto", napi_configurable),
+        InstanceMethod<&Socket::ReceiveHandles>("receiveHandles", napi_configurable),
+        InstanceMethod<&Socket::Route>("route", napi_configurable),
+        InstanceMethod<&Socket::Unroute>("unroute", napi_configurable),
+        InstanceMethod<&Socket::Dispatch>("dispatch", napi_configurable),
+        InstanceMethod<&Socket::SendToMany>("sendToMany", napi_configurable),
+        InstanceMethod<&Socket::UpdateSubscriptions>(
+            "updateSubscriptions", napi_configurable),
+        InstanceMethod<&Socket::HasSubscribers>("hasSubscribers", napi_configurable),
+        InstanceMethod<&Socket::ForgetRoutingId>("forgetRoutingId", napi_configurable),
         InstanceMethod<&Socket::Join>("join", napi_configurable),
         InstanceMethod<&Socket::Leave>("leave", napi_configurable),
 
+        InstanceMethod<&Socket::WritableReady>("writableReady"),
+
+        InstanceMethod<&Socket::Detach>("detach"),
+        InstanceMethod<&Socket::Share>("share"),
+        StaticMethod<&Socket::Adopt>("adopt"),
+
         InstanceMethod<&Socket::GetSockOpt<bool>>("getBoolOption"),
         InstanceMethod<&Socket::SetSockOpt<bool>>("setBoolOption"),
         InstanceMethod<&Socket::GetSockOpt<int32_t>>("getInt32Option"),
@@ -1028,6 +2273,20 @@ void Socket::Initialize(Module& module, Napi::Object& exports) {
         InstanceAccessor<&Socket::GetClosed>("closed"),
         InstanceAccessor<&Socket::GetReadable>("readable"),
         InstanceAccessor<&Socket::GetWritable>("writable"),
+
+        InstanceAccessor<&Socket::GetBusyPollMicros, &Socket::SetBusyPollMicros>(
+            "busyPollMicros"),
+        InstanceAccessor<&Socket::GetSendQueueCapacity, &Socket::SetSendQueueCapacity>(
+            "sendQueueCapacity"),
+        InstanceAccessor<&Socket::GetSendQueueSize>("sendQueueSize"),
+        /* Configurable like the methods of these features, which apply only to
+           some sockets as well. */
+        InstanceAccessor<&Socket::GetConflateTopics, &Socket::SetConflateTopics>(
+            "conflateTopics", napi_configurable),
+        InstanceAccessor<&Socket::GetTrackSubscriptions, &Socket::SetTrackSubscriptions>(
+            "trackSubscriptions", napi_configurable),
+        InstanceAccessor<&Socket::GetInternRoutingIds, &Socket::SetInternRoutingIds>(
+            "internRoutingIds", napi_configurable),
     };
 
     auto constructor = DefineClass(exports.Env(), "Socket", proto, &module);
@@ -1036,34 +2295,129 @@ void Socket::Initialize(Module& module, Napi::Object& exports) {
 }
 
 void Socket::Poller::ReadableCallback() {
-    assert(read_deferred);
+    assert(!read_deferred.empty());
     socket.get().sync_operations = 0;
+    socket.get().InvalidateEvents();
 
     AsyncScope const scope(socket.get().Env(), socket.get().async_context);
-    socket.get().Receive(take(read_deferred));
+
+    /* Another handle of a shared socket may have received the message we were
+       woken up for. Without a timeout, simply wait for the next one. */
+    if (socket.get().shared != nullptr && socket.get().receive_timeout < 0 && !closing
+        && socket.get().state != State::Closed && !socket.get().Readable()) {
+        PollReadable(socket.get().receive_timeout);
+        return;
+    }
+
+    /* The first pending operation is resolved unconditionally; it either
+       receives a message or is rejected because it has timed out. */
+    auto read = std::move(read_deferred.front());
+    read_deferred.pop_front();
+    socket.get().Receive(read.deferred, read.delivery, read.ring.Value());
+
+    /* Resolve any queued operations for which a message is available. */
+    while (!read_deferred.empty()) {
+        if (!closing && socket.get().state != State::Closed
+            && !socket.get().Readable()) {
+            /* Wait for the next message, with a new timeout for the next
+               operation in line. */
+            PollReadable(socket.get().receive_timeout);
+            break;
+        }
+
+        read = std::move(read_deferred.front());
+        read_deferred.pop_front();
+        socket.get().Receive(read.deferred, read.delivery, read.ring.Value());
+    }
 }
 
 void Socket::Poller::WritableCallback() {
-    assert(write_deferred);
+    assert(!write_deferred.empty());
     socket.get().sync_operations = 0;
+    socket.get().InvalidateEvents();
 
     AsyncScope const scope(socket.get().Env(), socket.get().async_context);
-    socket.get().Send(take(write_deferred), write_value);
-    write_value.Clear();
+
+    /* Same as for reading, other handles of a shared socket may have used up
+       the capacity to send. */
+    if (socket.get().shared != nullptr && socket.get().send_timeout < 0 && !closing
+        && socket.get().state != State::Closed
+        && !socket.get().HasEvents(ZMQ_POLLOUT)) {
+        PollWritable(socket.get().send_timeout);
+        return;
+    }
+
+    /* The first pending operation is attempted unconditionally; it either
+       completes or is rejected because it has timed out. */
+    do {
+        auto write = std::move(write_deferred.front());
+        write_deferred.pop_front();
+        write_queue_size -= write.size;
+
+        if (!write.ready) {
+            socket.get().Send(write.deferred, write.parts);
+        } else if (socket.get().state != State::Closed
+                   && socket.get().HasEvents(ZMQ_POLLOUT)) {
+            write.deferred.Resolve(socket.get().Env().Undefined());
+        } else {
+            write.deferred.Reject(ErrnoException(socket.get().Env(), EAGAIN).Value());
+        }
+
+        /* Messages queued behind it are not sent once the socket is closing. */
+        if (closing) {
+            for (auto& queued : write_deferred) {
+                queued.deferred.Reject(
+                    ErrnoException(socket.get().Env(), EBADF).Value());
+            }
+
+            write_deferred.clear();
+            write_queue_size = 0;
+            break;
+        }
+
+        /* Send any queued messages for as long as the socket is writable. */
+        if (!write_deferred.empty() && socket.get().state != State::Closed
+            && !socket.get().HasEvents(ZMQ_POLLOUT)) {
+            /* Wait until writable again, with a new timeout for the next
+               operation in line. */
+            PollWritable(socket.get().send_timeout);
+            break;
+        }
+    } while (!write_deferred.empty());
 }
 
-Napi::Value Socket::Poller::ReadPromise() {
-    assert(!read_deferred);
+Napi::Value Socket::Poller::ReadPromise(Delivery delivery, const Napi::Object& ring) {
+    auto& read = read_deferred.emplace_back(PendingRead{
+        Napi::Promise::Deferred(socket.get().Env()),
+        delivery,
+        ring.IsEmpty() ? Napi::ObjectReference() : Napi::Persistent(ring),
+    });
 
-    read_deferred = Napi::Promise::Deferred(socket.get().Env());
-    return read_deferred->Promise();
+    return read.deferred.Promise();
 }
 
 Napi::Value Socket::Poller::WritePromise(OutgoingMsg::Parts&& parts) {
-    assert(!write_deferred);
+    auto const size = parts.Size();
+    write_queue_size += size;
+
+    auto& write = write_deferred.emplace_back(PendingWrite{
+        Napi::Promise::Deferred(socket.get().Env()),
+        std::move(parts),
+        size,
+        false,
+    });
+
+    return write.deferred.Promise();
+}
+
+Napi::Value Socket::Poller::ReadyPromise() {
+    auto& write = write_deferred.emplace_back(PendingWrite{
+        Napi::Promise::Deferred(socket.get().Env()),
+        OutgoingMsg::Parts(),
+        0,
+        true,
+    });
 
-    write_value = std::move(parts);
-    write_deferred = Napi::Promise::Deferred(socket.get().Env());
-    return write_deferred->Promise();
+    return write.deferred.Promise();
 }
 }  // namespace zmq
@@ -1,15 +1,26 @@
 #pragma once
 
+#include <deque>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "./closable.h"
+#include "./conflater.h"
+#include "./identity_cache.h"
+#include "./incoming_msg.h"
 #include "./inline.h"
+#include "./offload.h"
 #include "./outgoing_msg.h"
 #include "./poller.h"
+#include "util/trie.h"
 
 namespace zmq {
 class Module;
+struct DetachedSocket;
 
 class Socket : public Napi::ObjectWrap<Socket>, public Closable {
 public:
@@ -32,6 +43,14 @@ protected:
         Blocked, /* Async operation in progress that disallows socket access. */
     };
 
+    enum class Delivery : uint8_t {
+        Buffers, /* Resolve with message parts as buffers. */
+        Handles, /* Resolve with handles of detached message parts. */
+        Ring, /* Write messages to a ring; resolve with the number written. */
+        Routes, /* Call the handlers of matching routes; resolve with the number
+                   of messages received. */
+    };
+
     inline void Close(const Napi::CallbackInfo& info);
 
     inline Napi::Value Bind(const Napi::CallbackInfo& info);
@@ -44,7 +63,23 @@ protected:
     inline void Disconnect(const Napi::CallbackInfo& info);
 
     inline Napi::Value Send(const Napi::CallbackInfo& info);
+    inline Napi::Value SendToMany(const Napi::CallbackInfo& info);
     inline Napi::Value Receive(const Napi::CallbackInfo& info);
+    inline Napi::Value ReceiveInto(const Napi::CallbackInfo& info);
+    inline Napi::Value ReceiveHandles(const Napi::CallbackInfo& info);
+    inline Napi::Value WritableReady(const Napi::CallbackInfo& info);
+
+    inline Napi::Value Detach(const Napi::CallbackInfo& info);
+    inline Napi::Value Share(const Napi::CallbackInfo& info);
+    static inline Napi::Value Adopt(const Napi::CallbackInfo& info);
+
+    inline void Route(const Napi::CallbackInfo& info);
+    inline Napi::Value Unroute(const Napi::CallbackInfo& info);
+    inline Napi::Value Dispatch(const Napi::CallbackInfo& info);
+
+    inline void UpdateSubscriptions(const Napi::CallbackInfo& info);
+    inline Napi::Value HasSubscribers(const Napi::CallbackInfo& info);
+    inline Napi::Value ForgetRoutingId(const Napi::CallbackInfo& info);
 
     inline void Join(const Napi::CallbackInfo& info);
     inline void Leave(const Napi::CallbackInfo& info);
@@ -62,38 +97,121 @@ protected:
     inline Napi::Value GetReadable(const Napi::CallbackInfo& info);
     inline Napi::Value GetWritable(const Napi::CallbackInfo& info);
 
+    inline Napi::Value GetBusyPollMicros(const Napi::CallbackInfo& info);
+    inline void SetBusyPollMicros(
+        const Napi::CallbackInfo& info, const Napi::Value& value);
+
+    inline Napi::Value GetSendQueueCapacity(const Napi::CallbackInfo& info);
+    inline void SetSendQueueCapacity(
+        const Napi::CallbackInfo& info, const Napi::Value& value);
+    inline Napi::Value GetSendQueueSize(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetConflateTopics(const Napi::CallbackInfo& info);
+    inline void SetConflateTopics(
+        const Napi::CallbackInfo& info, const Napi::Value& value);
+
+    inline Napi::Value GetTrackSubscriptions(const Napi::CallbackInfo& info);
+    inline void SetTrackSubscriptions(
+        const Napi::CallbackInfo& info, const Napi::Value& value);
+
+    inline Napi::Value GetInternRoutingIds(const Napi::CallbackInfo& info);
+    inline void SetInternRoutingIds(
+        const Napi::CallbackInfo& info, const Napi::Value& value);
+
 private:
+    [[nodiscard]] void* Release();
+    [[nodiscard]] inline std::unique_ptr<DetachedSocket> CaptureState() const;
+
     inline void WarnUnlessImmediateOption(int32_t option) const;
     [[nodiscard]] inline bool ValidateOpen() const;
     [[nodiscard]] bool HasEvents(uint32_t requested_events) const;
+    [[nodiscard]] inline bool BusyPoll(uint32_t requested_events) const;
+    [[nodiscard]] inline bool Readable() const;
+    inline void InvalidateEvents() const {
+        cached_events = 0;
+    }
+    void ConsumeEvents(uint32_t used_events) const;
 
     /* Send/receive are usually in a hot path and will benefit slightly
        from being inlined. They are used in more than one location and are
        not necessarily automatically inlined by all compilers. */
     force_inline void Send(const Napi::Promise::Deferred& res, OutgoingMsg::Parts& parts);
-    force_inline void Receive(const Napi::Promise::Deferred& res);
+    force_inline void Receive(const Napi::Promise::Deferred& res, bool detach = false);
+
+    inline Napi::Value ScheduleReceive(
+        Delivery delivery, const Napi::Object& ring = Napi::Object());
+    inline void Receive(const Napi::Promise::Deferred& res, Delivery delivery,
+        const Napi::Object& ring);
+    inline void ReceiveInto(const Napi::Promise::Deferred& res, const Napi::Object& ring);
+    inline void ReceiveConflated(const Napi::Promise::Deferred& res, bool detach);
+    inline void Dispatch(const Napi::Promise::Deferred& res);
+
+    inline void TrackSubscription(zmq_msg_t* msg);
 
     inline void JoinElement(const Napi::Value& value);
     inline void LeaveElement(const Napi::Value& value);
 
     class Poller : public zmq::Poller<Poller> {
         std::reference_wrapper<Socket> socket;
-        std::optional<Napi::Promise::Deferred> read_deferred;
-        std::optional<Napi::Promise::Deferred> write_deferred;
-        OutgoingMsg::Parts write_value;
+        struct PendingWrite {
+            Napi::Promise::Deferred deferred;
+            OutgoingMsg::Parts parts;
+            size_t size;
+
+            /* Waits for the socket to become writable without sending. */
+            bool ready;
+        };
+
+        struct PendingRead {
+            Napi::Promise::Deferred deferred;
+            Delivery delivery;
+
+            /* Ring to write messages to; empty for regular receives. */
+            Napi::ObjectReference ring;
+        };
+
+        std::deque<PendingRead> read_deferred;
+        std::deque<PendingWrite> write_deferred;
+        size_t write_queue_size = 0;
+
+        /* Set while the socket is being closed; pending operations are then
+           settled instead of waiting for the socket again. */
+        bool closing = false;
 
     public:
         explicit Poller(std::reference_wrapper<Socket> socket) : socket(socket) {}
 
-        Napi::Value ReadPromise();
+        Napi::Value ReadPromise(Delivery delivery, const Napi::Object& ring);
         Napi::Value WritePromise(OutgoingMsg::Parts&& parts);
+        Napi::Value ReadyPromise();
+
+        [[nodiscard]] bool Closing() const {
+            return closing;
+        }
+
+        /* Settles all pending operations and stops polling. The first pending
+           send fails as usual; messages queued behind it are rejected with
+           EBADF instead of being sent. */
+        void Close() {
+            closing = true;
+            zmq::Poller<Poller>::Close();
+        }
 
         [[nodiscard]] bool Reading() const {
-            return read_deferred.has_value();
+            return !read_deferred.empty();
+        }
+
+        [[nodiscard]] size_t ReadQueueSize() const {
+            return read_deferred.size();
         }
 
         [[nodiscard]] bool Writing() const {
-            return write_deferred.has_value();
+            return !write_deferred.empty();
+        }
+
+        /* Number of bytes of all messages that are waiting to be sent. */
+        [[nodiscard]] size_t WriteQueueSize() const {
+            return write_queue_size;
         }
 
         [[nodiscard]] bool ValidateReadable() const {
@@ -106,6 +224,10 @@ private:
 
         void ReadableCallback();
         void WritableCallback();
+
+        void WakeupCallback() const {
+            socket.get().InvalidateEvents();
+        }
     };
 
     Napi::AsyncContext async_context;
@@ -116,18 +238,82 @@ private:
     Module& module;
     void* socket = nullptr;
 
+    /* Owns a thread safe socket that is used by multiple handles, possibly in
+       other agents/threads. The last handle to be closed closes the socket. */
+    std::shared_ptr<void> shared;
+
+    /* The socket on which messages are sent and received. This is the socket
+       itself, unless I/O is offloaded to a separate thread. */
+    void* io_socket = nullptr;
+    Offload offload;
+
     int64_t send_timeout = -1;
     int64_t receive_timeout = -1;
+    int64_t busy_poll_micros = 0;
+    int64_t send_queue_capacity = 0;
     uint32_t sync_operations = 0;
     uint32_t endpoints = 0;
 
+    /* Events reported by the last ZMQ_EVENTS query. Only set events are
+       reused, and only within a single synchronous turn: events can also be
+       cleared by peers that disconnect or by reconnects, without waking up a
+       poller that is stopped. The cache is therefore reset on every call from
+       JS and every poller wakeup or callback. Within a call, a send or
+       receive only drops the event it used up, so that a single query serves
+       both the operation and the trigger of the other direction that follows
+       it. Unset events are never reused, because sending or receiving may
+       process commands that set them without signalling the poller again. */
+    mutable uint32_t cached_events = 0;
+
+    /* Parts of a message that was received by ReceiveInto() but did not fit
+       into the ring. It is written first when the ring has room again. */
+    std::vector<std::unique_ptr<IncomingMsg>> ring_pending;
+
+    /* State of features that only some socket types use. It is allocated on
+       first use, so that other sockets do not carry it. */
+    struct Features {
+        explicit Features(size_t max_routing_ids) : routing_ids(max_routing_ids) {}
+
+        /* Latest messages per topic that were not received yet, if topic
+           conflation is enabled. */
+        Conflater conflater;
+
+        /* Message handlers by topic prefix. */
+        Trie<Napi::FunctionReference> routes;
+
+        /* Reference counts of the prefixes subscribed to in bulk. */
+        std::unordered_map<std::string, uint32_t> subscriptions;
+
+        /* Number of subscribers of every prefix, as seen by a publisher that
+           tracks subscriptions. Prefixes with subscribers are also kept in the
+           tree, to find those that match a topic. */
+        std::unordered_map<std::string, uint32_t> subscriber_counts;
+        Trie<bool> subscribed_prefixes;
+
+        /* Interned routing ids of the peers of a router, if enabled. */
+        IdentityCache routing_ids;
+    };
+
+    [[nodiscard]] Features& EnsureFeatures();
+    [[nodiscard]] bool HasConflated() const {
+        return features != nullptr && !features->conflater.Empty();
+    }
+
+    std::unique_ptr<Features> features;
+
     State state = State::Open;
     bool request_close = false;
     bool thread_safe = false;
+    bool conflate_topics = false;
+    bool track_subscriptions = false;
     int type = 0;
 
+    friend class Broker;
+    friend class LastValueCache;
     friend class Observer;
     friend class Proxy;
+    friend class ProxyGroup;
+    friend class ShardProxy;
 };
 }  // namespace zmq
 
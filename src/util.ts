@@ -17,3 +17,32 @@ export function allowMethods(socketPrototype: any, methods: SocketMethods[]) {
     }
   }
 }
+
+/**
+ * This function moves the given methods and accessors from the native
+ * Socket.prototype to the prototypes of the socket types that support them, so
+ * that other sockets do not have them at all.
+ * @param socketPrototype
+ * @param targets
+ * @param members
+ *
+ * @internal
+ */
+export function moveMembers(
+  socketPrototype: any,
+  targets: Array<{prototype: any}>,
+  members: string[],
+) {
+  for (const member of members) {
+    const desc = Object.getOwnPropertyDescriptor(socketPrototype, member)
+    if (desc === undefined) {
+      continue
+    }
+
+    for (const target of targets) {
+      Object.defineProperty(target.prototype, member, desc)
+    }
+
+    delete socketPrototype[member]
+  }
+}
@@ -50,6 +50,8 @@ using Number = VerifyWithMethod<&Napi::Value::IsNumber>;
 using Boolean = VerifyWithMethod<&Napi::Value::IsBoolean>;
 using String = VerifyWithMethod<&Napi::Value::IsString>;
 using Buffer = VerifyWithMethod<&Napi::Value::IsBuffer>;
+using TypedArray = VerifyWithMethod<&Napi::Value::IsTypedArray>;
+using Function = VerifyWithMethod<&Napi::Value::IsFunction>;
 
 using NotUndefined = Not<Undefined>;
 
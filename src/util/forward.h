@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+
+#include "../zmq_inc.h"
+
+namespace zmq {
+/* Helpers for native threads that pass messages between sockets. */
+enum class Flow : uint8_t {
+    Drained, /* Source has no more messages. */
+    Blocked, /* Destination cannot accept more messages. */
+    Limited, /* Limit was reached; source may have more messages. */
+    Terminated, /* Context was terminated. */
+};
+
+/* Returns the ZMQ_EVENTS state of a socket, or -1 if the context was
+   terminated. */
+inline int32_t Events(void* socket) {
+    int32_t events = 0;
+    size_t events_size = sizeof(events);
+
+    while (zmq_getsockopt(socket, ZMQ_EVENTS, &events, &events_size) < 0) {
+        if (zmq_errno() != EINTR) {
+            return zmq_errno() == ETERM ? -1 : 0;
+        }
+    }
+
+    return events;
+}
+
+inline void CloseSocket(void*& socket) {
+    if (socket != nullptr) {
+        int32_t linger = 0;
+        zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+
+        [[maybe_unused]] auto err = zmq_close(socket);
+        assert(err == 0);
+
+        socket = nullptr;
+    }
+}
+
+/* Sends or receives a fixed size value over a control socket. */
+template <typename T>
+inline bool SendValue(void* socket, const T& value) {
+    while (zmq_send(socket, &value, sizeof(value), 0) < 0) {
+        if (zmq_errno() != EINTR) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+inline bool ReceiveValue(void* socket, T& value) {
+    while (true) {
+        auto const size = zmq_recv(socket, &value, sizeof(value), 0);
+        if (size >= 0) {
+            return static_cast<size_t>(size) == sizeof(value);
+        }
+
+        if (zmq_errno() != EINTR) {
+            return false;
+        }
+    }
+}
+
+/* Number of messages that threads which also serve commands move at once, so
+   that a busy source cannot delay the commands indefinitely. */
+auto constexpr forward_batch_size = uint32_t{1} << 10U;
+
+/* Moves complete messages from one socket to another, until the source has
+   no more messages, the destination does not accept any more messages, or
+   the given number of messages was moved. */
+inline Flow Forward(
+    void* from, void* to, uint32_t limit = std::numeric_limits<uint32_t>::max()) {
+    for (uint32_t count = 0;; count++) {
+        if (count == limit) {
+            return Flow::Limited;
+        }
+
+        auto const events = Events(to);
+        if (events < 0) {
+            return Flow::Terminated;
+        }
+
+        if ((events & ZMQ_POLLOUT) == 0) {
+            return Flow::Blocked;
+        }
+
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+
+        bool discard = false;
+        while (true) {
+            while (zmq_msg_recv(&msg, from, ZMQ_DONTWAIT) < 0) {
+                if (zmq_errno() != EINTR) {
+                    auto const error = zmq_errno();
+                    zmq_msg_close(&msg);
+
+                    /* Sockets that cannot receive fail with ENOTSUP; treat
+                       them as having no messages. */
+                    return error == ETERM ? Flow::Terminated : Flow::Drained;
+                }
+            }
+
+            auto const more = zmq_msg_more(&msg) != 0;
+
+            /* Messages that cannot be sent in the current state of the socket
+               (for example EFSM or EHOSTUNREACH) are discarded, because there
+               is no way to report the failure to the original caller. */
+            if (!discard) {
+                auto const flags = more ? ZMQ_DONTWAIT | ZMQ_SNDMORE : ZMQ_DONTWAIT;
+                while (zmq_msg_send(&msg, to, flags) < 0) {
+                    if (zmq_errno() == EINTR) {
+                        continue;
+                    }
+
+                    if (zmq_errno() == ETERM) {
+                        zmq_msg_close(&msg);
+                        return Flow::Terminated;
+                    }
+
+                    discard = true;
+                    break;
+                }
+            }
+
+            /* Parts of a multipart message are delivered atomically, so the
+               next part is always available. */
+            if (!more) {
+                break;
+            }
+        }
+
+        zmq_msg_close(&msg);
+    }
+}
+}  // namespace zmq
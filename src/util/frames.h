@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../zmq_inc.h"
+
+namespace zmq {
+/* All parts of a message that is held by a native thread. */
+class Frames {
+    std::vector<zmq_msg_t> parts;
+
+public:
+    Frames() = default;
+    Frames(const Frames&) = delete;
+    Frames(Frames&&) = default;
+    Frames& operator=(const Frames&) = delete;
+
+    Frames& operator=(Frames&& other) noexcept {
+        Close();
+        parts = std::move(other.parts);
+        other.parts.clear();
+        return *this;
+    }
+
+    ~Frames() {
+        Close();
+    }
+
+    /* Returns a copy of all parts. Large parts share their data with the
+       original instead of being copied. */
+    [[nodiscard]] Frames Share() {
+        Frames copy;
+        copy.parts.resize(parts.size());
+        for (size_t index = 0; index < parts.size(); index++) {
+            zmq_msg_init(&copy.parts[index]);
+            zmq_msg_copy(&copy.parts[index], &parts[index]);
+        }
+
+        return copy;
+    }
+
+    /* Receives all parts of a message. Returns 1 if a message was received, 0
+       if there are no messages and -1 if the context was terminated. */
+    int32_t Receive(void* socket) {
+        do {
+            auto& part = parts.emplace_back();
+            zmq_msg_init(&part);
+
+            while (zmq_msg_recv(&part, socket, ZMQ_DONTWAIT) < 0) {
+                if (zmq_errno() != EINTR) {
+                    auto const error = zmq_errno();
+                    zmq_msg_close(&part);
+                    parts.pop_back();
+                    return error == ETERM ? -1 : 0;
+                }
+            }
+        } while (zmq_msg_more(&parts.back()) != 0);
+
+        return 1;
+    }
+
+    /* Sends the given leading parts, followed by all parts from the given
+       index on. The first leading part is typically the routing id of a
+       ROUTER peer. Returns false, leaving the message untouched, if the first
+       part cannot be sent, for example because the peer is unknown or cannot
+       accept the message. */
+    bool Send(void* socket, std::initializer_list<std::string_view> prefix,
+        size_t first = 0) {
+        auto remaining =
+            prefix.size() + (parts.size() > first ? parts.size() - first : 0);
+
+        for (auto const& data : prefix) {
+            auto const flags =
+                --remaining > 0 ? ZMQ_DONTWAIT | ZMQ_SNDMORE : ZMQ_DONTWAIT;
+            while (zmq_send(socket, data.data(), data.size(), flags) < 0) {
+                if (zmq_errno() != EINTR) {
+                    if (&data == prefix.begin()) {
+                        return false;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        /* Once the first part has been accepted, the remaining parts will be
+           queued. */
+        for (auto index = first; index < parts.size(); index++) {
+            auto const flags =
+                --remaining > 0 ? ZMQ_DONTWAIT | ZMQ_SNDMORE : ZMQ_DONTWAIT;
+            while (zmq_msg_send(&parts[index], socket, flags) < 0) {
+                if (zmq_errno() != EINTR) {
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /* Sends all parts. Returns false, leaving the message untouched, if the
+       first part cannot be sent. */
+    bool Send(void* socket) {
+        for (size_t index = 0; index < parts.size(); index++) {
+            auto const flags = index + 1 < parts.size() ? ZMQ_DONTWAIT | ZMQ_SNDMORE
+                                                        : ZMQ_DONTWAIT;
+            while (zmq_msg_send(&parts[index], socket, flags) < 0) {
+                if (zmq_errno() != EINTR) {
+                    if (index == 0) {
+                        return false;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /* Sends a copy of all parts, each truncated to the given length, without
+       waiting. Parts that are not truncated share their data with the
+       original. Returns false if the first part cannot be sent. */
+    bool Copy(void* socket, size_t limit) {
+        for (size_t index = 0; index < parts.size(); index++) {
+            auto const flags = index + 1 < parts.size() ? ZMQ_DONTWAIT | ZMQ_SNDMORE
+                                                        : ZMQ_DONTWAIT;
+
+            zmq_msg_t copy;
+            auto const size = zmq_msg_size(&parts[index]);
+            if (size <= limit) {
+                zmq_msg_init(&copy);
+                zmq_msg_copy(&copy, &parts[index]);
+            } else {
+                zmq_msg_init_size(&copy, limit);
+                std::memcpy(zmq_msg_data(&copy), zmq_msg_data(&parts[index]), limit);
+            }
+
+            while (zmq_msg_send(&copy, socket, flags) < 0) {
+                if (zmq_errno() != EINTR) {
+                    zmq_msg_close(&copy);
+                    return index > 0;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /* Sends all parts to the given ROUTER peer. */
+    bool Send(void* socket, std::string_view peer) {
+        return Send(socket, {peer});
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return parts.size();
+    }
+
+    std::string_view Part(size_t index) {
+        return {static_cast<char*>(zmq_msg_data(&parts[index])),
+            zmq_msg_size(&parts[index])};
+    }
+
+private:
+    void Close() {
+        for (auto& part : parts) {
+            zmq_msg_close(&part);
+        }
+    }
+};
+}  // namespace zmq
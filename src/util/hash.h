@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace zmq {
+/* FNV-1a, which distributes short keys well enough and is cheap to compute. */
+inline uint64_t Hash(std::string_view key) {
+    auto hash = uint64_t{14695981039346656037U};
+    for (auto const chr : key) {
+        hash ^= static_cast<uint8_t>(chr);
+        hash *= uint64_t{1099511628211U};
+    }
+
+    return hash;
+}
+
+/* Finalizer of SplitMix64. Spreads the bits of a hash over the full range,
+   which FNV-1a does not do for very short keys. */
+inline uint64_t Mix(uint64_t hash) {
+    hash = (hash ^ (hash >> 30U)) * uint64_t{0xbf58476d1ce4e5b9U};
+    hash = (hash ^ (hash >> 27U)) * uint64_t{0x94d049bb133111ebU};
+    return hash ^ (hash >> 31U);
+}
+}  // namespace zmq
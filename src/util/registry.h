@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace zmq {
+/* Thread safe store of objects that are identified by a numeric handle. An
+   object is owned by the registry until it is taken out again, possibly by
+   another thread. Objects that are never taken are deleted together with the
+   registry. */
+template <typename T>
+class Registry {
+    std::unordered_map<uint64_t, std::unique_ptr<T>> objects;
+    std::mutex lock;
+    uint64_t next = 1;
+
+public:
+    Registry() = default;
+    Registry(const Registry&) = delete;
+    Registry(Registry&&) = delete;
+    Registry& operator=(const Registry&) = delete;
+    Registry& operator=(Registry&&) = delete;
+    ~Registry() = default;
+
+    /* Handles are never reused and never 0. They are represented as JS numbers
+       and remain exact for 2^53 additions. */
+    uint64_t Add(std::unique_ptr<T> ptr) {
+        std::lock_guard<std::mutex> const guard(lock);
+        auto const handle = next++;
+        objects.emplace(handle, std::move(ptr));
+        return handle;
+    }
+
+    /* Returns the object with the given handle, or nullptr if the handle is
+       unknown or has already been taken. */
+    std::unique_ptr<T> Take(uint64_t handle) {
+        return TakeIf(handle, [](const T& /*unused*/) { return true; });
+    }
+
+    /* Same as Take(), but leaves the object in the registry and returns
+       nullptr unless it satisfies the given predicate. */
+    template <typename F>
+    std::unique_ptr<T> TakeIf(uint64_t handle, F&& predicate) {
+        std::lock_guard<std::mutex> const guard(lock);
+        auto const iter = objects.find(handle);
+        if (iter == objects.end() || !predicate(*iter->second)) {
+            return nullptr;
+        }
+
+        auto ptr = std::move(iter->second);
+        objects.erase(iter);
+        return ptr;
+    }
+};
+}  // namespace zmq
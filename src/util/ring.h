@@ -0,0 +1,298 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "../zmq_inc.h"
+
+namespace zmq {
+/* Single producer/single consumer ring of message frames in (shared) memory.
+   The memory is interpreted as 32 bit integers:
+
+     [0]  write offset
+     [1]  read offset
+     [2]  set while the reader waits for messages
+     [3]  set while the writer waits for room
+     [4.. frame area: [length][flags][data, padded to a multiple of 4 bytes]
+
+   Offsets are relative to the start of the frame area. The writer only ever
+   updates the write offset and the reader only ever updates the read offset.
+   A frame length of -1, or fewer than 8 bytes before the end of the frame
+   area, means that the next frame starts at offset 0. Bit 0 of the flags is
+   set if more parts of the same message follow. The write offset is published
+   with release semantics after all parts of a message have been written.
+
+   The wait flags are only used by readers and writers that need to be woken
+   up by the other side, for example with an eventfd. A side that is about to
+   wait sets its flag and checks the ring once more; the other side checks the
+   flag after updating its offset. Both use sequentially consistent fences, so
+   that at least one of them notices the other.
+
+   The offsets and frame headers may be written by another process, so they
+   are checked before they are used. A ring with invalid values is corrupted;
+   nothing is read from or written to it anymore. */
+class Ring {
+public:
+    static constexpr size_t header_size = 4 * sizeof(int32_t);
+    static constexpr size_t frame_header_size = 2 * sizeof(int32_t);
+    static constexpr int32_t wrap_length = -1;
+    static constexpr int32_t more_flag = 1;
+
+    Ring(int32_t* data, size_t length)
+        : write_offset(Index(data, 0)), read_offset(Index(data, 1)),
+          reader_waiting(Index(data, 2)), writer_waiting(Index(data, 3)),
+          frames(reinterpret_cast<uint8_t*>(data) + header_size),
+          capacity(length > header_size ? length - header_size : 0) {}
+
+    [[nodiscard]] size_t Capacity() const {
+        return capacity;
+    }
+
+    /* Returns the number of bytes a part of the given size occupies. */
+    static size_t FrameSize(size_t length) {
+        return frame_header_size + ((length + 3) & ~size_t{3});
+    }
+
+    /* Messages up to half the capacity can always be written to an empty
+       ring, regardless of the position of the offsets. */
+    [[nodiscard]] bool Accepts(size_t message_size) const {
+        return message_size * 2 < capacity;
+    }
+
+    /* Returns whether an offset or a frame of the ring was found invalid. */
+    [[nodiscard]] bool Corrupted() const {
+        return corrupted || !Valid(write_offset.load(std::memory_order_relaxed))
+            || !Valid(read_offset.load(std::memory_order_relaxed));
+    }
+
+protected:
+    static std::atomic<int32_t>& Index(int32_t* data, size_t index) {
+        static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t));
+
+        /* NOLINTNEXTLINE(*-pointer-arithmetic, *-reinterpret-cast) */
+        return *reinterpret_cast<std::atomic<int32_t>*>(data + index);
+    }
+
+    /* Offsets point to a frame header inside the frame area. */
+    [[nodiscard]] bool Valid(int32_t offset) const {
+        return offset >= 0 && static_cast<size_t>(offset) < capacity
+            && (offset & 3) == 0;
+    }
+
+    [[nodiscard]] size_t Advance(size_t start, size_t size) const {
+        return start + size == capacity ? 0 : start + size;
+    }
+
+    /* Sets a wait flag before the final check of the ring. */
+    static void Announce(std::atomic<int32_t>& flag) {
+        flag.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /* Clears a wait flag after an offset was updated. Returns true if the
+       other side was waiting and should be woken up. */
+    static bool Claim(std::atomic<int32_t>& flag) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return flag.load(std::memory_order_relaxed) != 0
+            && flag.exchange(0, std::memory_order_relaxed) != 0;
+    }
+
+    std::atomic<int32_t>& write_offset;
+    std::atomic<int32_t>& read_offset;
+    std::atomic<int32_t>& reader_waiting;
+    std::atomic<int32_t>& writer_waiting;
+    uint8_t* frames;
+    size_t capacity;
+    bool corrupted = false;
+};
+
+/* Producer side of a ring. */
+class RingWriter : public Ring {
+public:
+    RingWriter(int32_t* data, size_t length) : Ring(data, length) {}
+
+    /* Writes all parts of a message, or nothing if there is not enough room.
+       Parts are given as a sequence of zmq_msg_t pointers. */
+    template <typename It>
+    bool Write(It begin, It end) {
+        auto const offset = write_offset.load(std::memory_order_relaxed);
+        auto const read = read_offset.load(std::memory_order_acquire);
+        if (!Valid(offset) || !Valid(read)) {
+            corrupted = true;
+            return false;
+        }
+
+        /* Check that all frames fit before writing anything. */
+        if (!Fits(begin, end, static_cast<size_t>(offset), static_cast<size_t>(read))) {
+            return false;
+        }
+
+        auto next = static_cast<size_t>(offset);
+        for (auto iter = begin; iter != end;) {
+            auto* msg = *iter;
+            auto const length = zmq_msg_size(msg);
+            auto const flags = ++iter != end ? more_flag : 0;
+
+            size_t start = 0;
+            [[maybe_unused]] auto const fits =
+                Reserve(next, static_cast<size_t>(read), FrameSize(length), start);
+            if (start != next && capacity - next >= frame_header_size) {
+                Store(next, wrap_length);
+            }
+
+            Store(start, static_cast<int32_t>(length));
+            Store(start + sizeof(int32_t), flags);
+            std::memcpy(frames + start + frame_header_size, zmq_msg_data(msg), length);
+            next = Advance(start, FrameSize(length));
+        }
+
+        write_offset.store(static_cast<int32_t>(next), std::memory_order_release);
+        return true;
+    }
+
+    /* Returns true if all parts of a message can be written now. Returns
+       false if the ring is corrupted. */
+    template <typename It>
+    [[nodiscard]] bool Fits(It begin, It end) const {
+        auto const offset = write_offset.load(std::memory_order_relaxed);
+        auto const read = read_offset.load(std::memory_order_acquire);
+        return Valid(offset) && Valid(read)
+            && Fits(begin, end, static_cast<size_t>(offset), static_cast<size_t>(read));
+    }
+
+    /* Announces that the writer will wait for room. Writing must be attempted
+       once more before actually waiting. */
+    void AwaitRoom() {
+        Announce(writer_waiting);
+    }
+
+    /* Returns true if the reader waits for messages and should be woken up
+       after a message was written. */
+    bool ShouldWakeReader() {
+        return Claim(reader_waiting);
+    }
+
+private:
+    template <typename It>
+    [[nodiscard]] bool Fits(It begin, It end, size_t offset, size_t read) const {
+        auto next = offset;
+        for (auto iter = begin; iter != end; iter++) {
+            size_t start = 0;
+            if (!Reserve(next, read, FrameSize(zmq_msg_size(*iter)), start)) {
+                return false;
+            }
+            next = Advance(start, FrameSize(zmq_msg_size(*iter)));
+        }
+
+        return true;
+    }
+
+    /* Finds the start of a frame of the given size that is written at offset.
+       Returns false if the frame does not fit. The write offset may never
+       catch up with the read offset, because that would make a full ring
+       appear to be empty. */
+    [[nodiscard]] bool Reserve(
+        size_t offset, size_t read, size_t size, size_t& start) const {
+        if (offset >= read) {
+            auto const remaining = capacity - offset;
+            if (remaining > size || (remaining == size && read != 0)) {
+                start = offset;
+                return true;
+            }
+
+            /* Continue at the start of the frame area. */
+            start = 0;
+            return size < read;
+        }
+
+        start = offset;
+        return offset + size < read;
+    }
+
+    void Store(size_t offset, int32_t value) {
+        std::memcpy(frames + offset, &value, sizeof(value));
+    }
+};
+
+/* Consumer side of a ring. */
+class RingReader : public Ring {
+public:
+    RingReader(int32_t* data, size_t length) : Ring(data, length) {}
+
+    [[nodiscard]] bool Empty() const {
+        return read_offset.load(std::memory_order_relaxed)
+            == write_offset.load(std::memory_order_acquire);
+    }
+
+    /* Reads all parts of the next message, if any. The given function is
+       called with the data and size of every part, which are only valid until
+       the function returns. Returns false if the ring is empty or corrupted;
+       parts that were passed on before the corruption was found are not
+       consumed. */
+    template <typename F>
+    bool Read(F&& part) {
+        if (Empty()) {
+            return false;
+        }
+
+        auto const start = read_offset.load(std::memory_order_relaxed);
+        if (!Valid(start) || !Valid(write_offset.load(std::memory_order_relaxed))) {
+            corrupted = true;
+            return false;
+        }
+
+        auto offset = static_cast<size_t>(start);
+        while (true) {
+            if (capacity - offset < frame_header_size) {
+                offset = 0;
+            }
+
+            /* A frame never starts with a wrap marker at the start of the frame
+               area, which would otherwise be followed forever. */
+            auto const length = Load(offset);
+            if (length == wrap_length && offset != 0) {
+                offset = 0;
+                continue;
+            }
+
+            /* Never read outside of the ring. */
+            auto const size = FrameSize(static_cast<size_t>(length));
+            if (length < 0 || size > capacity - offset) {
+                corrupted = true;
+                return false;
+            }
+
+            auto const flags = Load(offset + sizeof(int32_t));
+            part(frames + offset + frame_header_size, static_cast<size_t>(length));
+            offset = Advance(offset, size);
+
+            if ((flags & more_flag) == 0) {
+                break;
+            }
+        }
+
+        read_offset.store(static_cast<int32_t>(offset), std::memory_order_release);
+        return true;
+    }
+
+    /* Announces that the reader will wait for messages. The ring must be
+       checked once more before actually waiting. */
+    void AwaitMessages() {
+        Announce(reader_waiting);
+    }
+
+    /* Returns true if the writer waits for room and should be woken up after
+       a message was read. */
+    bool ShouldWakeWriter() {
+        return Claim(writer_waiting);
+    }
+
+private:
+    [[nodiscard]] int32_t Load(size_t offset) const {
+        int32_t value = 0;
+        std::memcpy(&value, frames + offset, sizeof(value));
+        return value;
+    }
+};
+}  // namespace zmq
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <napi.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace zmq {
+/* Placement and priority of a native thread that is started by the addon. */
+struct ThreadOptions {
+    /* The CPUs on which the thread may run; any CPU if empty. */
+    std::vector<uint32_t> affinity;
+
+    /* The nice value of the thread; unchanged if absent. */
+    std::optional<int32_t> priority;
+
+    /* Reads the `threadAffinity` and `threadPriority` options. Returns false
+       and throws if an option is invalid. */
+    [[nodiscard]] bool Read(const Napi::Object& options) {
+        if (options.Has("threadAffinity")) {
+            auto const value = options.Get("threadAffinity");
+            if (!value.IsUndefined()) {
+                if (!value.IsArray()) {
+                    return Throw(options.Env(),
+                        "Thread affinity must be an array of CPU numbers");
+                }
+
+                auto const cpus = value.As<Napi::Array>();
+                for (uint32_t index = 0; index < cpus.Length(); index++) {
+                    auto const cpu = cpus.Get(index);
+                    if (!IsInteger(cpu, 0, UINT16_MAX)) {
+                        return Throw(options.Env(),
+                            "Thread affinity must be an array of CPU numbers");
+                    }
+
+                    affinity.push_back(cpu.As<Napi::Number>().Uint32Value());
+                }
+            }
+        }
+
+        if (options.Has("threadPriority")) {
+            auto const value = options.Get("threadPriority");
+            if (!value.IsUndefined()) {
+                if (!IsInteger(value, -20, 19)) {
+                    return Throw(options.Env(),
+                        "Thread priority must be an integer between -20 and 19");
+                }
+
+                priority = value.As<Napi::Number>().Int32Value();
+            }
+        }
+
+        return true;
+    }
+
+    /* Applies the options to the calling thread. Returns 0 on success, or an
+       errno value. Only supported on Linux; elsewhere setting any option
+       fails with ENOTSUP. */
+    [[nodiscard]] int32_t Apply() const {
+#ifdef __linux__
+        if (!affinity.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (auto const cpu : affinity) {
+                if (cpu >= CPU_SETSIZE) {
+                    return EINVAL;
+                }
+
+                CPU_SET(cpu, &set);
+            }
+
+            if (auto const err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                err != 0) {
+                return err;
+            }
+        }
+
+        /* On Linux the nice value applies to individual threads. */
+        if (priority.has_value()) {
+            auto const tid = static_cast<id_t>(syscall(SYS_gettid));
+            if (setpriority(PRIO_PROCESS, tid, *priority) < 0) {
+                return errno;
+            }
+        }
+
+        return 0;
+#else
+        return affinity.empty() && !priority.has_value() ? 0 : ENOTSUP;
+#endif
+    }
+
+private:
+    static bool IsInteger(const Napi::Value& value, double min, double max) {
+        if (!value.IsNumber()) {
+            return false;
+        }
+
+        auto const number = value.As<Napi::Number>().DoubleValue();
+        return number >= min && number <= max && number == std::floor(number);
+    }
+
+    static bool Throw(const Napi::Env& env, const char* msg) {
+        Napi::TypeError::New(env, msg).ThrowAsJavaScriptException();
+        return false;
+    }
+};
+}  // namespace zmq
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zmq {
+/* Radix tree that maps prefixes to values. Every node holds the values of the
+   prefix that ends at the node, and the children hold the keys that continue
+   it. Matching a key visits every node on its path once, so the cost depends
+   on the length of the key rather than on the number of prefixes. */
+template <typename T>
+class Trie {
+    struct Node {
+        std::string label;
+        std::vector<T> values;
+
+        /* Ordered by the first byte of their label, which differs between the
+           children of a node. */
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    Node root;
+    size_t count = 0;
+
+public:
+    /* Adds a value for the given prefix. */
+    void Insert(std::string_view prefix, T&& value) {
+        auto* node = &root;
+        while (!prefix.empty()) {
+            auto iter = Find(*node, prefix[0]);
+            if (iter == node->children.end() || (*iter)->label[0] != prefix[0]) {
+                auto child = std::make_unique<Node>();
+                child->label = prefix;
+                node = node->children.insert(iter, std::move(child))->get();
+                break;
+            }
+
+            auto& child = *iter;
+            auto const common = Common(child->label, prefix);
+            if (common < child->label.size()) {
+                /* Split the label, so that the prefix ends at a node. */
+                auto split = std::make_unique<Node>();
+                split->label = child->label.substr(0, common);
+                child->label.erase(0, common);
+                split->children.push_back(std::move(child));
+                child = std::move(split);
+            }
+
+            node = child.get();
+            prefix.remove_prefix(common);
+        }
+
+        node->values.push_back(std::move(value));
+        count++;
+    }
+
+    /* Removes all values of the given prefix for which the predicate returns
+       true. Returns the number of values that were removed. */
+    template <typename P>
+    size_t Remove(std::string_view prefix, P&& predicate) {
+        auto const removed = Remove(root, prefix, predicate);
+        count -= removed;
+        return removed;
+    }
+
+    /* Calls the function with every value whose prefix is a prefix of the
+       given key, from the shortest prefix to the longest. */
+    template <typename F>
+    void Match(std::string_view key, F&& function) const {
+        auto const* node = &root;
+        while (true) {
+            for (auto const& value : node->values) {
+                function(value);
+            }
+
+            if (key.empty()) {
+                return;
+            }
+
+            auto const iter = Find(*node, key[0]);
+            if (iter == node->children.end() || (*iter)->label[0] != key[0]
+                || key.compare(0, (*iter)->label.size(), (*iter)->label) != 0) {
+                return;
+            }
+
+            node = iter->get();
+            key.remove_prefix(node->label.size());
+        }
+    }
+
+    void Clear() {
+        root.values.clear();
+        root.children.clear();
+        count = 0;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return count;
+    }
+
+private:
+    /* Returns the child that starts with the given byte, or where it would
+       have to be inserted. */
+    template <typename N>
+    static auto Find(N& node, char first) {
+        return std::lower_bound(node.children.begin(), node.children.end(), first,
+            [](const std::unique_ptr<Node>& child, char value) {
+                return static_cast<unsigned char>(child->label[0])
+                    < static_cast<unsigned char>(value);
+            });
+    }
+
+    static size_t Common(std::string_view lhs, std::string_view rhs) {
+        auto const length = std::min(lhs.size(), rhs.size());
+        return std::mismatch(lhs.begin(), lhs.begin() + length, rhs.begin()).first
+            - lhs.begin();
+    }
+
+    template <typename P>
+    static size_t Remove(Node& node, std::string_view prefix, P& predicate) {
+        if (prefix.empty()) {
+            auto const size = node.values.size();
+            node.values.erase(
+                std::remove_if(node.values.begin(), node.values.end(), predicate),
+                node.values.end());
+            return size - node.values.size();
+        }
+
+        auto const iter = Find(node, prefix[0]);
+        if (iter == node.children.end() || (*iter)->label[0] != prefix[0]
+            || prefix.compare(0, (*iter)->label.size(), (*iter)->label) != 0) {
+            return 0;
+        }
+
+        auto& child = *iter;
+        auto const removed =
+            Remove(*child, prefix.substr(child->label.size()), predicate);
+
+        /* Drop nodes without values, and merge nodes with a single child, so
+           that the tree stays as small as if the prefix was never added. */
+        if (child->values.empty()) {
+            if (child->children.empty()) {
+                node.children.erase(iter);
+            } else if (child->children.size() == 1) {
+                auto grandchild = std::move(child->children.front());
+                grandchild->label.insert(0, child->label);
+                child = std::move(grandchild);
+            }
+        }
+
+        return removed;
+    }
+};
+}  // namespace zmq
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <system_error>
+#include <thread>
+
+#include "uvhandle.h"
+#include "uvloop.h"
+
+namespace zmq {
+/* Runs a long running function on a dedicated native thread and calls the
+   completion callback on the event loop thread when it returns. Unlike
+   UvWork, this does not occupy a thread of the libuv thread pool, which is
+   shared with file system and DNS operations. The pending completion keeps
+   the event loop alive. Start() returns UV_EAGAIN if the thread cannot be
+   created, typically because of resource limits; neither callback is called
+   then. */
+template <typename E, typename C>
+class UvThread {
+    UvHandle<uv_async_t> async;
+    std::thread thread;
+
+    E execute_callback;
+    C complete_callback;
+
+public:
+    UvThread(E execute, C complete)
+        : execute_callback(std::move(execute)), complete_callback(std::move(complete)) {}
+
+    int32_t Start(uv_loop_t* loop) {
+        auto err = uv_async_init(loop, async.get(), [](uv_async_t* async) {
+            auto& work = *static_cast<UvThread*>(async->data);
+            work.thread.join();
+            work.complete_callback();
+            delete &work;
+        });
+
+        if (err != 0) {
+            delete this;
+            return err;
+        }
+
+        async->data = this;
+
+        try {
+            thread = std::thread([this]() {
+                execute_callback();
+                uv_async_send(async.get());
+            });
+        } catch (const std::system_error& /*err*/) {
+            delete this;
+            return UV_EAGAIN;
+        }
+
+        return 0;
+    }
+};
+
+template <typename E, typename C>
+inline int32_t UvSpawn(const Napi::Env& env, E execute, C complete) {
+    auto* loop = UvLoop(env);
+    auto work = new UvThread<E, C>(std::move(execute), std::move(complete));
+    return work->Start(loop);
+}
+}  // namespace zmq
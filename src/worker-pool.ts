@@ -0,0 +1,86 @@
+import {Dealer, Message} from "."
+import {FullError} from "./errors"
+import {WorkerPool} from "./native"
+
+/* Commands sent to the pool; also see src/dispatcher.h. */
+const readyCommand = "R"
+const leaveCommand = "L"
+
+/**
+ * Receives messages from a {@link WorkerPool}, typically in a worker thread.
+ * The pool sends a worker the next message only after it has finished
+ * handling the previous one, which is signalled by calling {@link receive}()
+ * again. A worker must therefore not receive its next message before it has
+ * finished handling the current one.
+ *
+ * ```typescript
+ * const worker = new PoolWorker(workerData.address)
+ * for await (const msg of worker) {
+ *   // handle message
+ * }
+ * ```
+ */
+export class PoolWorker {
+  private readonly socket: Dealer
+
+  /**
+   * Connects to a pool.
+   *
+   * @param address The {@link WorkerPool.workerAddress} of the pool.
+   */
+  constructor(address: WorkerPool["workerAddress"]) {
+    this.socket = new Dealer({linger: 1000})
+    this.socket.connect(address)
+  }
+
+  /**
+   * Whether this worker was previously closed with {@link close}().
+   */
+  get closed(): boolean {
+    return this.socket.closed
+  }
+
+  /**
+   * Signals that the previous message, if any, has been handled and waits for
+   * the next message of the pool.
+   *
+   * @returns Resolved with the message parts.
+   */
+  async receive(): Promise<Message[]> {
+    await this.socket.send(readyCommand)
+    return this.socket.receive()
+  }
+
+  /**
+   * Detaches from the pool and closes the worker. Messages that were queued
+   * for this worker remain with the pool, and are handled by the next worker
+   * that connects or by other workers.
+   */
+  close() {
+    if (this.socket.closed) {
+      return
+    }
+
+    /* The pool also notices workers that disappear without leaving, so a
+       failure to send is not a problem. */
+    this.socket.send(leaveCommand).catch(() => undefined)
+    this.socket.close()
+  }
+
+  /**
+   * Asynchronously iterate over the messages of the pool. Ends when the
+   * worker is closed.
+   */
+  async *[Symbol.asyncIterator](): AsyncIterator<Message[], undefined> {
+    while (!this.socket.closed) {
+      try {
+        yield await this.receive()
+      } catch (err) {
+        if (this.socket.closed && (err as FullError).code === "EAGAIN") {
+          return
+        }
+        throw err
+      }
+    }
+  }
+}
@@ -0,0 +1,173 @@
+
+#include "./worker_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "./module.h"
+#include "util/arguments.h"
+#include "util/error.h"
+
+namespace zmq {
+/* Number of messages that may wait for each worker by default. */
+static constexpr uint32_t default_queue_capacity = 16;
+
+/* Reads an optional positive integer option. Returns false and throws if the
+   option is invalid. */
+static bool GetCount(
+    const Napi::Object& options, const char* name, const char* msg, uint32_t& value) {
+    if (!options.Has(name)) {
+        return true;
+    }
+
+    auto const option = options.Get(name);
+    if (option.IsUndefined()) {
+        return true;
+    }
+
+    if (option.IsNumber()) {
+        auto const number = option.As<Napi::Number>().DoubleValue();
+        if (number >= 1 && number <= UINT32_MAX && number == std::floor(number)) {
+            value = static_cast<uint32_t>(number);
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(options.Env(), msg).ThrowAsJavaScriptException();
+    return false;
+}
+
+WorkerPool::WorkerPool(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<WorkerPool>(info), module(*static_cast<Module*>(info.Data())) {
+    Arg::Validator const args{
+        Arg::Optional<Arg::Object>("Options must be an object"),
+    };
+
+    if (args.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    uint32_t workers = std::max(std::thread::hardware_concurrency(), 1U);
+    uint32_t queue_capacity = default_queue_capacity;
+    bool affinity = false;
+
+    if (info[0].IsObject()) {
+        auto options = info[0].As<Napi::Object>();
+        if (!GetCount(options, "workers", "Workers must be a positive integer", workers)
+            || !GetCount(options, "queueCapacity",
+                "Queue capacity must be a positive integer", queue_capacity)) {
+            return;
+        }
+
+        if (options.Has("affinity")) {
+            affinity = options.Get("affinity").ToBoolean();
+        }
+    }
+
+    /* Use `this` pointer as unique identifier for the inproc endpoints. */
+    address = std::string("inproc://zmq.pool.")
+        + std::to_string(reinterpret_cast<uintptr_t>(this));
+    worker_address = address + ".workers";
+
+    /* Workers in other agents/threads connect through the shared context. */
+    if (dispatcher.Start(module.Global().SharedContext, address, worker_address, workers,
+            queue_capacity, affinity)
+        < 0) {
+        ErrnoException(Env(), zmq_errno()).ThrowAsJavaScriptException();
+        return;
+    }
+
+    module.ObjectReaper.Add(this);
+}
+
+WorkerPool::~WorkerPool() {
+    Close();
+}
+
+void WorkerPool::Close() {
+    if (dispatcher.Active()) {
+        module.ObjectReaper.Remove(this);
+        dispatcher.Stop();
+    }
+}
+
+void WorkerPool::Close(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return;
+    }
+
+    Close();
+}
+
+Napi::Value WorkerPool::Statistics(const Napi::CallbackInfo& info) {
+    if (Arg::Validator{}.ThrowIfInvalid(info)) {
+        return Env().Undefined();
+    }
+
+    if (!dispatcher.Active()) {
+        ErrnoException(Env(), EBADF, "Pool is closed").ThrowAsJavaScriptException();
+        return Env().Undefined();
+    }
+
+    auto const now = Dispatcher::Now();
+    auto const elapsed = static_cast<double>(now - dispatcher.Started());
+
+    auto const& slots = dispatcher.Slots();
+    auto result = Napi::Array::New(Env(), slots.size());
+    for (uint32_t index = 0; index < slots.size(); index++) {
+        auto const& slot = slots[index];
+
+        /* Include the time spent on messages that are still in progress. */
+        auto busy = slot.busy_nanos.load(std::memory_order_relaxed);
+        auto const since = slot.busy_since.load(std::memory_order_relaxed);
+        if (since != 0) {
+            busy += now - since;
+        }
+
+        auto const utilization =
+            elapsed > 0 ? std::min(static_cast<double>(busy) / elapsed, 1.0) : 0.0;
+
+        auto stats = Napi::Object::New(Env());
+        stats["attached"] = slot.attached.load(std::memory_order_relaxed);
+        stats["queued"] = slot.queued.load(std::memory_order_relaxed);
+        stats["active"] = slot.active.load(std::memory_order_relaxed);
+        stats["processed"] =
+            static_cast<double>(slot.processed.load(std::memory_order_relaxed));
+        stats["stolen"] =
+            static_cast<double>(slot.stolen.load(std::memory_order_relaxed));
+        stats["utilization"] = utilization;
+        result[index] = stats;
+    }
+
+    return result;
+}
+
+Napi::Value WorkerPool::GetAddress(const Napi::CallbackInfo& /*info*/) {
+    return Napi::String::New(Env(), address);
+}
+
+Napi::Value WorkerPool::GetWorkerAddress(const Napi::CallbackInfo& /*info*/) {
+    return Napi::String::New(Env(), worker_address);
+}
+
+Napi::Value WorkerPool::GetClosed(const Napi::CallbackInfo& /*info*/) {
+    return Napi::Boolean::New(Env(), !dispatcher.Active());
+}
+
+void WorkerPool::Initialize(Module& module, Napi::Object& exports) {
+    auto proto = {
+        InstanceMethod<&WorkerPool::Close>("close"),
+        InstanceMethod<&WorkerPool::Statistics>("statistics"),
+
+        InstanceAccessor<&WorkerPool::GetAddress>("address"),
+        InstanceAccessor<&WorkerPool::GetWorkerAddress>("workerAddress"),
+        InstanceAccessor<&WorkerPool::GetClosed>("closed"),
+    };
+
+    auto constructor = DefineClass(exports.Env(), "WorkerPool", proto, &module);
+    module.WorkerPool = Napi::Persistent(constructor);
+    exports.Set("WorkerPool", constructor);
+}
+}  // namespace zmq
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <napi.h>
+
+#include <string>
+
+#include "./closable.h"
+#include "./dispatcher.h"
+
+namespace zmq {
+class Module;
+
+class WorkerPool : public Napi::ObjectWrap<WorkerPool>, public Closable {
+public:
+    static void Initialize(Module& module, Napi::Object& exports);
+
+    explicit WorkerPool(const Napi::CallbackInfo& info);
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    WorkerPool& operator=(WorkerPool&&) = delete;
+    ~WorkerPool() override;
+
+    void Close() override;
+
+protected:
+    inline void Close(const Napi::CallbackInfo& info);
+    inline Napi::Value Statistics(const Napi::CallbackInfo& info);
+
+    inline Napi::Value GetAddress(const Napi::CallbackInfo& info);
+    inline Napi::Value GetWorkerAddress(const Napi::CallbackInfo& info);
+    inline Napi::Value GetClosed(const Napi::CallbackInfo& info);
+
+private:
+    Module& module;
+    Dispatcher dispatcher;
+    std::string address;
+    std::string worker_address;
+};
+}  // namespace zmq
+
+static_assert(!std::is_copy_constructible_v<zmq::WorkerPool>, "not copyable");
+static_assert(!std::is_move_constructible_v<zmq::WorkerPool>, "not movable");
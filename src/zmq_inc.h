@@ -22,9 +22,19 @@
 #define ZMQ_HAS_STEERABLE_PROXY 1
 #endif
 
+/* Steerable proxies reply to the STATISTICS command since 4.3.0. */
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 3, 0)
+#define ZMQ_HAS_PROXY_STATISTICS 1
+#endif
+
 /* Threadsafe sockets can only be used if zmq_poller_fd() is available. */
 #if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 3, 2)
 #ifdef ZMQ_BUILD_DRAFT_API
 #define ZMQ_HAS_POLLABLE_THREAD_SAFE 1
 #endif
 #endif
+
+/* Shared memory channels rely on memfd and eventfd, which are Linux only. */
+#ifdef __linux__
+#define ZMQ_HAS_MEMORY_CHANNEL 1
+#endif
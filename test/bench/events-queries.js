@@ -0,0 +1,66 @@
+/* Reports the number of ZMQ_EVENTS queries per delivered message. Requires
+   the addon to be built with `zmq_count_events="true"`. In the duplex mode,
+   the client sends while a receive is pending, so that one query can serve
+   both directions. */
+const {eventsQueries} = require("../../lib/native")
+
+for (const duplex of [false, true]) {
+  if (zmq.ng && eventsQueries) {
+    let queries = 0
+    let messages = 0
+
+    suite.add(
+      `events queries proto=${proto} msgsize=${msgsize} n=${n} duplex=${duplex} zmq=ng`,
+      Object.assign(
+        {
+          fn: async deferred => {
+            const server = new zmq.ng.Dealer()
+            const client = new zmq.ng.Dealer()
+
+            await server.bind(address)
+            client.connect(address)
+
+            const before = eventsQueries()
+
+            const send = async () => {
+              for (let i = 0; i < n; i++) {
+                await client.send(Buffer.alloc(msgsize))
+              }
+            }
+
+            const receive = async () => {
+              for (let j = 0; j < n; j++) {
+                const [msg] = await server.receive()
+                if (duplex) {
+                  await server.send(msg)
+                }
+              }
+            }
+
+            const replies = async () => {
+              for (let j = 0; duplex && j < n; j++) {
+                await client.receive()
+              }
+            }
+
+            await Promise.all([send(), receive(), replies()])
+
+            queries += eventsQueries() - before
+            messages += duplex ? 2 * n : n
+
+            server.close()
+            client.close()
+
+            deferred.resolve()
+          },
+
+          onComplete: () => {
+            const perMessage = (queries / messages).toFixed(2)
+            console.log(`  getsockopt(ZMQ_EVENTS) per message: ${perMessage}`)
+          },
+        },
+        benchOptions,
+      ),
+    )
+  }
+}
@@ -26,6 +26,9 @@ const benchmarks = {
   deliver: {n, protos, msgsizes},
   "deliver-multipart": {n, protos, msgsizes},
   "deliver-async-iterator": {n, protos, msgsizes},
+  "events-queries": {n, protos, msgsizes: [1]},
+  latency: {n, protos, msgsizes: [1]},
+  "server-scaling": {n, protos, msgsizes: [1]},
 }
 
 /* Set the exported libraries: current and next-gen. */
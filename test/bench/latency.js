@@ -0,0 +1,53 @@
+/* Ping-pong round trip latency, reported as p50/p99 per benchmark. */
+for (const busyPollMicros of [0, 50]) {
+  if (zmq.ng) {
+    const samples = []
+
+    suite.add(
+      `latency proto=${proto} msgsize=${msgsize} n=${n} busyPoll=${busyPollMicros} zmq=ng`,
+      Object.assign(
+        {
+          fn: async deferred => {
+            const server = new zmq.ng.Dealer({busyPollMicros})
+            const client = new zmq.ng.Dealer({busyPollMicros})
+
+            await server.bind(address)
+            client.connect(address)
+
+            const echo = async () => {
+              for (let i = 0; i < n; i++) {
+                const [msg] = await server.receive()
+                await server.send(msg)
+              }
+            }
+
+            const ping = async () => {
+              for (let i = 0; i < n; i++) {
+                const start = process.hrtime.bigint()
+                await client.send(Buffer.alloc(msgsize))
+                await client.receive()
+                samples.push(Number(process.hrtime.bigint() - start) / 1e3)
+              }
+            }
+
+            await Promise.all([echo(), ping()])
+
+            server.close()
+            client.close()
+
+            deferred.resolve()
+          },
+
+          onComplete: () => {
+            samples.sort((a, b) => a - b)
+            const pct = p => samples[Math.floor((samples.length - 1) * p)]
+            console.log(
+              `  round trip p50: ${pct(0.5).toFixed(1)}us p99: ${pct(0.99).toFixed(1)}us`,
+            )
+          },
+        },
+        benchOptions,
+      ),
+    )
+  }
+}
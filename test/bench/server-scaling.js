@@ -0,0 +1,89 @@
+/* Request throughput of one shared SERVER socket handled by 1 to N worker
+   threads. Each request costs a fixed amount of CPU time in the worker. */
+const {cpus} = require("os")
+const {Worker} = require("worker_threads")
+const draft = require("../../draft")
+
+const workerSrc = `
+  const {parentPort, workerData} = require("worker_threads")
+  const draft = require(workerData.draft)
+
+  const server = draft.Server.adopt(workerData.handle)
+  parentPort.once("message", () => server.close())
+
+  async function run() {
+    for await (const [msg, {routingId}] of server) {
+      /* Simulate a request that takes some effort to handle. */
+      let hash = 0
+      for (let i = 0; i < 20000; i++) {
+        hash = (hash * 31 + msg.length + i) | 0
+      }
+
+      await server.send(msg, {routingId})
+    }
+  }
+
+  run()
+`
+
+const counts = [...new Set([1, 2, 4, cpus().length])].sort((a, b) => a - b)
+
+for (const workers of counts) {
+  if (zmq.ng && zmq.ng.capability.draft) {
+    let server
+    let threads
+
+    suite.add(
+      `server scaling proto=${proto} msgsize=${msgsize} n=${n} workers=${workers} zmq=ng`,
+      Object.assign(
+        {
+          fn: async deferred => {
+            if (!server) {
+              server = new draft.Server()
+              await server.bind(address)
+
+              threads = Array.from({length: workers}, () => {
+                return new Worker(workerSrc, {
+                  eval: true,
+                  workerData: {
+                    draft: require.resolve("../../draft"),
+                    handle: server.share(),
+                  },
+                })
+              })
+            }
+
+            const client = new draft.Client()
+            client.connect(address)
+
+            const send = async () => {
+              for (let i = 0; i < n; i++) {
+                await client.send(Buffer.alloc(msgsize))
+              }
+            }
+
+            const receive = async () => {
+              for (let i = 0; i < n; i++) {
+                await client.receive()
+              }
+            }
+
+            await Promise.all([send(), receive()])
+            client.close()
+
+            deferred.resolve()
+          },
+
+          onComplete: () => {
+            for (const thread of threads) {
+              thread.postMessage("close")
+            }
+
+            server.close()
+          },
+        },
+        benchOptions,
+      ),
+    )
+  }
+}
@@ -0,0 +1,163 @@
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
+
+for (const proto of testProtos("tcp", "ipc", "inproc")) {
+  describe(`broker with ${proto}`, function () {
+    let router: zmq.Router
+    let broker: zmq.Broker
+    let address: string
+
+    beforeEach(async function () {
+      router = new zmq.Router({mandatory: true})
+      broker = new zmq.Broker(router)
+      address = await uniqAddress(proto)
+      await router.bind(address)
+    })
+
+    afterEach(function () {
+      router.close()
+      global.gc?.()
+    })
+
+    async function addWorker(service: string) {
+      const worker = new zmq.Dealer()
+      worker.connect(address)
+      await worker.send([null, "MDPW01", "\x01", service])
+      return worker
+    }
+
+    async function reply(worker: zmq.Dealer) {
+      const [, , command, client, , body] = await worker.receive()
+      assert.equal(command.toString(), "\x02")
+      await worker.send([null, "MDPW01", "\x03", client, null, body])
+    }
+
+    it("should pass requests to workers and return replies", async function () {
+      const done = broker.run()
+      const worker = await addWorker("echo")
+
+      const client = new zmq.Request()
+      client.connect(address)
+      await client.send(["MDPC01", "echo", "foo"])
+      await reply(worker)
+
+      const [header, service, body] = await client.receive()
+      assert.equal(header.toString(), "MDPC01")
+      assert.equal(service.toString(), "echo")
+      assert.equal(body.toString(), "foo")
+
+      const [stats] = await broker.statistics()
+      assert.deepEqual(stats, {
+        service: "echo",
+        workers: 1,
+        idle: 1,
+        queued: 0,
+        requests: 1,
+        replies: 1,
+      })
+
+      broker.terminate()
+      await done
+      assert.equal(router.closed, true)
+
+      worker.close()
+      client.close()
+    })
+
+    it("should queue requests until a worker is ready", async function () {
+      const done = broker.run()
+
+      const client = new zmq.Request()
+      client.connect(address)
+      await client.send(["MDPC01", "echo", "foo"])
+
+      /* Wait until the broker has received the request. */
+      while ((await broker.statistics()).length === 0) {
+        await new Promise(resolve => setTimeout(resolve, 5))
+      }
+
+      const [queued] = await broker.statistics()
+      assert.equal(queued.queued, 1)
+      assert.equal(queued.workers, 0)
+
+      const worker = await addWorker("echo")
+      await reply(worker)
+
+      const [, , body] = await client.receive()
+      assert.equal(body.toString(), "foo")
+
+      broker.terminate()
+      await done
+
+      worker.close()
+      client.close()
+    })
+
+    it("should throw if the socket is not a router", function () {
+      const dealer = new zmq.Dealer()
+
+      try {
+        new zmq.Broker(dealer)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Socket must be a router")
+        assert.equal(err.code, "EINVAL")
+      } finally {
+        dealer.close()
+      }
+    })
+
+    it("should throw on invalid heartbeat options", function () {
+      try {
+        new zmq.Broker(router, {heartbeatInterval: -1})
+        assert.ok(false)
+      } catch (err) {
+        if (!(err instanceof TypeError)) {
+          throw err
+        }
+        assert.equal(
+          err.message,
+          "Heartbeat interval must be a non-negative integer",
+        )
+      }
+    })
+
+    it("should reject statistics after termination", async function () {
+      const done = broker.run()
+      broker.terminate()
+      const stats = broker.statistics()
+
+      try {
+        await stats
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Broker is not running")
+        assert.equal(err.code, "EBADF")
+      }
+
+      await done
+    })
+
+    it("should throw if not running", function () {
+      try {
+        broker.statistics()
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Broker is not running")
+        assert.equal(err.code, "EBADF")
+      }
+    })
+  })
+}
@@ -0,0 +1,155 @@
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
+
+for (const proto of testProtos("tcp", "ipc", "inproc")) {
+  describe(`last value cache with ${proto}`, function () {
+    let publisher: zmq.Publisher
+    let frontEnd: zmq.XSubscriber
+    let backEnd: zmq.XPublisher
+    let cache: zmq.LastValueCache
+    let address: string
+
+    beforeEach(async function () {
+      publisher = new zmq.Publisher()
+      const upstream = await uniqAddress(proto)
+      await publisher.bind(upstream)
+
+      frontEnd = new zmq.XSubscriber()
+      frontEnd.connect(upstream)
+
+      backEnd = new zmq.XPublisher()
+      address = await uniqAddress(proto)
+      await backEnd.bind(address)
+
+      cache = new zmq.LastValueCache(frontEnd, backEnd, {maxTopics: 2})
+    })
+
+    afterEach(function () {
+      publisher.close()
+      frontEnd.close()
+      backEnd.close()
+      global.gc?.()
+    })
+
+    /* Publishes until the cache has stored the given number of topics. The
+       first messages may be lost while the front-end is still connecting. */
+    async function publish(topics: string[]) {
+      while (true) {
+        for (const topic of topics) {
+          await publisher.send([topic, `value-${topic}`])
+        }
+
+        await new Promise(resolve => setTimeout(resolve, 15))
+        if ((await cache.statistics()).topics === Math.min(topics.length, 2)) {
+          return
+        }
+      }
+    }
+
+    it("should replay cached topics to new subscribers", async function () {
+      const done = cache.run()
+      await publish(["a1", "a2"])
+
+      const subscriber = new zmq.Subscriber()
+      subscriber.connect(address)
+      subscriber.subscribe("a")
+
+      const received = new Set<string>()
+      while (received.size < 2) {
+        const [topic, value] = await subscriber.receive()
+        assert.equal(value.toString(), `value-${topic}`)
+        received.add(topic.toString())
+      }
+
+      assert.deepEqual([...received].sort(), ["a1", "a2"])
+
+      const stats = await cache.statistics()
+      assert.equal(stats.hits, 1)
+      assert.equal(stats.misses, 0)
+      assert.equal(stats.replayed, 2)
+
+      cache.terminate()
+      await done
+      assert.equal(frontEnd.closed, true)
+      assert.equal(backEnd.closed, true)
+
+      subscriber.close()
+    })
+
+    it("should evict the least recently updated topics", async function () {
+      const done = cache.run()
+      await publish(["a", "b", "c"])
+
+      const stats = await cache.statistics()
+      assert.equal(stats.topics, 2)
+      assert.isAbove(stats.evictions, 0)
+
+      cache.terminate()
+      await done
+    })
+
+    it("should throw if the sockets have the wrong type", function () {
+      const subscriber = new zmq.Subscriber()
+
+      try {
+        new zmq.LastValueCache(subscriber, backEnd)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Front-end must be an XSubscriber")
+        assert.equal(err.code, "EINVAL")
+      } finally {
+        subscriber.close()
+      }
+    })
+
+    it("should throw on invalid options", function () {
+      try {
+        new zmq.LastValueCache(frontEnd, backEnd, {maxBytes: 0})
+        assert.ok(false)
+      } catch (err) {
+        if (!(err instanceof TypeError)) {
+          throw err
+        }
+        assert.equal(err.message, "Max bytes must be a positive integer")
+      }
+    })
+
+    it("should reject statistics after termination", async function () {
+      const done = cache.run()
+      cache.terminate()
+      const stats = cache.statistics()
+
+      try {
+        await stats
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Cache is not running")
+        assert.equal(err.code, "EBADF")
+      }
+
+      await done
+    })
+
+    it("should throw if not running", function () {
+      try {
+        cache.statistics()
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Cache is not running")
+        assert.equal(err.code, "EBADF")
+      }
+    })
+  })
+}
@@ -0,0 +1,174 @@
+import * as path from "path"
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {spawn} from "child_process"
+import {isFullError} from "../../src/errors"
+
+describe("memory channel", function () {
+  let channelA: zmq.MemoryChannel
+  let channelB: zmq.MemoryChannel
+
+  beforeEach(function () {
+    if (process.platform !== "linux") {
+      this.skip()
+    }
+  })
+
+  afterEach(function () {
+    channelA?.close()
+    channelB?.close()
+    global.gc?.()
+  })
+
+  it("should send and receive messages in both directions", async function () {
+    channelA = new zmq.MemoryChannel()
+    channelB = new zmq.MemoryChannel({descriptors: channelA.descriptors})
+
+    await channelA.send("foo")
+    await channelB.send(["bar", "baz"])
+
+    const [msgA] = await channelB.receive()
+    const [msgB, msgC] = await channelA.receive()
+    assert.equal(msgA.toString(), "foo")
+    assert.equal(msgB.toString(), "bar")
+    assert.equal(msgC.toString(), "baz")
+  })
+
+  it("should wait for room when the ring is full", async function () {
+    channelA = new zmq.MemoryChannel({size: 256})
+    channelB = new zmq.MemoryChannel({descriptors: channelA.descriptors})
+
+    const count = 1000
+    const send = async () => {
+      for (let i = 0; i < count; i++) {
+        await channelA.send(["key", i.toString()])
+      }
+    }
+
+    const received: number[] = []
+    const receive = async () => {
+      for await (const [key, value] of channelB) {
+        assert.equal(key.toString(), "key")
+        received.push(parseInt(value.toString(), 10))
+        if (received.length === count) {
+          break
+        }
+      }
+    }
+
+    await Promise.all([send(), receive()])
+    assert.deepEqual(received, Array.from({length: count}, (_, i) => i))
+  })
+
+  it("should exchange messages with another process", async function () {
+    channelA = new zmq.MemoryChannel()
+
+    const src = `
+      const zmq = require(${JSON.stringify(path.resolve(__dirname, "../.."))})
+      const channel = new zmq.MemoryChannel({descriptors: [3, 4, 5]})
+      channel.receive().then(async ([msg]) => {
+        await channel.send([msg, "pong"])
+        channel.close()
+      })
+    `
+
+    const child = spawn(process.argv[0], ["-e", src], {
+      stdio: ["ignore", "inherit", "inherit", ...channelA.descriptors],
+    })
+
+    await channelA.send("ping")
+    const [msgA, msgB] = await channelA.receive()
+    assert.equal(msgA.toString(), "ping")
+    assert.equal(msgB.toString(), "pong")
+
+    await new Promise(resolve => child.on("close", resolve))
+  })
+
+  it("should throw when a message is too large", async function () {
+    channelA = new zmq.MemoryChannel({size: 256})
+
+    try {
+      await channelA.send(Buffer.alloc(128))
+      assert.ok(false)
+    } catch (err) {
+      if (!isFullError(err)) {
+        throw err
+      }
+      assert.equal(err.code, "EMSGSIZE")
+      assert.typeOf(err.errno, "number")
+    }
+  })
+
+  it("should throw when opening invalid descriptors", function () {
+    channelA = new zmq.MemoryChannel()
+    const [memory, events] = channelA.descriptors
+
+    try {
+      channelB = new zmq.MemoryChannel({descriptors: [events, events, memory]})
+      assert.ok(false)
+    } catch (err) {
+      if (!isFullError(err)) {
+        throw err
+      }
+      assert.equal(err.message, "Descriptors do not refer to a memory channel")
+      assert.equal(err.code, "EINVAL")
+    }
+  })
+
+  it("should reject pending receive when closed", async function () {
+    channelA = new zmq.MemoryChannel()
+    const promise = channelA.receive()
+    channelA.close()
+    assert.equal(channelA.closed, true)
+
+    try {
+      await promise
+      assert.ok(false)
+    } catch (err) {
+      if (!isFullError(err)) {
+        throw err
+      }
+      assert.equal(err.code, "EAGAIN")
+    }
+  })
+
+  it("should reject pending receive when the peer closes", async function () {
+    channelA = new zmq.MemoryChannel()
+    channelB = new zmq.MemoryChannel({descriptors: channelA.descriptors})
+
+    await channelA.send("foo")
+    const [msg] = await channelB.receive()
+    assert.equal(msg.toString(), "foo")
+
+    const promise = channelB.receive()
+    channelA.close()
+
+    try {
+      await promise
+      assert.ok(false)
+    } catch (err) {
+      if (!isFullError(err)) {
+        throw err
+      }
+      assert.equal(err.message, "Peer is gone")
+      assert.equal(err.code, "EPIPE")
+    }
+  })
+
+  it("should throw when sending after close", async function () {
+    channelA = new zmq.MemoryChannel()
+    channelA.close()
+
+    try {
+      await channelA.send("foo")
+      assert.ok(false)
+    } catch (err) {
+      if (!isFullError(err)) {
+        throw err
+      }
+      assert.equal(err.message, "Channel is closed")
+      assert.equal(err.code, "EBADF")
+    }
+  })
+})
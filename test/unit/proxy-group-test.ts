@@ -0,0 +1,151 @@
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
+
+for (const proto of testProtos("tcp", "ipc", "inproc")) {
+  describe(`proxy group with ${proto}`, function () {
+    let group: zmq.ProxyGroup
+    let senders: zmq.Push[]
+    let receivers: zmq.Pull[]
+
+    beforeEach(function () {
+      group = new zmq.ProxyGroup()
+      senders = []
+      receivers = []
+    })
+
+    afterEach(function () {
+      group.close()
+      senders.forEach(socket => socket.close())
+      receivers.forEach(socket => socket.close())
+      global.gc?.()
+    })
+
+    async function addPair() {
+      const frontEnd = new zmq.Pull()
+      const backEnd = new zmq.Push()
+
+      const frontAddress = await uniqAddress(proto)
+      const backAddress = await uniqAddress(proto)
+      await frontEnd.bind(frontAddress)
+      await backEnd.bind(backAddress)
+
+      const sender = new zmq.Push()
+      const receiver = new zmq.Pull({receiveTimeout: 100})
+      sender.connect(frontAddress)
+      receiver.connect(backAddress)
+      senders.push(sender)
+      receivers.push(receiver)
+
+      return {pair: group.add(frontEnd, backEnd), sender, receiver}
+    }
+
+    it("should proxy messages of all pairs", async function () {
+      const pairs = await Promise.all([addPair(), addPair(), addPair()])
+      assert.equal(group.size, 3)
+
+      for (const [index, {sender, receiver}] of pairs.entries()) {
+        await sender.send(`msg${index}`)
+        const [msg] = await receiver.receive()
+        assert.equal(msg.toString(), `msg${index}`)
+      }
+    })
+
+    it("should pause and resume a pair", async function () {
+      const {pair, sender, receiver} = await addPair()
+      const other = await addPair()
+
+      group.pause(pair)
+      await sender.send("foo")
+      await other.sender.send("bar")
+
+      const [msg] = await other.receiver.receive()
+      assert.equal(msg.toString(), "bar")
+
+      try {
+        await receiver.receive()
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.code, "EAGAIN")
+      }
+
+      group.resume(pair)
+      const [resumed] = await receiver.receive()
+      assert.equal(resumed.toString(), "foo")
+    })
+
+    it("should close the sockets of a removed pair", async function () {
+      const frontEnd = new zmq.Pull()
+      const backEnd = new zmq.Push()
+      await frontEnd.bind(await uniqAddress(proto))
+      await backEnd.bind(await uniqAddress(proto))
+
+      const pair = group.add(frontEnd, backEnd)
+      group.remove(pair)
+
+      assert.equal(group.size, 0)
+      assert.equal(frontEnd.closed, true)
+      assert.equal(backEnd.closed, true)
+    })
+
+    it("should throw if sockets are not bound or connected", async function () {
+      const frontEnd = new zmq.Pull()
+      const backEnd = new zmq.Push()
+      await backEnd.bind(await uniqAddress(proto))
+
+      try {
+        group.add(frontEnd, backEnd)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Front-end socket must be bound or connected")
+        assert.equal(err.code, "EINVAL")
+      } finally {
+        frontEnd.close()
+        backEnd.close()
+      }
+    })
+
+    it("should throw for unknown pairs", function () {
+      try {
+        group.pause(42)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Pair does not exist")
+        assert.equal(err.code, "EINVAL")
+      }
+    })
+
+    it("should throw after close", async function () {
+      group.close()
+      assert.equal(group.closed, true)
+
+      const frontEnd = new zmq.Pull()
+      const backEnd = new zmq.Push()
+
+      try {
+        group.add(frontEnd, backEnd)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Proxy group is closed")
+        assert.equal(err.code, "EBADF")
+      } finally {
+        frontEnd.close()
+        backEnd.close()
+      }
+    })
+  })
+}
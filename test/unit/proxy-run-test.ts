@@ -87,5 +87,138 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         assert.typeOf(err.errno, "number")
       }
     })
+
+    it("should run on a thread with the given affinity", async function () {
+      if (process.platform !== "linux") {
+        this.skip()
+      }
+
+      await proxy.frontEnd.bind(await uniqAddress(proto))
+      await proxy.backEnd.bind(await uniqAddress(proto))
+
+      setTimeout(() => proxy.terminate(), 50)
+      await proxy.run({threadAffinity: [0], threadPriority: 0})
+    })
+
+    it("should report statistics", async function () {
+      if (semver.satisfies(zmq.version, "< 4.3.0")) {
+        this.skip()
+      }
+
+      const frontAddress = await uniqAddress(proto)
+      const backAddress = await uniqAddress(proto)
+      await proxy.frontEnd.bind(frontAddress)
+      await proxy.backEnd.bind(backAddress)
+      const done = proxy.run()
+
+      const client = new zmq.Dealer()
+      const worker = new zmq.Router()
+      client.connect(frontAddress)
+      worker.connect(backAddress)
+
+      await client.send("foo")
+      await worker.receive()
+
+      const stats = await proxy.statistics()
+      assert.isAtLeast(stats.frontEnd.messagesIn, 1)
+      assert.isAtLeast(stats.frontEnd.bytesIn, 3)
+      assert.equal(stats.backEnd.messagesOut, stats.frontEnd.messagesIn)
+      assert.equal(stats.backEnd.bytesOut, stats.frontEnd.bytesIn)
+      assert.equal(stats.backEnd.messagesIn, 0)
+
+      proxy.terminate()
+      await done
+
+      client.close()
+      worker.close()
+    })
+
+    it("should copy selected messages to capture", async function () {
+      const frontAddress = await uniqAddress(proto)
+      const backAddress = await uniqAddress(proto)
+      const captureAddress = await uniqAddress(proto)
+      await proxy.frontEnd.bind(frontAddress)
+      await proxy.backEnd.bind(backAddress)
+
+      const capture = new zmq.Push()
+      await capture.bind(captureAddress)
+      const done = proxy.run({
+        capture: {
+          socket: capture,
+          part: 1,
+          prefix: "ev",
+          sample: 2,
+          truncate: 3,
+        },
+      })
+
+      const client = new zmq.Dealer()
+      const worker = new zmq.Dealer()
+      const monitor = new zmq.Pull({receiveTimeout: 100})
+      client.connect(frontAddress)
+      worker.connect(backAddress)
+      monitor.connect(captureAddress)
+
+      for (let i = 0; i < 10; i++) {
+        await client.send(i % 2 ? "event" : "other")
+        await worker.receive()
+      }
+
+      /* Every second message with the prefix, truncated. */
+      for (let i = 0; i < 2; i++) {
+        const [, body] = await monitor.receive()
+        assert.equal(body.toString(), "eve")
+      }
+
+      proxy.terminate()
+      await done
+      assert.equal(capture.closed, false)
+
+      capture.close()
+      client.close()
+      worker.close()
+      monitor.close()
+    })
+
+    it("should fail with invalid capture options", async function () {
+      await proxy.frontEnd.bind(await uniqAddress(proto))
+      await proxy.backEnd.bind(await uniqAddress(proto))
+
+      const capture = new zmq.Push()
+      assert.throws(
+        () => proxy.run({capture: {socket: capture, sample: 0}}),
+        TypeError,
+        "Capture sample must be a positive integer",
+      )
+
+      try {
+        await proxy.run({capture: {socket: capture}})
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Capture socket must be bound or connected")
+        assert.equal(err.code, "EINVAL")
+      } finally {
+        capture.close()
+      }
+    })
+
+    it("should fail with invalid thread options", async function () {
+      await proxy.frontEnd.bind(await uniqAddress(proto))
+      await proxy.backEnd.bind(await uniqAddress(proto))
+
+      assert.throws(
+        () => proxy.run({threadAffinity: [-1]}),
+        TypeError,
+        "Thread affinity must be an array of CPU numbers",
+      )
+      assert.throws(
+        () => proxy.run({threadPriority: 20}),
+        TypeError,
+        "Thread priority must be an integer between -20 and 19",
+      )
+    })
   })
 }
@@ -0,0 +1,146 @@
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
+
+for (const proto of testProtos("tcp", "ipc", "inproc")) {
+  describe(`shard proxy with ${proto}`, function () {
+    let frontEnd: zmq.Pull
+    let shards: zmq.ShardProxy
+    let sender: zmq.Push
+    let receivers: zmq.Pull[]
+
+    beforeEach(async function () {
+      frontEnd = new zmq.Pull()
+      const address = await uniqAddress(proto)
+      await frontEnd.bind(address)
+
+      shards = new zmq.ShardProxy(frontEnd, {part: 0, offset: 4, length: 2})
+      sender = new zmq.Push()
+      sender.connect(address)
+      receivers = []
+    })
+
+    afterEach(function () {
+      shards.close()
+      sender.close()
+      receivers.forEach(socket => socket.close())
+      global.gc?.()
+    })
+
+    async function addShard() {
+      const backEnd = new zmq.Push()
+      const address = await uniqAddress(proto)
+      await backEnd.bind(address)
+
+      const receiver = new zmq.Pull({receiveTimeout: 100})
+      receiver.connect(address)
+      receivers.push(receiver)
+
+      return {shard: shards.add(backEnd), receiver}
+    }
+
+    /* Sends messages with the given keys and returns for each key the index
+       of the receiver that received it. */
+    async function route(keys: string[]) {
+      for (const key of keys) {
+        await sender.send([`user${key}-data`, "body"])
+      }
+
+      const owners = new Map<string, number>()
+      for (const [index, receiver] of receivers.entries()) {
+        while (true) {
+          try {
+            const [msg, body] = await receiver.receive()
+            assert.equal(body.toString(), "body")
+
+            const key = msg.toString().slice(4, 6)
+            assert.equal(owners.get(key) ?? index, index)
+            owners.set(key, index)
+          } catch (err) {
+            if (!isFullError(err) || err.code !== "EAGAIN") {
+              throw err
+            }
+            break
+          }
+        }
+      }
+
+      return owners
+    }
+
+    const keys = Array.from({length: 100}, (_, i) => String(i).padStart(2, "0"))
+
+    it("should pass on equal keys to the same back-end", async function () {
+      await Promise.all([addShard(), addShard(), addShard()])
+      assert.equal(shards.size, 3)
+
+      const owners = await route([...keys, ...keys])
+      assert.equal(owners.size, keys.length)
+
+      /* All back-ends should receive some of the keys. */
+      assert.equal(new Set(owners.values()).size, 3)
+    })
+
+    it("should only move the keys of a removed back-end", async function () {
+      const added = await Promise.all([addShard(), addShard(), addShard()])
+      const before = await route(keys)
+
+      const [removed] = receivers.splice(1, 1)
+      shards.remove(added[1].shard)
+      removed.close()
+
+      const after = await route(keys)
+      for (const key of keys) {
+        const owner = before.get(key)!
+        if (owner !== 1) {
+          assert.equal(after.get(key), owner > 1 ? owner - 1 : owner)
+        }
+      }
+    })
+
+    it("should hold messages until a back-end is added", async function () {
+      await sender.send(["user00", "body"])
+      const {receiver} = await addShard()
+
+      const [msg] = await receiver.receive()
+      assert.equal(msg.toString(), "user00")
+    })
+
+    it("should throw for unknown shards", function () {
+      try {
+        shards.remove(42)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Shard does not exist")
+        assert.equal(err.code, "EINVAL")
+      }
+    })
+
+    it("should throw after close", async function () {
+      shards.close()
+      assert.equal(shards.closed, true)
+      assert.equal(frontEnd.closed, true)
+
+      const backEnd = new zmq.Push()
+      await backEnd.bind(await uniqAddress(proto))
+
+      try {
+        shards.add(backEnd)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Shard proxy is closed")
+        assert.equal(err.code, "EBADF")
+      } finally {
+        backEnd.close()
+      }
+    })
+  })
+}
@@ -122,6 +122,13 @@ describe("socket construction", function () {
       assert.equal(sock.context, ctxt)
     })
 
+    it("should create socket with offloaded I/O", function () {
+      const sock = new zmq.Dealer({offload: true, recoveryInterval: 5})
+      assert.instanceOf(sock, zmq.Dealer)
+      assert.equal(sock.recoveryInterval, 5)
+      sock.close()
+    })
+
     it("should set option", function () {
       const sock = new zmq.Dealer({recoveryInterval: 5})
       assert.equal(sock.recoveryInterval, 5)
@@ -2,7 +2,7 @@ import * as zmq from "../../src"
 import * as draft from "../../src/draft"
 
 import {assert} from "chai"
-import {testProtos, uniqAddress} from "./helpers"
+import {createWorker, testProtos, uniqAddress} from "./helpers"
 import {isFullError} from "../../src/errors"
 
 for (const proto of testProtos("tcp", "ipc", "inproc")) {
@@ -92,5 +92,38 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         }
       })
     })
+
+    describe("with shared server", function () {
+      it("should handle requests in thread", async function () {
+        const address = await uniqAddress(proto)
+        await server.bind(address)
+        clientA.connect(address)
+
+        const data = {
+          draft: require.resolve("../../src/draft"),
+          handle: server.share(),
+        }
+
+        const reply = createWorker(data, async ({draft, handle}) => {
+          const shared = require(draft).Server.adopt(handle)
+          const [msg, {routingId}] = await shared.receive()
+          await shared.send(msg, {routingId})
+          shared.close()
+        })
+
+        await clientA.send("foo")
+        await reply
+
+        const [msg] = await clientA.receive()
+        assert.equal(msg.toString(), "foo")
+        assert.equal(server.closed, false)
+      })
+
+      it("should throw for socket that is not thread safe", function () {
+        const sock = new zmq.Dealer()
+        assert.throws(() => sock.share(), Error, "Socket cannot be shared")
+        sock.close()
+      })
+    })
   })
 }
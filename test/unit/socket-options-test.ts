@@ -145,6 +145,14 @@ describe("socket options", function () {
     }
   })
 
+  it("should set and get busy poll duration", function () {
+    const sock = new zmq.Dealer()
+    assert.equal(sock.busyPollMicros, 0)
+    sock.busyPollMicros = 50
+    assert.equal(sock.busyPollMicros, 50)
+    assert.throws(() => (sock.busyPollMicros = -1), Error, "Invalid argument")
+  })
+
   it("should throw for readonly option", function () {
     const sock = new zmq.Dealer()
     assert.throws(
@@ -2,6 +2,7 @@ import * as zmq from "../../src"
 
 import {assert} from "chai"
 import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
 
 for (const proto of testProtos("tcp", "ipc", "inproc")) {
   describe(`socket with ${proto} pub/sub`, function () {
@@ -104,5 +105,190 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         assert.deepEqual(received, ["bar", "baz"])
       })
     })
+
+    describe("bulk subscriptions", function () {
+      it("should only pass on changed subscriptions", async function () {
+        const address = await uniqAddress(proto)
+        const xpub = new zmq.XPublisher({
+          receiveTimeout: 100,
+          verbosity: "allSubsUnsubs",
+        })
+        await xpub.bind(address)
+        await sub.connect(address)
+
+        sub.updateSubscriptions(["foo", "bar", "foo"])
+        sub.updateSubscriptions(["bar", "baz"], ["baz"])
+        sub.updateSubscriptions([], ["bar", "foo", "qux"])
+
+        const received: string[] = []
+        while (true) {
+          try {
+            const [msg] = await xpub.receive()
+            received.push(`${msg[0]}:${msg.slice(1)}`)
+          } catch (err) {
+            if (!isFullError(err) || err.code !== "EAGAIN") {
+              throw err
+            }
+            break
+          }
+        }
+
+        xpub.close()
+
+        /* The second reference to "bar", "baz" which was added and removed at
+           once, and "qux" which was never added are not passed on. */
+        assert.sameMembers(received, ["1:foo", "1:bar", "0:foo"])
+        assert.equal(received.indexOf("0:foo"), 2)
+      })
+
+      it("should not be available on other socket types", function () {
+        assert.notProperty(pub, "updateSubscriptions")
+
+        const xsub = new zmq.XSubscriber()
+        assert.notProperty(xsub, "updateSubscriptions")
+        xsub.close()
+
+        try {
+          zmq.Subscriber.prototype.updateSubscriptions.call(pub, ["foo"])
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(err.message, "Subscriptions require a subscriber socket")
+          assert.equal(err.code, "EINVAL")
+        }
+      })
+    })
+
+    describe("routes", function () {
+      it("should call the handlers of matching prefixes", async function () {
+        const address = await uniqAddress(proto)
+        const received: string[] = []
+
+        sub.subscribe()
+        sub.route("foo", ([topic]) => received.push(`foo:${topic}`))
+        sub.route("fo", ([topic]) => received.push(`fo:${topic}`))
+        sub.route("bar", ([, body]) => received.push(`bar:${body}`))
+
+        const removed = () => received.push("removed")
+        sub.route("baz", removed)
+        assert.equal(sub.unroute("baz", removed), 1)
+
+        await sub.bind(address)
+        await pub.connect(address)
+
+        /* Wait briefly before publishing to avoid slow joiner syndrome. */
+        await new Promise(resolve => {
+          setTimeout(resolve, 25)
+        })
+
+        for (const topic of ["foobar", "fo", "qux", "baz", "bar"]) {
+          await pub.send([topic, "body"])
+        }
+
+        let count = 0
+        while (count < 5) {
+          count += await sub.dispatch()
+        }
+
+        assert.deepEqual(received, [
+          "fo:foobar",
+          "foo:foobar",
+          "fo:fo",
+          "bar:body",
+        ])
+      })
+
+      it("should reject if a handler throws", async function () {
+        const address = await uniqAddress(proto)
+
+        sub.subscribe()
+        sub.route("", () => {
+          throw new Error("handler failed")
+        })
+
+        await sub.bind(address)
+        await pub.connect(address)
+
+        await new Promise(resolve => {
+          setTimeout(resolve, 25)
+        })
+
+        await pub.send("foo")
+
+        try {
+          await sub.dispatch()
+          assert.ok(false)
+        } catch (err) {
+          assert.equal((err as Error).message, "handler failed")
+        }
+      })
+    })
+
+    describe("topic conflation", function () {
+      it("should receive the latest message per topic", async function () {
+        const address = await uniqAddress(proto)
+
+        sub.conflateTopics = true
+        sub.subscribe()
+
+        await sub.bind(address)
+        await pub.connect(address)
+
+        /* Wait briefly before publishing to avoid slow joiner syndrome. */
+        await new Promise(resolve => {
+          setTimeout(resolve, 25)
+        })
+
+        for (let i = 0; i < 5; i++) {
+          await pub.send(["foo", String(i)])
+          await pub.send(["bar", String(i)])
+        }
+        await pub.send(["end", ""])
+
+        /* Let all messages arrive before receiving. */
+        await new Promise(resolve => {
+          setTimeout(resolve, 25)
+        })
+
+        const latest = new Map<string, string>()
+        let received = 0
+        for await (const [topic, value] of sub) {
+          received++
+          if (topic.toString() === "end") {
+            break
+          }
+          latest.set(topic.toString(), value.toString())
+        }
+
+        assert.deepEqual(Object.fromEntries(latest), {foo: "4", bar: "4"})
+        assert.isBelow(received, 11)
+      })
+
+      it("should not be available on other socket types", function () {
+        assert.notProperty(pub, "conflateTopics")
+        assert.notProperty(pub, "route")
+        assert.notProperty(pub, "dispatch")
+
+        try {
+          const desc = Object.getOwnPropertyDescriptor(
+            zmq.Subscriber.prototype,
+            "conflateTopics",
+          )
+          desc!.set!.call(pub, true)
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(
+            err.message,
+            "Topic conflation requires a subscriber socket",
+          )
+          assert.equal(err.code, "EINVAL")
+        }
+      })
+    })
   })
 }
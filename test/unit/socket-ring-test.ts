@@ -0,0 +1,137 @@
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
+
+for (const proto of testProtos("tcp", "ipc", "inproc")) {
+  describe(`socket with ${proto} receive into ring`, function () {
+    let sockA: zmq.Push
+    let sockB: zmq.Pull
+
+    beforeEach(async function () {
+      sockA = new zmq.Push({linger: 0})
+      sockB = new zmq.Pull({linger: 0})
+
+      const address = await uniqAddress(proto)
+      await sockB.bind(address)
+      sockA.connect(address)
+    })
+
+    afterEach(function () {
+      sockA.close()
+      sockB.close()
+      global.gc?.()
+    })
+
+    it("should write messages to ring", async function () {
+      const ring = zmq.createRing(1024)
+      const reader = new zmq.RingReader(ring)
+
+      await sockA.send(["foo", "bar"])
+      await sockA.send("baz")
+
+      let written = 0
+      while (written < 2) {
+        written += await sockB.receiveInto(ring)
+      }
+
+      assert.deepEqual(
+        reader.read()?.map(part => part.toString()),
+        ["foo", "bar"],
+      )
+      assert.deepEqual(reader.read()?.map(part => part.toString()), ["baz"])
+      assert.isUndefined(reader.read())
+    })
+
+    it("should keep message until ring has room", async function () {
+      const ring = zmq.createRing(64)
+      const reader = new zmq.RingReader(ring)
+
+      const messages = Array.from({length: 20}, (_, i) => `msg${i}`)
+      for (const msg of messages) {
+        await sockA.send(msg)
+      }
+
+      const received: string[] = []
+      while (received.length < messages.length) {
+        await sockB.receiveInto(ring)
+        for (let msg = reader.read(); msg; msg = reader.read()) {
+          received.push(msg[0].toString())
+        }
+      }
+
+      assert.deepEqual(received, messages)
+    })
+
+    it("should pump messages as the reader makes room", async function () {
+      const ring = zmq.createRing(64)
+      const reader = new zmq.RingReader(ring)
+
+      const messages = Array.from({length: 20}, (_, i) => `msg${i}`)
+      for (const msg of messages) {
+        await sockA.send(msg)
+      }
+
+      const pump = zmq.pumpIntoRing(sockB, ring)
+
+      const received: string[] = []
+      while (received.length < messages.length) {
+        const msg = reader.read()
+        if (msg) {
+          received.push(msg[0].toString())
+        } else {
+          await new Promise(resolve => setTimeout(resolve, 1))
+        }
+      }
+
+      sockB.close()
+      await pump
+
+      assert.deepEqual(received, messages)
+    })
+
+    it("should fail with message larger than ring", async function () {
+      const ring = zmq.createRing(64)
+
+      await sockA.send(Buffer.alloc(64))
+      try {
+        await sockB.receiveInto(ring)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.code, "EMSGSIZE")
+        assert.typeOf(err.errno, "number")
+      }
+    })
+
+    it("should fail with corrupted ring offsets", async function () {
+      const ring = zmq.createRing(1024)
+
+      /* Move the read offset far beyond the end of the ring. */
+      ring[1] = 1 << 20
+
+      await sockA.send("foo")
+      try {
+        await sockB.receiveInto(ring)
+        assert.ok(false)
+      } catch (err) {
+        if (!isFullError(err)) {
+          throw err
+        }
+        assert.equal(err.message, "Ring is corrupted")
+        assert.equal(err.code, "EPROTO")
+      }
+    })
+
+    it("should throw with invalid ring", function () {
+      assert.throws(
+        () => (sockB as any).receiveInto(new Uint8Array(64)),
+        TypeError,
+        "Ring must be an Int32Array",
+      )
+    })
+  })
+}
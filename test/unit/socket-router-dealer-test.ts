@@ -89,5 +89,172 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         })
       }
     })
+
+    describe("send to many", function () {
+      it("should send the payload to every peer", async function () {
+        const address = await uniqAddress(proto)
+
+        router.mandatory = true
+        dealerA.routingId = "a"
+        dealerB.routingId = "b"
+
+        await router.bind(address)
+        dealerA.connect(address)
+        dealerB.connect(address)
+
+        /* Wait until the router knows both peers. */
+        await dealerA.send("hello")
+        await dealerB.send("hello")
+        await router.receive()
+        await router.receive()
+
+        const payload = Buffer.alloc(1024, "x")
+        const sent = router.sendToMany(["a", ["b"], "unknown"], [null, payload])
+        assert.equal(sent, 2)
+
+        for (const dealer of [dealerA, dealerB]) {
+          const [empty, msg] = await dealer.receive()
+          assert.equal(empty.length, 0)
+          assert.deepEqual(msg, payload)
+        }
+      })
+
+      it("should reject empty envelopes before sending", async function () {
+        const address = await uniqAddress(proto)
+
+        router.mandatory = true
+        dealerA.routingId = "a"
+
+        await router.bind(address)
+        dealerA.connect(address)
+
+        await dealerA.send("hello")
+        await router.receive()
+
+        try {
+          router.sendToMany(["a", []], "payload")
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(err.message, "Envelope must not be empty")
+          assert.equal(err.code, "EINVAL")
+        }
+
+        /* Nothing was sent, so the next message is the first one. */
+        assert.equal(router.sendToMany(["a"], "next"), 1)
+        const [msg] = await dealerA.receive()
+        assert.deepEqual(msg, Buffer.from("next"))
+      })
+    })
+
+    describe("intern routing ids", function () {
+      it("should return the same value for every message", async function () {
+        const address = await uniqAddress(proto)
+
+        router.internRoutingIds = "string"
+        dealerA.routingId = "a"
+        dealerB.routingId = "b"
+
+        await router.bind(address)
+        dealerA.connect(address)
+        dealerB.connect(address)
+
+        await dealerA.send("1")
+        await dealerB.send("2")
+        await dealerA.send("3")
+
+        const ids: unknown[] = []
+        for (let i = 0; i < 3; i++) {
+          const [id] = await router.receive()
+          ids.push(id)
+        }
+
+        assert.deepEqual(ids.sort(), ["a", "a", "b"])
+        assert.isTrue(router.forgetRoutingId("a"))
+        assert.isFalse(router.forgetRoutingId("a"))
+      })
+
+      it("should keep binary routing ids as buffers", async function () {
+        const address = await uniqAddress(proto)
+        const binary = Buffer.from([0xff, 0x00, 0x80])
+
+        router.internRoutingIds = "string"
+        dealerA.routingId = "a"
+        ;(dealerB as any).setStringOption(5, binary)
+
+        await router.bind(address)
+        dealerA.connect(address)
+        dealerB.connect(address)
+
+        await dealerA.send("1")
+        const [idA] = await router.receive()
+        assert.equal(idA, "a")
+
+        await dealerB.send("2")
+        await dealerB.send("3")
+        const [idB1] = await router.receive()
+        const [idB2] = await router.receive()
+        assert.instanceOf(idB1, Buffer)
+        assert.deepEqual(idB1, binary)
+        assert.strictEqual(idB1, idB2)
+
+        /* The routing id can be used to reply to the peer. */
+        await router.send([idB1, "reply"])
+        const [msg] = await dealerB.receive()
+        assert.deepEqual(msg, Buffer.from("reply"))
+
+        assert.isTrue(router.forgetRoutingId(binary))
+      })
+
+      it("should return shared buffers", async function () {
+        const address = await uniqAddress(proto)
+
+        router.internRoutingIds = "buffer"
+        assert.equal(router.internRoutingIds, "buffer")
+
+        await router.bind(address)
+        dealerA.connect(address)
+
+        await dealerA.send("1")
+        await dealerA.send("2")
+
+        const [id1] = await router.receive()
+        const [id2] = await router.receive()
+        assert.instanceOf(id1, Buffer)
+        assert.strictEqual(id1, id2)
+
+        router.internRoutingIds = null
+        await dealerA.send("3")
+        const [id3] = await router.receive()
+        assert.notStrictEqual(id3, id1)
+        assert.deepEqual(id3, id1)
+      })
+
+      it("should not be available on other socket types", function () {
+        assert.notProperty(dealerA, "internRoutingIds")
+        assert.notProperty(dealerA, "forgetRoutingId")
+        assert.notProperty(dealerA, "sendToMany")
+
+        try {
+          const desc = Object.getOwnPropertyDescriptor(
+            zmq.Router.prototype,
+            "internRoutingIds",
+          )
+          desc!.set!.call(dealerA, "buffer")
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(
+            err.message,
+            "Interning routing ids requires a router socket",
+          )
+          assert.equal(err.code, "EINVAL")
+        }
+      })
+    })
   })
 }
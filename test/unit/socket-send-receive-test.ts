@@ -1,7 +1,12 @@
 import * as zmq from "../../src"
 
 import {assert} from "chai"
-import {testProtos, uniqAddress, getGcOrSkipTest} from "./helpers"
+import {
+  createWorker,
+  getGcOrSkipTest,
+  testProtos,
+  uniqAddress,
+} from "./helpers"
 import {isFullError} from "../../src/errors"
 
 for (const proto of testProtos("tcp", "ipc", "inproc")) {
@@ -324,6 +329,51 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         }
       })
 
+      it("should deliver message with busy polling", async function () {
+        /* The message is sent by another thread while receive() spins, which
+           blocks this thread. */
+        const address = await uniqAddress(proto)
+        const sock = new zmq.Pair({linger: 0})
+        await sock.bind(address)
+
+        const worker = createWorker({address}, async ({address}) => {
+          const peer = new zmq.Pair({linger: 0})
+          await peer.connect(address)
+          await peer.send("ready")
+          await new Promise(resolve => {
+            setTimeout(resolve, 100)
+          })
+          await peer.send("foo")
+
+          /* Wait until the message was received before closing. */
+          await peer.receive()
+          peer.close()
+        })
+
+        const [ready] = await sock.receive()
+        assert.equal(ready.toString(), "ready")
+        assert.isFalse(sock.readable)
+
+        sock.busyPollMicros = 5000000
+        const pending = sock.receive()
+
+        /* On the fast path the promise is resolved before receive() returns,
+           instead of by the poller on a later turn of the event loop. */
+        let resolved = false
+        pending.then(() => {
+          resolved = true
+        })
+        await Promise.resolve()
+        assert.isTrue(resolved)
+
+        const [msg] = await pending
+        assert.equal(msg.toString(), "foo")
+
+        await sock.send("done")
+        await worker
+        sock.close()
+      })
+
       it("should release buffers", async function () {
         const gc = await getGcOrSkipTest(this)
 
@@ -579,9 +629,149 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         }
       })
 
-      it("should throw error on concurrent receive", async function () {
+      it("should queue concurrent sends within send queue capacity", async function () {
+        sockA.sendQueueCapacity = 9
+        const sent = [
+          sockA.send("foo"),
+          sockA.send("bar"),
+          sockA.send("baz"),
+        ]
+
+        assert.equal(sockA.sendQueueSize, 9)
+
+        const address = await uniqAddress(proto)
+        await sockB.bind(address)
+        await sockA.connect(address)
+
+        await Promise.all(sent)
+        assert.equal(sockA.sendQueueSize, 0)
+
+        const msgs: string[] = []
+        for (let i = 0; i < 3; i++) {
+          const [msg] = await sockB.receive()
+          msgs.push(msg.toString())
+        }
+
+        assert.deepEqual(msgs, ["foo", "bar", "baz"])
+      })
+
+      it("should reject queued sends when closed", async function () {
+        sockA.sendQueueCapacity = 9
+        const sent = [
+          sockA.send("foo").catch(err => err),
+          sockA.send("bar").catch(err => err),
+          sockA.send("baz").catch(err => err),
+        ]
+
+        assert.equal(sockA.sendQueueSize, 9)
+        sockA.close()
+        assert.equal(sockA.sendQueueSize, 0)
+
+        /* The first send was in progress and is cancelled. */
+        const [first, ...queued] = await Promise.all(sent)
+        assert.equal(first.code, "EAGAIN")
+
+        for (const err of queued) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(err.message, "Socket is closed")
+          assert.equal(err.code, "EBADF")
+        }
+      })
+
+      it("should throw error if send queue is full", async function () {
+        sockA.sendTimeout = 20
+        sockA.sendQueueCapacity = 6
+        const done = [
+          sockA.send("foo").catch(() => null),
+          sockA.send("bar").catch(() => null),
+        ]
+
+        try {
+          sockA.send("baz").catch(() => null)
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(
+            err.message,
+            "Socket is busy writing; send queue is full",
+          )
+          assert.equal(err.code, "EBUSY")
+          assert.typeOf(err.errno, "number")
+        } finally {
+          await Promise.all(done)
+        }
+      })
+
+      it("should resolve writable ready when socket becomes writable", async function () {
+        const ready = sockA.writableReady()
+
+        const address = await uniqAddress(proto)
+        await sockB.bind(address)
+        await sockA.connect(address)
+
+        await ready
+        assert.equal(sockA.writable, true)
+        await sockA.writableReady()
+      })
+
+      it("should honor send timeout when waiting for writable", async function () {
+        sockA.sendTimeout = 20
+        try {
+          await sockA.writableReady()
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(err.code, "EAGAIN")
+        }
+      })
+
+      it("should queue concurrent receives", async function () {
+        const address = await uniqAddress(proto)
+        await sockB.bind(address)
+        await sockA.connect(address)
+
+        const received = Promise.all([
+          sockB.receive(),
+          sockB.receive(),
+          sockB.receive(),
+        ])
+
+        await sockA.send("foo")
+        await sockA.send("bar")
+        await sockA.send("baz")
+
+        const msgs = (await received).map(([msg]) => msg.toString())
+        assert.deepEqual(msgs, ["foo", "bar", "baz"])
+      })
+
+      it("should honor receive timeout for each queued receive", async function () {
+        sockA.receiveTimeout = 20
+        const errors = await Promise.all([
+          sockA.receive().catch(err => err),
+          sockA.receive().catch(err => err),
+        ])
+
+        for (const err of errors) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(err.code, "EAGAIN")
+        }
+      })
+
+      it("should throw error on too many concurrent receives", async function () {
         sockA.receiveTimeout = 20
-        const done = sockA.receive().catch(() => null)
+        const done: Promise<unknown>[] = []
+        for (let i = 0; i < 1024; i++) {
+          done.push(sockA.receive().catch(() => null))
+        }
+
         try {
           sockA.receive().catch(() => null)
           assert.ok(false)
@@ -591,12 +781,68 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
           }
           assert.equal(
             err.message,
-            "Socket is busy reading; only one receive operation may be in progress at any time",
+            "Socket is busy reading; too many receive operations are in progress",
           )
           assert.equal(err.code, "EBUSY")
           assert.typeOf(err.errno, "number")
         } finally {
-          await done
+          sockA.close()
+          await Promise.all(done)
+        }
+      })
+    })
+
+    describe("with offloaded I/O", function () {
+      beforeEach(function () {
+        sockA.close()
+        sockB.close()
+        sockA = new zmq.Pair({linger: 0, offload: true})
+        sockB = new zmq.Pair({linger: 0, offload: true})
+      })
+
+      it("should deliver messages in order", async function () {
+        const address = await uniqAddress(proto)
+        const messages = Array.from({length: 100}, (_, i) => `msg${i}`)
+        const received: string[] = []
+
+        await sockB.bind(address)
+        await sockA.connect(address)
+
+        const send = async () => {
+          for (const msg of messages) {
+            await sockA.send([msg, "more"])
+          }
+        }
+
+        const receive = async () => {
+          for (let i = 0; i < messages.length; i++) {
+            const [msg, more] = await sockB.receive()
+            assert.equal(more.toString(), "more")
+            received.push(msg.toString())
+          }
+        }
+
+        await Promise.all([send(), receive()])
+        assert.deepEqual(received, messages)
+      })
+
+      it("should get and set options", function () {
+        sockA.sendHighWaterMark = 5
+        assert.equal(sockA.sendHighWaterMark, 5)
+        sockA.routingId = "foo"
+        assert.equal(sockA.routingId, "foo")
+      })
+
+      it("should time out receiving", async function () {
+        sockA.receiveTimeout = 10
+        try {
+          await sockA.receive()
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(err.code, "EAGAIN")
         }
       })
     })
@@ -87,5 +87,93 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         )
       })
     })
+
+    describe("with detached messages", function () {
+      it("should adopt messages in thread", async function () {
+        const address = await uniqAddress(proto)
+
+        const sockA = new zmq.Pair({linger: 0})
+        const sockB = new zmq.Pair({linger: 0})
+        await sockB.bind(address)
+        await sockA.connect(address)
+        await sockA.send(["foo", Buffer.alloc(1024, "x")])
+
+        const handles = await sockB.receiveHandles()
+        sockA.close()
+        sockB.close()
+
+        const recv = await createWorker({handles}, async ({handles}) => {
+          return handles.map(handle => zmq.adoptMessage(handle))
+        })
+
+        assert.deepEqual(
+          ["foo", "x".repeat(1024)],
+          recv.map(buf => Buffer.from(buf).toString()),
+        )
+      })
+
+      it("should throw with released handle", async function () {
+        const address = await uniqAddress(proto)
+
+        const sockA = new zmq.Pair({linger: 0})
+        const sockB = new zmq.Pair({linger: 0})
+        await sockB.bind(address)
+        await sockA.connect(address)
+        await sockA.send("foo")
+
+        const [handle] = await sockB.receiveHandles()
+        sockA.close()
+        sockB.close()
+
+        zmq.releaseMessage(handle)
+        assert.throws(
+          () => zmq.adoptMessage(handle),
+          Error,
+          "Message handle is invalid",
+        )
+      })
+    })
+
+    describe("with detached socket", function () {
+      it("should deliver messages after adoption in thread", async function () {
+        const address = await uniqAddress(proto)
+
+        const sockA = new zmq.Pair({linger: 0})
+        const sockB = new zmq.Pair({linger: 0, receiveTimeout: 5000})
+        await sockB.bind(address)
+        await sockA.connect(address)
+
+        /* Queued before the socket is detached. */
+        await sockA.send("foo")
+
+        const handle = sockB.detach()
+        assert.equal(sockB.closed, true)
+
+        const recv = await createWorker({handle}, async ({handle}) => {
+          const sock = zmq.Pair.adopt(handle)
+          const [msg] = await sock.receive()
+          await sock.send("bar")
+          sock.close()
+          return msg
+        })
+
+        assert.equal(Buffer.from(recv).toString(), "foo")
+        const [reply] = await sockA.receive()
+        assert.equal(reply.toString(), "bar")
+        sockA.close()
+      })
+
+      it("should throw with handle of other socket type", function () {
+        const sock = new zmq.Pair()
+        const handle = sock.detach()
+        assert.throws(
+          () => zmq.Dealer.adopt(handle),
+          Error,
+          "Socket handle is invalid",
+        )
+
+        zmq.Pair.adopt(handle).close()
+      })
+    })
   })
 }
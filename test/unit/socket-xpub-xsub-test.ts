@@ -3,6 +3,7 @@ import * as zmq from "../../src"
 
 import {assert} from "chai"
 import {testProtos, uniqAddress} from "./helpers"
+import {isFullError} from "../../src/errors"
 
 for (const proto of testProtos("tcp", "ipc", "inproc")) {
   describe(`socket with ${proto} xpub/xsub`, function () {
@@ -295,5 +296,94 @@ for (const proto of testProtos("tcp", "ipc", "inproc")) {
         sub2.close()
       })
     })
+
+    describe("subscription tracking", function () {
+      it("should count subscribers per prefix", async function () {
+        /* ZMQ 4.2 first introduced ZMQ_XPUB_VERBOSER. */
+        if (semver.satisfies(zmq.version, "< 4.2")) {
+          this.skip()
+        }
+
+        const address = await uniqAddress(proto)
+
+        xpub.verbosity = "allSubsUnsubs"
+        xpub.trackSubscriptions = true
+
+        const sub1 = sub
+        const sub2 = new zmq.Subscriber()
+        await xpub.bind(address)
+        await sub1.connect(address)
+        await sub2.connect(address)
+
+        /* Subscriptions are counted as they are received. */
+        const receive = async (count: number) => {
+          for (let i = 0; i < count; i++) {
+            await xpub.receive()
+          }
+        }
+
+        assert.equal(xpub.hasSubscribers("foo"), false)
+
+        sub1.subscribe("fo")
+        sub2.subscribe("fo")
+        await receive(2)
+        assert.equal(xpub.hasSubscribers("foo"), true)
+        assert.equal(xpub.hasSubscribers("bar"), false)
+
+        /* One subscriber is left. */
+        sub2.unsubscribe("fo")
+        sub1.subscribe("bar")
+        await receive(2)
+        assert.equal(xpub.hasSubscribers("bar"), true)
+        assert.equal(xpub.hasSubscribers("foo"), true)
+
+        sub1.unsubscribe("fo")
+        await receive(1)
+        assert.equal(xpub.hasSubscribers("foo"), false)
+
+        sub2.close()
+      })
+
+      it("should not take subscriptions from the socket", async function () {
+        const address = await uniqAddress(proto)
+
+        xpub.trackSubscriptions = true
+        await xpub.bind(address)
+        await sub.connect(address)
+
+        sub.subscribe("fo")
+        await new Promise(resolve => {
+          setTimeout(resolve, 15)
+        })
+
+        assert.equal(xpub.hasSubscribers("foo"), false)
+        const [msg] = await xpub.receive()
+        assert.deepEqual(msg, Buffer.from("\x01fo"))
+        assert.equal(xpub.hasSubscribers("foo"), true)
+      })
+
+      it("should not be available on other socket types", function () {
+        assert.notProperty(pub, "trackSubscriptions")
+        assert.notProperty(pub, "hasSubscribers")
+
+        try {
+          const desc = Object.getOwnPropertyDescriptor(
+            zmq.XPublisher.prototype,
+            "trackSubscriptions",
+          )
+          desc!.set!.call(pub, true)
+          assert.ok(false)
+        } catch (err) {
+          if (!isFullError(err)) {
+            throw err
+          }
+          assert.equal(
+            err.message,
+            "Subscription tracking requires an XPublisher",
+          )
+          assert.equal(err.code, "EINVAL")
+        }
+      })
+    })
   })
 }
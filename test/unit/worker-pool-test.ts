@@ -0,0 +1,165 @@
+import * as zmq from "../../src"
+
+import {assert} from "chai"
+import {createWorker} from "./helpers"
+import {isFullError} from "../../src/errors"
+
+describe("worker pool", function () {
+  let pool: zmq.WorkerPool
+  let sender: zmq.Push
+
+  beforeEach(function () {
+    sender = new zmq.Push({linger: 0})
+  })
+
+  afterEach(function () {
+    pool.close()
+    sender.close()
+    global.gc?.()
+  })
+
+  it("should deliver messages to workers", async function () {
+    pool = new zmq.WorkerPool({workers: 2})
+    sender.connect(pool.address)
+
+    const workerA = new zmq.PoolWorker(pool.workerAddress)
+    const workerB = new zmq.PoolWorker(pool.workerAddress)
+
+    const messages = ["foo", "bar", "baz", "qux"]
+    for (const msg of messages) {
+      await sender.send(msg)
+    }
+
+    const received: string[] = []
+    const receive = async (worker: zmq.PoolWorker) => {
+      for await (const [msg] of worker) {
+        received.push(msg.toString())
+        if (received.length === messages.length) {
+          workerA.close()
+          workerB.close()
+        }
+      }
+    }
+
+    await Promise.all([receive(workerA), receive(workerB)])
+    assert.sameMembers(received, messages)
+  })
+
+  it("should deliver messages with the same key to one worker", async function () {
+    pool = new zmq.WorkerPool({workers: 4, affinity: true})
+    sender.connect(pool.address)
+
+    const workers = Array.from(
+      {length: 4},
+      () => new zmq.PoolWorker(pool.workerAddress),
+    )
+
+    const count = 40
+    for (let i = 0; i < count; i++) {
+      await sender.send([`key${i % 5}`, i.toString()])
+    }
+
+    const owners = new Map<string, number>()
+    const received = new Map<string, number[]>()
+    let total = 0
+
+    const receive = async (worker: zmq.PoolWorker, index: number) => {
+      for await (const [key, value] of worker) {
+        assert.equal(owners.get(key.toString()) ?? index, index)
+        owners.set(key.toString(), index)
+
+        const values = received.get(key.toString()) ?? []
+        values.push(parseInt(value.toString(), 10))
+        received.set(key.toString(), values)
+
+        if (++total === count) {
+          workers.forEach(worker => worker.close())
+        }
+      }
+    }
+
+    await Promise.all(workers.map(receive))
+
+    for (const values of received.values()) {
+      assert.deepEqual(values, [...values].sort((a, b) => a - b))
+    }
+  })
+
+  it("should report statistics", async function () {
+    pool = new zmq.WorkerPool({workers: 2, queueCapacity: 4})
+    sender.connect(pool.address)
+
+    const worker = new zmq.PoolWorker(pool.workerAddress)
+    await sender.send("foo")
+    await sender.send("bar")
+
+    /* The second message is only delivered once the first is finished. */
+    await worker.receive()
+    await worker.receive()
+
+    const stats = pool.statistics()
+    worker.close()
+
+    assert.lengthOf(stats, 2)
+    assert.equal(stats.filter(slot => slot.attached).length, 1)
+
+    const processed = stats.reduce((sum, slot) => sum + slot.processed, 0)
+    const active = stats.reduce((sum, slot) => sum + slot.active, 0)
+    assert.equal(processed, 1)
+    assert.equal(active, 1)
+    for (const slot of stats) {
+      assert.isAtLeast(slot.utilization, 0)
+      assert.isAtMost(slot.utilization, 1)
+    }
+  })
+
+  it("should deliver messages to worker threads", async function () {
+    pool = new zmq.WorkerPool({workers: 1})
+    sender.connect(pool.address)
+    await sender.send("foo")
+
+    const msg = await createWorker(
+      {address: pool.workerAddress},
+      async ({address}) => {
+        const worker = new zmq.PoolWorker(address)
+        const [msg] = await worker.receive()
+        worker.close()
+        return msg
+      },
+    )
+
+    assert.equal(Buffer.from(msg).toString(), "foo")
+  })
+
+  it("should throw with invalid options", function () {
+    pool = new zmq.WorkerPool({workers: 1})
+    assert.throws(
+      () => new zmq.WorkerPool({workers: 0}),
+      TypeError,
+      "Workers must be a positive integer",
+    )
+    assert.throws(
+      () => new zmq.WorkerPool({queueCapacity: 1.5}),
+      TypeError,
+      "Queue capacity must be a positive integer",
+    )
+  })
+
+  it("should throw when reading statistics after close", function () {
+    pool = new zmq.WorkerPool({workers: 1})
+    pool.close()
+    assert.equal(pool.closed, true)
+
+    try {
+      pool.statistics()
+      assert.ok(false)
+    } catch (err) {
+      if (!isFullError(err)) {
+        throw err
+      }
+      assert.equal(err.message, "Pool is closed")
+      assert.equal(err.code, "EBADF")
+      assert.typeOf(err.errno, "number")
+    }
+  })
+})